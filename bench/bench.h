@@ -0,0 +1,112 @@
+/**
+ * Minimal host benchmark harness (bench/)
+ *
+ * Each benchmark body is calibrated to run for at least BENCH_EPOCH_NS per
+ * epoch, then timed over BENCH_EPOCHS epochs. The median is reported as
+ * ns/op, with the fastest epoch as min.
+ *
+ * Command line, shared by every bench binary:
+ *   --json          print results as one line of JSON (for bench/compare.py)
+ *                   instead of a table
+ *   --filter=TEXT   only run benchmarks whose name contains TEXT
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define BENCH_EPOCHS 15
+#define BENCH_EPOCH_NS 2000000ULL
+
+namespace bench {
+
+// Keeps a value alive without the compiler seeing through it
+template <typename T>
+inline void doNotOptimize(T const& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result {
+    std::string name;
+    double nsPerOp;
+    double minNs;
+    uint64_t iterations;
+};
+
+class Runner {
+public:
+    Runner(const char* suite, int argc, char** argv) : _suite(suite), _json(false) {
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "--json") == 0) _json = true;
+            else if (strncmp(argv[i], "--filter=", 9) == 0) _filter = argv[i] + 9;
+        }
+        if (!_json) printf("%-28s %12s %12s %14s\n", "benchmark", "ns/op", "min ns/op", "ops/s");
+    }
+
+    /**
+     * Time body(i) for i = 0, 1, 2, ...
+     */
+    template <typename F>
+    void run(const char* name, F body) {
+        if (!_filter.empty() && !strstr(name, _filter.c_str())) return;
+
+        // Double the batch until one epoch is long enough to time reliably
+        uint64_t iters = 1;
+        while (timeBatch(body, iters) < BENCH_EPOCH_NS && iters < (1ULL << 40)) iters *= 2;
+
+        std::vector<double> perOp;
+        for (int e = 0; e < BENCH_EPOCHS; e++) {
+            perOp.push_back((double)timeBatch(body, iters) / iters);
+        }
+        std::sort(perOp.begin(), perOp.end());
+
+        Result r = {name, perOp[BENCH_EPOCHS / 2], perOp[0], iters * BENCH_EPOCHS};
+        _results.push_back(r);
+        if (!_json) {
+            printf("%-28s %12.1f %12.1f %14.0f\n", name, r.nsPerOp, r.minNs, 1e9 / r.nsPerOp);
+        }
+    }
+
+    /**
+     * Print JSON results if requested
+     * @return Process exit code
+     */
+    int finish() const {
+        if (!_json) return 0;
+        printf("{\"suite\":\"%s\",\"compiler\":\"%s\",\"results\":[", _suite, __VERSION__);
+        for (size_t i = 0; i < _results.size(); i++) {
+            const Result& r = _results[i];
+            printf("%s{\"name\":\"%s\",\"ns_per_op\":%.3f,\"min_ns\":%.3f,\"iterations\":%llu}",
+                   i ? "," : "", r.name.c_str(), r.nsPerOp, r.minNs, (unsigned long long)r.iterations);
+        }
+        printf("]}\n");
+        return 0;
+    }
+
+private:
+    const char* _suite;
+    bool _json;
+    std::string _filter;
+    std::vector<Result> _results;
+    uint64_t _next = 0;   // Keeps i increasing across batches
+
+    template <typename F>
+    uint64_t timeBatch(F& body, uint64_t iters) {
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; i++) body(_next + i);
+        auto end = std::chrono::steady_clock::now();
+        _next += iters;
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+};
+
+} // namespace bench
+
+#endif // BENCH_H
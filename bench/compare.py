@@ -0,0 +1,55 @@
+"""
+Self-Leveling Platform - Compare two benchmark runs
+
+Reads the JSON Lines written by `make json` (one line per bench suite) and
+prints the change in ns/op for every benchmark present in both runs.
+
+    python3 compare.py results/BASE.jsonl results/NEW.jsonl [--threshold 10]
+
+Exits with status 1 if any benchmark got slower by more than the
+threshold (percent), so it can gate a commit.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            suite = json.loads(line)
+            for r in suite["results"]:
+                results[f"{suite['suite']}:{r['name']}"] = r["ns_per_op"]
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two benchmark runs")
+    parser.add_argument("base")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="regression threshold in percent (default 10)")
+    args = parser.parse_args()
+
+    base, new = load(args.base), load(args.new)
+    regressions = 0
+    print(f"{'benchmark':36} {'base ns':>10} {'new ns':>10} {'change':>8}")
+    for name in sorted(base.keys() & new.keys()):
+        change = (new[name] - base[name]) / base[name] * 100.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print(f"{name:36} {base[name]:10.1f} {new[name]:10.1f} {change:+7.1f}%{flag}")
+    for name in sorted(base.keys() ^ new.keys()):
+        print(f"{name:36} only in {'base' if name in base else 'new'}")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,202 @@
+/**
+ * Host microbenchmarks for the control hot path
+ *
+ * Runs the real library sources against the Arduino shim in bench/shim
+ * (no waiting, no hardware), so only computation is measured:
+ *   imu/update           MPU6050Handler::update - register decode, calibration
+ *                        offsets, complementary filter, motion detection
+ *   leveling/calculate   LevelingController::calculate (both PI axes + mixing)
+ *   leveling/mpc         PredictiveController::calculate (fixed-iteration QP)
+ *   leveling/predict     AttitudePredictor::update (per IMU sample) and addMove
+ *   stepper/moveBoth     StepperController::moveBoth Bresenham interleave for a
+ *                        50 x 30 step correction, step delays stubbed out
+ *   stepper/microstep    The same move with sine microstepping (16 LEDC phase
+ *                        updates per step)
+ *   status/encode        DashboardProtocol::encodeStatus (broadcastStatus frame)
+ *   status/json          The JSON status broadcastStatus sent before the binary
+ *                        frame, formatted with snprintf (a lower bound: the
+ *                        firmware built it with ArduinoJson and String temporaries)
+ *   status/delta         DashboardProtocol::encodeDelta against a moving baseline
+ *   console/parse        CommandArgs tokenize + table lookup + numeric argument
+ *
+ * Build and run from bench/:  make run   (make json for machine-readable output)
+ */
+
+#include "bench.h"
+#include "Wire.h"
+#include "MPU6050Handler.h"
+#include "LevelingController.h"
+#include "PredictiveController.h"
+#include "AttitudePredictor.h"
+#include "StepperController.h"
+#include "SerialConsole.h"
+#include "DashboardProtocol.h"
+
+// The JSON status message replaced by StatusFrame: same fields, same precision
+static int formatJsonStatus(const DashboardStatus& s, char* buf, size_t size) {
+    return snprintf(buf, size,
+        "{\"t\":\"status\",\"pitch\":%.2f,\"roll\":%.2f,"
+        "\"ax\":%.3f,\"ay\":%.3f,\"az\":%.3f,\"gx\":%.1f,\"gy\":%.1f,\"gz\":%.1f,"
+        "\"temp\":%.1f,\"m1\":%ld,\"m2\":%ld,\"mMin\":%ld,\"mMax\":%ld,"
+        "\"m1Lim\":%s,\"m2Lim\":%s,\"state\":\"%s\",\"cal\":%s,\"level\":%s,"
+        "\"tol\":%.2f,\"stMs\":%lu,\"kpP\":%.2f,\"kiP\":%.3f,\"kpR\":%.2f,\"kiR\":%.3f,"
+        "\"up\":%lu}",
+        s.pitch, s.roll, s.accelX, s.accelY, s.accelZ, s.gyroX, s.gyroY, s.gyroZ,
+        s.temperature, s.m1pos, s.m2pos, s.minPos, s.maxPos,
+        s.m1limit ? "true" : "false", s.m2limit ? "true" : "false", "LEVELING",
+        s.isCalibrated ? "true" : "false", s.isLevel ? "true" : "false",
+        s.tolerance, s.stabilityTimeoutMs, s.kpPitch, s.kiPitch, s.kpRoll, s.kiRoll, s.uptime);
+}
+
+// 64 frames of a slightly tilted, noisy platform
+static uint8_t imuFrames[64][14];
+
+static void putBE16(uint8_t* p, int16_t v) {
+    p[0] = (uint8_t)((uint16_t)v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void makeImuFrames() {
+    srand(1);
+    for (int i = 0; i < 64; i++) {
+        int noise = rand() % 200 - 100;
+        putBE16(imuFrames[i] + 0, 300 + noise);        // ax  ~0.02 g
+        putBE16(imuFrames[i] + 2, -500 - noise);       // ay
+        putBE16(imuFrames[i] + 4, 16384 + noise / 2);  // az  ~1 g
+        putBE16(imuFrames[i] + 6, 1200);               // temperature
+        putBE16(imuFrames[i] + 8, noise);              // gx
+        putBE16(imuFrames[i] + 10, -noise);            // gy
+        putBE16(imuFrames[i] + 12, noise / 4);         // gz
+    }
+    shimSetImuSamples(&imuFrames[0][0], 64);
+}
+
+static void handlerStub(const CommandArgs&) {}
+
+// Same shape and size as main.cpp's NORMAL_COMMANDS
+static constexpr ConsoleCommand COMMANDS[] = {
+    {"?", handlerStub}, {"admin", handlerStub}, {"c", handlerStub}, {"h", handlerStub},
+    {"help", handlerStub}, {"hstream", handlerStub}, {"i", handlerStub}, {"l", handlerStub},
+    {"level", handlerStub}, {"log", handlerStub}, {"m1", handlerStub}, {"m2", handlerStub},
+    {"mpc", handlerStub}, {"p", handlerStub}, {"perf", handlerStub}, {"predict", handlerStub},
+    {"r", handlerStub}, {"s", handlerStub}, {"sched", handlerStub}, {"settle", handlerStub},
+    {"st", handlerStub}, {"stall", handlerStub}, {"t", handlerStub}, {"test", handlerStub},
+    {"timing", handlerStub},
+};
+static_assert(SerialConsole::isSorted(COMMANDS), "COMMANDS must be sorted by name");
+
+static const char* const LINES[] = {"m1 100", "p 1.0 0.05", "s", "hstream 200", "timing reset"};
+#define LINE_COUNT (sizeof(LINES) / sizeof(LINES[0]))
+
+int main(int argc, char** argv) {
+    bench::Runner runner("control", argc, argv);
+    makeImuFrames();
+
+    MPU6050Handler imu;
+    runner.run("imu/update", [&](uint64_t) {
+        imu.update();
+        bench::doNotOptimize(imu.getPitch());
+    });
+
+    LevelingController leveling;
+    runner.run("leveling/calculate", [&](uint64_t i) {
+        // Small alternating errors keep the integrators inside their limits
+        float e = (i & 1) ? 0.8f : -0.8f;
+        MotorCorrection c = leveling.calculate(e, -0.5f * e);
+        bench::doNotOptimize(c);
+    });
+
+    PredictiveController mpc;
+    runner.run("leveling/mpc", [&](uint64_t i) {
+        float e = (i & 1) ? 0.8f : -0.8f;
+        MotorCorrection c = mpc.calculate(e, -0.5f * e, 35000, 35000);
+        bench::doNotOptimize(c);
+    });
+
+    AttitudePredictor predictor;
+    MotorCorrection move = {50, -30};
+    runner.run("leveling/predict", [&](uint64_t i) {
+        // A move every 5th sample (control interval / IMU interval)
+        if (i % 5 == 0) predictor.addMove(move);
+        predictor.update(0.01f * (i & 7), -0.01f * (i & 7));
+        bench::doNotOptimize(predictor.getPitch());
+    });
+
+    StepperController motors;
+    motors.setLimits(-1000000, 1000000);
+    runner.run("stepper/moveBoth", [&](uint64_t i) {
+        // Alternate direction so positions stay bounded
+        int dir = (i & 1) ? 1 : -1;
+        motors.moveBoth(50 * dir, -30 * dir);
+        bench::doNotOptimize(motors.getPosition1());
+    });
+
+    StepperController microMotors;
+    microMotors.setLimits(-1000000, 1000000);
+    microMotors.setMicrostepping(true);
+    runner.run("stepper/microstep", [&](uint64_t i) {
+        int dir = (i & 1) ? 1 : -1;
+        microMotors.moveBoth(50 * dir, -30 * dir);
+        bench::doNotOptimize(microMotors.getPosition1());
+    });
+
+    DashboardStatus status;
+    memset(&status, 0, sizeof(status));
+    status.state = SystemState::LEVELING;
+    status.accelX = 0.012f;
+    status.accelY = -0.034f;
+    status.accelZ = 0.998f;
+    status.gyroX = 0.3f;
+    status.gyroY = -0.2f;
+    status.gyroZ = 0.1f;
+    status.temperature = 27.4f;
+    status.m2pos = 35210;
+    status.maxPos = MOTOR_MAX_POSITION;
+    status.isCalibrated = true;
+    status.tolerance = 0.5f;
+    status.stabilityTimeoutMs = STABILITY_TIMEOUT_MS;
+    status.kpPitch = 1.0f;
+    status.kiPitch = 0.05f;
+    status.kpRoll = 0.5f;
+    status.kiRoll = 0.03f;
+    status.uptime = 3725000;
+    StatusFrame frame;
+    runner.run("status/encode", [&](uint64_t i) {
+        status.pitch = (i % 100) * 0.01f;
+        status.m1pos = (long)i;
+        DashboardProtocol::encodeStatus(status, frame);
+        bench::doNotOptimize(frame);
+    });
+
+    char json[512];
+    runner.run("status/json", [&](uint64_t i) {
+        status.pitch = (i % 100) * 0.01f;
+        status.m1pos = (long)i;
+        int len = formatJsonStatus(status, json, sizeof(json));
+        bench::doNotOptimize(len);
+    });
+
+    StatusFrame baseline = frame;
+    uint8_t deltaBuf[DASH_DELTA_MAX_SIZE];
+    runner.run("status/delta", [&](uint64_t i) {
+        status.pitch = (i % 100) * 0.01f;
+        status.roll = -(float)(i % 37) * 0.01f;
+        status.m1pos = (long)i;
+        DashboardProtocol::encodeStatus(status, frame);
+        size_t len = DashboardProtocol::encodeDelta(frame, baseline, DASH_FIELDS_ALL, false, deltaBuf);
+        bench::doNotOptimize(len);
+    });
+
+    char line[SERIAL_LINE_MAX];
+    runner.run("console/parse", [&](uint64_t i) {
+        strcpy(line, LINES[i % LINE_COUNT]);
+        CommandArgs args(line);
+        const ConsoleCommand* cmd = SerialConsole::find(COMMANDS, args.name());
+        long value = 0;
+        args.getInt(0, value);
+        bench::doNotOptimize(cmd);
+        bench::doNotOptimize(value);
+    });
+
+    return runner.finish();
+}
@@ -0,0 +1,111 @@
+/**
+ * Host microbenchmark for dashboard command decoding (DashboardCommands)
+ *
+ * Build and run from bench/:  make run   (make json for machine-readable output)
+ *
+ * Times per message for:
+ *   lookup/strcmp  command name resolved by the old linear strcmp chain
+ *   lookup/hash    command name resolved by DashboardCommands::lookup
+ *   json           full JSON decode (copy into the receive buffer + parseJson)
+ *   binary         full binary decode (parseBinary)
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+#include "DashboardCommands.h"
+
+// Old handleMessage order, one strcmp per branch
+static const char* const CHAIN[] = {
+    "sub", "hstream", "wsstats", "motor", "both", "mstop", "mspeed", "mcont",
+    "mreset", "mreset1", "mreset2", "mset", "munlock", "mlock", "calibrate",
+    "scan", "stream", "state", "gains", "tolerance", "stabTimeout", "led",
+    "release", "serial",
+};
+
+static int chainLookup(const char* name) {
+    for (size_t i = 0; i < sizeof(CHAIN) / sizeof(CHAIN[0]); i++) {
+        if (strcmp(name, CHAIN[i]) == 0) return (int)i + 1;
+    }
+    return 0;
+}
+
+// Stand-in for DashboardProtocol::fieldBit
+static uint32_t fieldBit(const char* name) {
+    static const char* const FIELDS[] = {"state", "flags", "pitch", "roll", "m1", "m2"};
+    for (size_t i = 0; i < sizeof(FIELDS) / sizeof(FIELDS[0]); i++) {
+        if (strcmp(FIELDS[i], name) == 0) return 1UL << i;
+    }
+    return 0;
+}
+
+// Mix of what the dashboard sends: jogs dominate, the rest once each
+static const char* const JSON_MESSAGES[] = {
+    "{\"cmd\":\"motor\",\"id\":1,\"steps\":100}",
+    "{\"cmd\":\"motor\",\"id\":2,\"steps\":-100}",
+    "{\"cmd\":\"both\",\"m1\":10,\"m2\":-10}",
+    "{\"cmd\":\"mstop\"}",
+    "{\"cmd\":\"sub\",\"fields\":[\"pitch\",\"roll\",\"state\"],\"hz\":50}",
+    "{\"cmd\":\"gains\",\"kpP\":1.0,\"kiP\":0.05,\"kpR\":0.5,\"kiR\":0.03}",
+    "{\"cmd\":\"led\",\"mode\":\"red\"}",
+    "{\"cmd\":\"serial\",\"text\":\"mpos\"}",
+};
+#define JSON_COUNT (sizeof(JSON_MESSAGES) / sizeof(JSON_MESSAGES[0]))
+
+static const char* const NAMES[] = {
+    "motor", "motor", "both", "mstop", "sub", "gains", "led", "serial",
+};
+#define NAME_COUNT (sizeof(NAMES) / sizeof(NAMES[0]))
+
+static const uint8_t BIN_MOTOR[] = {0x04, 1, 100, 0, 0, 0};
+static const uint8_t BIN_BOTH[] = {0x05, 10, 0, 0, 0, 0xF6, 0xFF, 0xFF, 0xFF};
+static const uint8_t BIN_MSTOP[] = {0x06};
+static const uint8_t BIN_SUB[] = {0x01, 0x0D, 0, 0, 0, 50, 0};
+static const uint8_t BIN_LED[] = {0x16, 'r', 'e', 'd', 0};
+
+struct BinaryMessage {
+    const uint8_t* data;
+    size_t len;
+};
+
+static const BinaryMessage BIN_MESSAGES[] = {
+    {BIN_MOTOR, sizeof(BIN_MOTOR)},
+    {BIN_MOTOR, sizeof(BIN_MOTOR)},
+    {BIN_BOTH, sizeof(BIN_BOTH)},
+    {BIN_MSTOP, sizeof(BIN_MSTOP)},
+    {BIN_SUB, sizeof(BIN_SUB)},
+    {BIN_LED, sizeof(BIN_LED)},
+};
+#define BIN_COUNT (sizeof(BIN_MESSAGES) / sizeof(BIN_MESSAGES[0]))
+
+int main(int argc, char** argv) {
+    bench::Runner runner("dispatch", argc, argv);
+    char buf[128];
+
+    runner.run("lookup/strcmp", [&](uint64_t i) {
+        bench::doNotOptimize(chainLookup(NAMES[i % NAME_COUNT]));
+    });
+
+    runner.run("lookup/hash", [&](uint64_t i) {
+        const char* name = NAMES[i % NAME_COUNT];
+        bench::doNotOptimize(DashboardCommands::lookup(name, strlen(name)));
+    });
+
+    runner.run("json", [&](uint64_t i) {
+        const char* msg = JSON_MESSAGES[i % JSON_COUNT];
+        size_t len = strlen(msg);
+        memcpy(buf, msg, len);
+        DashCommand cmd;
+        DashboardCommands::parseJson(buf, len, cmd, fieldBit);
+        bench::doNotOptimize(cmd);
+    });
+
+    runner.run("binary", [&](uint64_t i) {
+        const BinaryMessage& msg = BIN_MESSAGES[i % BIN_COUNT];
+        DashCommand cmd;
+        DashboardCommands::parseBinary(msg.data, msg.len, cmd);
+        bench::doNotOptimize(cmd);
+    });
+
+    return runner.finish();
+}
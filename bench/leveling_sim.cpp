@@ -0,0 +1,330 @@
+/**
+ * Closed-loop leveling simulator
+ *
+ * Runs the real LevelingController and StepperController against a model
+ * of the platform on the host, with loop() timing as in main.cpp:
+ *   - tilt follows the motor positions through the measured plant gains
+ *     (PLANT_* in config.h)
+ *   - the IMU angle is the complementary filter's accelerometer path
+ *     (COMPLEMENTARY_ALPHA every IMU_UPDATE_INTERVAL_MS) plus noise
+ *   - a correction blocks loop() for its steps x the step delay, so the
+ *     IMU is not updated while the legs move
+ *   - LEVEL_OK after LEVEL_CONFIRM_MS within the tolerance
+ *
+ * The relay auto-tune (RelayTuner, as `tune` in main.cpp) is first run on
+ * each axis of the model; its Ku and Tu give the gains of the "tuned"
+ * configurations.
+ *
+ * With the attitude predictor (AttitudePredictor, `predict on`), the
+ * controller and the tolerance check act on its estimate instead of the
+ * IMU angle, as in handleLevelingState(). With the settle gate
+ * (SettleDetector, `settle on`), the next correction after a move waits
+ * for its response instead of the LEVEL_CHECK_INTERVAL_MS tick, and level
+ * is confirmed once settled within the tolerance.
+ *
+ * Each controller configuration is run over the same scenarios and the
+ * time to LEVEL_OK (from the disturbance, where there is one), the number
+ * of corrections, the steps moved, the mean settle time per correction
+ * (settle gate only) and the overshoot (largest true tilt past the target,
+ * against the initial error) are printed.
+ *
+ * Build and run from bench/:  make sim
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "LevelingController.h"
+#include "PredictiveController.h"
+#include "RelayTuner.h"
+#include "AttitudePredictor.h"
+#include "SettleDetector.h"
+#include "StepperController.h"
+
+#define SIM_NOISE_DEG 0.02f          // IMU angle noise (1 sigma)
+#define SIM_TIMEOUT_MS 120000UL
+
+struct Scenario {
+    const char* name;
+    float pitch;                // Initial tilt
+    float roll;
+    long pos1;                  // Initial motor positions
+    long pos2;
+    float targetPitch;          // Target attitude (0 = level)
+    float targetRoll;
+    unsigned long flipMs;       // Tilt disturbance at this time (0 = none)
+    float flipPitch;
+    float flipRoll;
+};
+
+// A leg at its lower limit cannot follow the first disturbance; the tilt is
+// then reversed, and an integral wound up against the limit delays recovery
+static const Scenario SCENARIOS[] = {
+    {"small tilt",    1.5f, -1.0f, 35000, 35000, 0, 0, 0, 0, 0},
+    {"large tilt",    6.0f,  4.0f, 35000, 35000, 0, 0, 0, 0, 0},
+    {"limit, flip",  -2.0f,  2.0f,   200, 35000, 0, 0, 20000, 4.0f, -4.0f},
+    {"target step",   0.0f,  0.0f, 35000, 35000, 1.0f, -1.0f, 0, 0, 0},
+};
+
+struct Config {
+    const char* name;
+    bool fixedDt;               // Integrate per call, as before the time base
+    float antiWindup;
+    float kdPitch;
+    float kdRoll;
+    float setpointWeight;
+    bool scheduled;             // Default gain schedule, else flat 1.0
+    bool tuned;                 // Gains from the relay auto-tune with this rule
+    TuneRule rule;
+    bool mpc;                   // PredictiveController instead of the PI
+    bool predictor;             // Act on AttitudePredictor's estimate
+    bool settle;                // SettleDetector gate instead of the fixed tick
+};
+
+static const Config CONFIGS[] = {
+    {"PI per call, clamp only",     true,  0.0f,                0, 0, 1.0f, false, false, TuneRule::SIMC, false, false, false},
+    {"PI, dt + back-calculation",   false, ANTIWINDUP_TRACKING, 0, 0, 1.0f, false, false, TuneRule::SIMC, false, false, false},
+    {"PID (Kd 10/5)",               false, ANTIWINDUP_TRACKING, 10.0f, 5.0f, 1.0f, false, false, TuneRule::SIMC, false, false, false},
+    {"PID, setpoint weight 0.5",    false, ANTIWINDUP_TRACKING, 10.0f, 5.0f, 0.5f, false, false, TuneRule::SIMC, false, false, false},
+    {"PI, gain schedule",           false, ANTIWINDUP_TRACKING, 0, 0, 1.0f, true,  false, TuneRule::SIMC, false, false, false},
+    {"PI, tuned (Ziegler-Nichols)", false, ANTIWINDUP_TRACKING, 0, 0, 1.0f, false, true,  TuneRule::ZIEGLER_NICHOLS, false, false, false},
+    {"PI, tuned (Tyreus-Luyben)",   false, ANTIWINDUP_TRACKING, 0, 0, 1.0f, false, true,  TuneRule::TYREUS_LUYBEN, false, false, false},
+    {"PI, tuned (SIMC)",            false, ANTIWINDUP_TRACKING, 0, 0, 1.0f, false, true,  TuneRule::SIMC, false, false, false},
+    {"MPC (horizon 8)",             false, 0.0f,                0, 0, 1.0f, false, false, TuneRule::SIMC, true,  false, false},
+    {"PI + predictor",              false, ANTIWINDUP_TRACKING, 0, 0, 1.0f, false, false, TuneRule::SIMC, false, true,  false},
+    {"PI, schedule + predictor",    false, ANTIWINDUP_TRACKING, 0, 0, 1.0f, true,  false, TuneRule::SIMC, false, true,  false},
+    {"MPC + predictor",             false, 0.0f,                0, 0, 1.0f, false, false, TuneRule::SIMC, true,  true,  false},
+    {"PI, schedule + settle gate",  false, ANTIWINDUP_TRACKING, 0, 0, 1.0f, true,  false, TuneRule::SIMC, false, false, true},
+    {"PI, schedule + pred. + settle", false, ANTIWINDUP_TRACKING, 0, 0, 1.0f, true, false, TuneRule::SIMC, false, true, true},
+    {"MPC + predictor + settle",    false, 0.0f,                0, 0, 1.0f, false, false, TuneRule::SIMC, true,  true,  true},
+};
+
+// Relay auto-tune result per axis (0 = pitch, 1 = roll)
+static float tunedKu[2];
+static float tunedTu[2];
+
+struct Result {
+    unsigned long levelMs;      // 0 = not reached
+    int corrections;
+    long steps;                 // Both motors, from the disturbance
+    unsigned long settleMs;     // Sum of the settle times
+    float overshoot;
+};
+
+static float gaussian() {
+    // Box-Muller from rand(), seeded per run for repeatable noise
+    float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+    float u2 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+    return sqrtf(-2.0f * logf(u1)) * cosf(2.0f * (float)M_PI * u2);
+}
+
+// Overshoot of one axis: how far the true tilt went past the target,
+// against the direction of the initial error
+static float pastTarget(float tilt, float target, float initialError) {
+    if (initialError == 0) return 0;
+    float past = (tilt - target) * (initialError > 0 ? -1.0f : 1.0f);
+    return past > 0 ? past : 0;
+}
+
+// Model tilt of one axis (0 = pitch, 1 = roll) from the motor moves
+static float tiltOf(int axis, float base, long d1, long d2) {
+    return axis == 0 ? base + PLANT_M1_PITCH_PER_STEP * d1 + PLANT_M2_PITCH_PER_STEP * d2
+                     : base + PLANT_M1_ROLL_PER_STEP * d1 + PLANT_M2_ROLL_PER_STEP * d2;
+}
+
+// Relay experiment on one axis as serviceAutoTune() runs it
+static bool tune(int axis, float& ku, float& tu) {
+    srand(7);
+    StepperController motors;
+    motors.begin();
+    motors.setPosition1(35000);
+    motors.setPosition2(35000);
+    LevelingController leveling;
+
+    RelayTuner tuner;
+    float imuAngle = 0;
+    unsigned long lastImu = 0;
+    unsigned long lastControl = 0;
+    tuner.begin(0, 0.0f, AUTOTUNE_RELAY_STEPS / leveling.getStepsPerDegree(), AUTOTUNE_HYSTERESIS_DEG);
+
+    for (unsigned long t = 1; tuner.isRunning(); t++) {
+        float angle = tiltOf(axis, 0.0f, motors.getPosition1() - 35000, motors.getPosition2() - 35000);
+        if (t - lastImu >= IMU_UPDATE_INTERVAL_MS) {
+            lastImu = t;
+            imuAngle += COMPLEMENTARY_ALPHA * (angle + SIM_NOISE_DEG * gaussian() - imuAngle);
+        }
+        if (t - lastControl < LEVEL_CHECK_INTERVAL_MS) continue;
+        lastControl = t;
+
+        float u = tuner.update(t, imuAngle);
+        if (!tuner.isRunning()) break;
+        int steps = lroundf(u * leveling.getStepsPerDegree());
+        MotorCorrection c = {axis == 0 ? steps : -steps, -steps};
+        MotorCorrection applied = motors.applyCorrection(c);
+        t += max(abs(applied.motor1Steps), abs(applied.motor2Steps)) * STEP_DELAY_US / 1000;
+    }
+
+    ku = tuner.getUltimateGain();
+    tu = tuner.getUltimatePeriod();
+    if (tuner.getState() != RelayTuner::State::DONE) {
+        printf("relay tune %s: failed (%s)\n", axis == 0 ? "pitch" : "roll", tuner.getFailure());
+        return false;
+    }
+    printf("relay tune %-5s: Ku %.2f, Tu %.2f s, amplitude %.3f deg\n",
+           axis == 0 ? "pitch" : "roll", ku, tu, tuner.getAmplitude());
+    return true;
+}
+
+static Result run(const Config& cfg, const Scenario& sc) {
+    srand(42);
+    StepperController motors;
+    motors.begin();
+    motors.setPosition1(sc.pos1);
+    motors.setPosition2(sc.pos2);
+
+    LevelingController leveling;
+    leveling.setDerivativeGains(cfg.kdPitch, cfg.kdRoll);
+    leveling.setAntiWindup(cfg.antiWindup);
+    leveling.setSetpointWeight(cfg.setpointWeight);
+    if (cfg.tuned) {
+        float kp, ki;
+        RelayTuner::computeGains(cfg.rule, tunedKu[0], tunedTu[0], kp, ki);
+        leveling.setPitchGains(kp, ki);
+        RelayTuner::computeGains(cfg.rule, tunedKu[1], tunedTu[1], kp, ki);
+        leveling.setRollGains(kp, ki);
+    }
+    if (!cfg.scheduled) {
+        GainSchedule flat = LevelingController::defaultSchedule();
+        for (int i = 0; i < GAIN_SCHEDULE_POINTS; i++) {
+            flat.errorScale[i] = 1.0f;
+            flat.positionScale[i] = 1.0f;
+        }
+        leveling.setSchedule(flat);
+    }
+    leveling.reset();
+    PredictiveController mpc;
+    mpc.setLimits(motors.getMinPosition(), motors.getMaxPosition());
+    AttitudePredictor predictor;
+    predictor.reset(sc.pitch, sc.roll);
+    SettleDetector settle;
+
+    float basePitch = sc.pitch;
+    float baseRoll = sc.roll;
+    float targetPitch = sc.targetPitch;
+    float targetRoll = sc.targetRoll;
+    leveling.setTarget(targetPitch, targetRoll);
+    mpc.setTarget(targetPitch, targetRoll);
+    float errPitch = sc.pitch - targetPitch;
+    float errRoll = sc.roll - targetRoll;
+
+    float imuPitch = sc.pitch;
+    float imuRoll = sc.roll;
+    unsigned long lastImu = 0;
+    unsigned long lastControl = 0;
+    unsigned long levelSince = 0;
+    bool withinTolerance = false;
+    bool flipped = false;
+
+    Result r = {0, 0, 0, 0, 0};
+    for (unsigned long t = 1; t < SIM_TIMEOUT_MS; t++) {
+        if (sc.flipMs && !flipped && t >= sc.flipMs) {
+            flipped = true;
+            basePitch += sc.flipPitch;
+            baseRoll += sc.flipRoll;
+            errPitch = sc.flipPitch;
+            errRoll = sc.flipRoll;
+            r.overshoot = 0;
+            r.steps = 0;
+            r.corrections = 0;
+            r.settleMs = 0;
+            settle.reset();
+            withinTolerance = false;
+            predictor.reset(imuPitch, imuRoll);  // LEVELING entry: the IMU has not seen the flip yet
+        }
+
+        float pitch = tiltOf(0, basePitch, motors.getPosition1() - sc.pos1, motors.getPosition2() - sc.pos2);
+        float roll = tiltOf(1, baseRoll, motors.getPosition1() - sc.pos1, motors.getPosition2() - sc.pos2);
+        r.overshoot = fmaxf(r.overshoot, fmaxf(pastTarget(pitch, targetPitch, errPitch),
+                                               pastTarget(roll, targetRoll, errRoll)));
+
+        bool sampled = false;
+        if (t - lastImu >= IMU_UPDATE_INTERVAL_MS) {
+            lastImu = t;
+            sampled = true;
+            imuPitch += COMPLEMENTARY_ALPHA * (pitch + SIM_NOISE_DEG * gaussian() - imuPitch);
+            imuRoll += COMPLEMENTARY_ALPHA * (roll + SIM_NOISE_DEG * gaussian() - imuRoll);
+            predictor.update(imuPitch, imuRoll);
+        }
+        float ctrlPitch = cfg.predictor ? predictor.getPitch() : imuPitch;
+        float ctrlRoll = cfg.predictor ? predictor.getRoll() : imuRoll;
+        if (sampled) settle.update(t, ctrlPitch, ctrlRoll);
+
+        bool due;
+        if (cfg.settle && settle.isWaiting()) {
+            due = sampled && settle.ready(t, ctrlPitch - targetPitch, ctrlRoll - targetRoll, LEVEL_TOLERANCE_DEG);
+            if (due) r.settleMs += settle.getSettleMs();
+        } else {
+            due = t - lastControl >= LEVEL_CHECK_INTERVAL_MS;
+        }
+        if (!due) continue;
+        float dt = cfg.fixedDt ? LEVEL_CHECK_INTERVAL_MS / 1000.0f : (t - lastControl) / 1000.0f;
+        lastControl = t;
+
+        if (fabsf(ctrlPitch - targetPitch) < LEVEL_TOLERANCE_DEG && fabsf(ctrlRoll - targetRoll) < LEVEL_TOLERANCE_DEG) {
+            if (!withinTolerance) {
+                withinTolerance = true;
+                levelSince = t;
+            } else if (t - levelSince >= LEVEL_CONFIRM_MS) {
+                if (sc.flipMs && !flipped) {
+                    t = sc.flipMs - 1;      // Wait at LEVEL_OK for the disturbance
+                    continue;
+                }
+                r.levelMs = t - (flipped ? sc.flipMs : 0);
+                return r;
+            }
+        } else {
+            withinTolerance = false;
+            MotorCorrection correction;
+            if (cfg.mpc) {
+                correction = mpc.calculate(ctrlPitch, ctrlRoll, motors.getPosition1(), motors.getPosition2());
+            } else {
+                leveling.setMotorPositions(motors.getPosition1(), motors.getPosition2());
+                correction = leveling.calculate(ctrlPitch, ctrlRoll, dt);
+            }
+            if (correction.motor1Steps != 0 || correction.motor2Steps != 0) {
+                MotorCorrection applied = motors.applyCorrection(correction);
+                if (!cfg.mpc) leveling.reportApplied(correction, applied);
+                predictor.addMove(applied);
+                r.corrections++;
+                r.steps += labs(applied.motor1Steps) + labs(applied.motor2Steps);
+                // loop() is blocked while the legs move
+                unsigned long moveMs = max(labs(applied.motor1Steps), labs(applied.motor2Steps)) * STEP_DELAY_US / 1000;
+                t += moveMs;
+                settle.begin(t, applied);
+            }
+        }
+    }
+    return r;
+}
+
+int main() {
+    bool tuned = tune(0, tunedKu[0], tunedTu[0]) && tune(1, tunedKu[1], tunedTu[1]);
+    printf("\n");
+    printf("%-30s %-12s %10s %12s %8s %11s %10s\n", "controller", "scenario", "level (s)", "corrections", "steps",
+           "settle (ms)", "overshoot");
+    for (const Config& cfg : CONFIGS) {
+        if (cfg.tuned && !tuned) continue;
+        for (const Scenario& sc : SCENARIOS) {
+            Result r = run(cfg, sc);
+            char level[16];
+            if (r.levelMs) snprintf(level, sizeof(level), "%.1f", r.levelMs / 1000.0f);
+            else snprintf(level, sizeof(level), "timeout");
+            char settleMs[16];
+            if (cfg.settle && r.corrections) snprintf(settleMs, sizeof(settleMs), "%lu", r.settleMs / r.corrections);
+            else snprintf(settleMs, sizeof(settleMs), "-");
+            printf("%-30s %-12s %10s %12d %8ld %11s %9.2f°\n", cfg.name, sc.name, level, r.corrections, r.steps, settleMs,
+                   r.overshoot);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * Host shim for the Arduino API - just enough for the control-path
+ * libraries (MPU6050Handler, LevelingController, StepperController,
+ * SerialConsole, DashboardProtocol) to build natively under bench/.
+ *
+ * Timing calls do not wait, GPIO writes land in shimPins (LEDC duty in
+ * shimDuty), and Serial
+ * output is discarded, so benchmarks measure computation only.
+ */
+
+#ifndef BENCH_SHIM_ARDUINO_H
+#define BENCH_SHIM_ARDUINO_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define HALF_PI 1.5707963267948966192313216916398
+#define RAD_TO_DEG 57.295779513082320876798154814105
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define PROGMEM
+#define IRAM_ATTR
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+extern volatile uint8_t shimPins[40];
+extern volatile uint32_t shimDuty[16];
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+inline double ledcSetup(uint8_t, double freq, uint8_t) { return freq; }
+inline void ledcAttachPin(uint8_t, uint8_t) {}
+inline void ledcDetachPin(uint8_t) {}
+void ledcWrite(uint8_t channel, uint32_t duty);
+
+class HardwareSerial {
+public:
+    void begin(unsigned long) {}
+    size_t printf(const char*, ...) __attribute__((format(printf, 2, 3))) { return 0; }
+    size_t print(const char*) { return 0; }
+    size_t println(const char* = "") { return 0; }
+    size_t write(const uint8_t*, size_t len) { return len; }
+    int availableForWrite() { return 1024; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // BENCH_SHIM_ARDUINO_H
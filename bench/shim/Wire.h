@@ -0,0 +1,35 @@
+/**
+ * Host shim for Wire: reads return MPU6050 sample frames from
+ * shimSetImuSamples() in turn, writes are ignored.
+ */
+
+#ifndef BENCH_SHIM_WIRE_H
+#define BENCH_SHIM_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+    void begin(int = -1, int = -1) {}
+    void setClock(uint32_t) {}
+    void beginTransmission(uint8_t) {}
+    uint8_t endTransmission(bool = true) { return 0; }
+    size_t write(uint8_t) { return 1; }
+    uint8_t requestFrom(uint8_t address, uint8_t length);
+    int available() { return _left; }
+    int read() { return _left > 0 ? (_left--, *_next++) : -1; }
+
+private:
+    const uint8_t* _next = nullptr;
+    int _left = 0;
+};
+
+extern TwoWire Wire;
+
+/**
+ * Frames of 14 bytes (accel XYZ, temperature, gyro XYZ, big-endian) served
+ * round-robin by requestFrom
+ */
+void shimSetImuSamples(const uint8_t* frames, size_t count);
+
+#endif // BENCH_SHIM_WIRE_H
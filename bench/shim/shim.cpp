@@ -0,0 +1,57 @@
+#include <chrono>
+#include "Arduino.h"
+#include "Wire.h"
+
+HardwareSerial Serial;
+TwoWire Wire;
+volatile uint8_t shimPins[40];
+volatile uint32_t shimDuty[16];
+
+static const auto shimStart = std::chrono::steady_clock::now();
+
+unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - shimStart).count();
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
+
+void delay(unsigned long) {}
+void delayMicroseconds(unsigned int) {}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    shimPins[pin % 40] = value;
+}
+
+int digitalRead(uint8_t pin) {
+    return shimPins[pin % 40];
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+    shimDuty[channel % 16] = duty;
+}
+
+static const uint8_t* imuFrames = nullptr;
+static size_t imuFrameCount = 0;
+static size_t imuFrameNext = 0;
+
+void shimSetImuSamples(const uint8_t* frames, size_t count) {
+    imuFrames = frames;
+    imuFrameCount = count;
+    imuFrameNext = 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t, uint8_t length) {
+    if (imuFrameCount == 0 || length > 14) {
+        _left = 0;
+        return 0;
+    }
+    _next = imuFrames + 14 * imuFrameNext;
+    _left = length;
+    imuFrameNext = (imuFrameNext + 1) % imuFrameCount;
+    return length;
+}
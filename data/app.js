@@ -3,19 +3,36 @@ var ws, reconnTimer;
 
 function connect() {
     ws = new WebSocket('ws://' + location.host + '/ws');
+    ws.binaryType = 'arraybuffer';
     ws.onopen = function() {
         document.getElementById('connDot').className = 'dot green';
         termLog('[Connected]');
+        send({cmd: 'sched'});
     };
     ws.onclose = function() {
         document.getElementById('connDot').className = 'dot red';
         reconnTimer = setTimeout(connect, 2000);
     };
     ws.onmessage = function(e) {
+        if (e.data instanceof ArrayBuffer) {
+            var v = new DataView(e.data);
+            if (v.byteLength > 0 && v.getUint8(0) === FRAME_STREAM) {
+                decodeStreamBatch(v);
+                return;
+            }
+            var st = decodeFrame(v);
+            if (st) updateDashboard(st);
+            return;
+        }
         try {
             var d = JSON.parse(e.data);
             if (d.t === 'status') updateDashboard(d);
             else if (d.t === 'log') termLog(d.msg);
+            else if (d.t === 'wsstats') showWsStats(d);
+            else if (d.t === 'perf') showPerf(d);
+            else if (d.t === 'timing') showTiming(d);
+            else if (d.t === 'sched') showSchedule(d);
+            else if (d.t === 'gains') showGains(d);
         } catch(err) {}
     };
 }
@@ -24,6 +41,173 @@ function send(obj) {
     if (ws && ws.readyState === WebSocket.OPEN) ws.send(JSON.stringify(obj));
 }
 
+// Binary commands: [opcode][arguments, little-endian], see
+// lib/WebDashboard/DashboardCommands.h. Used for the frequent motor and
+// stream commands; everything else stays JSON.
+var OP = {SUB: 0x01, HSTREAM: 0x02, MOTOR: 0x04, BOTH: 0x05, MSTOP: 0x06,
+          MSPEED: 0x07, MRESET: 0x09, MRESET1: 0x0A, MRESET2: 0x0B};
+var OP_SIZES = {u8: 1, u16: 2, i32: 4, u32: 4, f32: 4};
+
+// sendOp(OP.MOTOR, 'u8', 1, 'i32', 100)
+function sendOp(op) {
+    var len = 1, i;
+    for (i = 1; i < arguments.length; i += 2) len += OP_SIZES[arguments[i]];
+    var v = new DataView(new ArrayBuffer(len)), o = 1;
+    v.setUint8(0, op);
+    for (i = 1; i < arguments.length; i += 2) {
+        var t = arguments[i], x = arguments[i + 1];
+        if (t === 'u8') v.setUint8(o, x);
+        else if (t === 'u16') v.setUint16(o, x, true);
+        else if (t === 'i32') v.setInt32(o, x, true);
+        else if (t === 'u32') v.setUint32(o, x >>> 0, true);
+        else v.setFloat32(o, x, true);
+        o += OP_SIZES[t];
+    }
+    if (ws && ws.readyState === WebSocket.OPEN) ws.send(v.buffer);
+}
+
+// Status subscription: fields = list of STATUS_FIELDS names on the firmware
+// (omit for all), hz = max update rate (capped at the control-loop rate).
+// New connections get every field at 10 Hz until they subscribe.
+function subscribe(fields, hz) {
+    var msg = {cmd: 'sub', hz: hz};
+    if (fields) msg.fields = fields;
+    send(msg);
+}
+
+// ==================== Binary Frames ====================
+// Must match lib/WebDashboard/DashboardProtocol.h (little-endian, packed)
+var FRAME_STATUS = 0x01, FRAME_DELTA = 0x02, FRAME_SNAPSHOT = 0x03;
+var STATUS_VERSION = 2, DELTA_VERSION = 2;
+var STATE_NAMES = ['IDLE', 'INITIALIZING', 'WAIT_FOR_STABLE', 'LEVELING',
+                   'LEVEL_OK', 'ERROR', 'TEST_MODE', 'SAFE_SHUTDOWN'];
+
+// Same order as STATUS_FIELDS[] (delta mask bit = index): [name, offset, type, scale]
+var STATUS_FIELDS = [
+    ['stateId', 2, 'u8', 1], ['flags', 3, 'u8', 1],
+    ['pitch', 4, 'i16', 100], ['roll', 6, 'i16', 100],
+    ['ax', 8, 'i16', 1000], ['ay', 10, 'i16', 1000], ['az', 12, 'i16', 1000],
+    ['gx', 14, 'i16', 10], ['gy', 16, 'i16', 10], ['gz', 18, 'i16', 10],
+    ['temp', 20, 'i16', 10],
+    ['m1', 22, 'i32', 1], ['m2', 26, 'i32', 1], ['mMin', 30, 'i32', 1], ['mMax', 34, 'i32', 1],
+    ['stMs', 38, 'u32', 1], ['up', 42, 'u32', 1],
+    ['tol', 46, 'f32', 1], ['kpP', 50, 'f32', 1], ['kiP', 54, 'f32', 1],
+    ['kpR', 58, 'f32', 1], ['kiR', 62, 'f32', 1],
+    ['settle', 66, 'i16', 1]
+];
+var FIELD_SIZE = {u8: 1, i16: 2, i32: 4, u32: 4, f32: 4};
+var STATUS_SIZE = 68;
+
+var liveStatus = null;  // Current status, rebuilt from keyframes + deltas
+
+function readField(v, off, type, scale) {
+    switch (type) {
+        case 'u8':  return v.getUint8(off);
+        case 'i16': return v.getInt16(off, true) / scale;
+        case 'i32': return v.getInt32(off, true);
+        case 'u32': return v.getUint32(off, true);
+        default:    return v.getFloat32(off, true);
+    }
+}
+
+function decodeFrame(v) {
+    if (v.byteLength < 2) return null;
+    var type = v.getUint8(0), ver = v.getUint8(1);
+    if (type === FRAME_STATUS && ver === STATUS_VERSION && v.byteLength >= STATUS_SIZE) {
+        liveStatus = {};
+        STATUS_FIELDS.forEach(function(f) { liveStatus[f[0]] = readField(v, f[1], f[2], f[3]); });
+    } else if ((type === FRAME_DELTA && liveStatus) || type === FRAME_SNAPSHOT) {
+        if (ver !== DELTA_VERSION) return null;
+        // Snapshot: subset keyframe, start from scratch
+        if (type === FRAME_SNAPSHOT) liveStatus = {};
+        // Apply only the fields flagged in the mask, packed in table order
+        var mask = v.getUint32(2, true), off = 6;
+        for (var i = 0; i < STATUS_FIELDS.length && off < v.byteLength; i++) {
+            if (!(mask & (1 << i))) continue;
+            var f = STATUS_FIELDS[i];
+            liveStatus[f[0]] = readField(v, off, f[2], f[3]);
+            off += FIELD_SIZE[f[2]];
+        }
+    } else {
+        return null;  // Unknown frame, or delta before the first keyframe
+    }
+    liveStatus.state = STATE_NAMES[liveStatus.stateId] || 'UNKNOWN';
+    liveStatus.cal = !!(liveStatus.flags & 0x01);
+    liveStatus.level = !!(liveStatus.flags & 0x02);
+    liveStatus.m1Lim = !!(liveStatus.flags & 0x04);
+    liveStatus.m2Lim = !!(liveStatus.flags & 0x08);
+    return liveStatus;
+}
+
+// ==================== High-Rate Stream ====================
+// Must match lib/TelemetryStream/TelemetryStream.h
+var FRAME_STREAM = 0x10, STREAM_VERSION = 1;
+var STREAM_HEADER = 10, STREAM_SAMPLE = 28;
+var HS_WINDOW = 2000;  // Samples kept for the plot
+
+var hs = {next: null, samples: 0, lost: 0, rate: 0, pitch: [], roll: [], drawPending: false};
+
+function startHiStream() {
+    hs.next = null; hs.samples = 0; hs.lost = 0;
+    hs.pitch = []; hs.roll = [];
+    sendOp(OP.HSTREAM, 'u16', parseInt(document.getElementById('hsRate').value) || 100);
+}
+
+function stopHiStream() {
+    sendOp(OP.HSTREAM, 'u16', 0);
+}
+
+function decodeStreamBatch(v) {
+    if (v.byteLength < STREAM_HEADER || v.getUint8(1) !== STREAM_VERSION) return;
+    var count = v.getUint8(2), seq = v.getUint32(4, true);
+    hs.rate = v.getUint16(8, true);
+    if (v.byteLength < STREAM_HEADER + count * STREAM_SAMPLE) return;
+
+    // Batches carry the sequence number of their first sample
+    if (hs.next !== null && seq !== hs.next) hs.lost += (seq - hs.next) >>> 0;
+    hs.next = (seq + count) >>> 0;
+    hs.samples += count;
+
+    for (var i = 0, off = STREAM_HEADER; i < count; i++, off += STREAM_SAMPLE) {
+        hs.pitch.push(v.getInt16(off + 4, true) / 1000);
+        hs.roll.push(v.getInt16(off + 6, true) / 1000);
+    }
+    if (hs.pitch.length > HS_WINDOW) {
+        hs.pitch.splice(0, hs.pitch.length - HS_WINDOW);
+        hs.roll.splice(0, hs.roll.length - HS_WINDOW);
+    }
+    if (!hs.drawPending) {
+        hs.drawPending = true;
+        requestAnimationFrame(drawHiStream);
+    }
+}
+
+function drawHiStream() {
+    hs.drawPending = false;
+    var cv = document.getElementById('hsPlot'), c = cv.getContext('2d');
+    var w = cv.width, h = cv.height, n = hs.pitch.length;
+    c.clearRect(0, 0, w, h);
+    c.strokeStyle = '#1a3a5c'; c.lineWidth = 1;
+    c.beginPath(); c.moveTo(0, h / 2); c.lineTo(w, h / 2); c.stroke();
+    if (n < 2) return;
+
+    // Autoscale to the visible window, at least +/-0.1 deg
+    var span = 0.1;
+    for (var i = 0; i < n; i++) span = Math.max(span, Math.abs(hs.pitch[i]), Math.abs(hs.roll[i]));
+    [[hs.pitch, '#3498db'], [hs.roll, '#e67e22']].forEach(function(tr) {
+        c.strokeStyle = tr[1];
+        c.beginPath();
+        for (var i = 0; i < n; i++) {
+            var x = i * w / (HS_WINDOW - 1), y = h / 2 - tr[0][i] / span * (h / 2 - 2);
+            if (i === 0) c.moveTo(x, y); else c.lineTo(x, y);
+        }
+        c.stroke();
+    });
+    document.getElementById('hsStats').textContent =
+        hs.rate + ' Hz, ' + hs.samples + ' samples, ' + hs.lost + ' lost, \u00B1' + span.toFixed(3) +
+        '\u00B0 (pitch blue, roll orange)';
+}
+
 // ==================== Tab Switching ====================
 document.querySelectorAll('.tab').forEach(function(btn) {
     btn.addEventListener('click', function() {
@@ -36,23 +220,26 @@ document.querySelectorAll('.tab').forEach(function(btn) {
 
 // ==================== Dashboard Updates ====================
 function updateDashboard(d) {
-    document.getElementById('pitch').textContent = Number(d.pitch).toFixed(2);
-    document.getElementById('roll').textContent = Number(d.roll).toFixed(2);
+    document.getElementById('pitch').textContent = d.pitch.toFixed(2);
+    document.getElementById('roll').textContent = d.roll.toFixed(2);
 
     var badge = document.getElementById('state');
     badge.textContent = d.state;
     badge.className = 'badge badge-' + d.state.toLowerCase();
 
-    drawBubble(Number(d.pitch), Number(d.roll), d.level);
+    drawBubble(d.pitch, d.roll, d.level);
     updateBar('m1bar', 'm1val', d.m1, d.mMin, d.mMax, d.m1Lim);
     updateBar('m2bar', 'm2val', d.m2, d.mMin, d.mMax, d.m2Lim);
 
     // IMU data
-    document.getElementById('accel').textContent = d.ax + ', ' + d.ay + ', ' + d.az + ' g';
-    document.getElementById('gyro').textContent = d.gx + ', ' + d.gy + ', ' + d.gz + ' \u00B0/s';
-    document.getElementById('temp').textContent = d.temp + ' \u00B0C';
+    document.getElementById('accel').textContent =
+        d.ax.toFixed(3) + ', ' + d.ay.toFixed(3) + ', ' + d.az.toFixed(3) + ' g';
+    document.getElementById('gyro').textContent =
+        d.gx.toFixed(1) + ', ' + d.gy.toFixed(1) + ', ' + d.gz.toFixed(1) + ' \u00B0/s';
+    document.getElementById('temp').textContent = d.temp.toFixed(1) + ' \u00B0C';
     document.getElementById('cal').textContent = d.cal ? 'Yes' : 'No';
     document.getElementById('uptime').textContent = formatUptime(d.up);
+    if (d.settle !== undefined) document.getElementById('settle').textContent = d.settle + ' ms';
 
     // Motor limits tab position display
     document.getElementById('m1limpos').textContent = d.m1;
@@ -122,12 +309,12 @@ function drawBubble(pitch, roll, isLevel) {
 
 // ==================== Motor Commands ====================
 function mv(motor, steps) {
-    send({cmd: 'motor', id: motor, steps: steps});
+    sendOp(OP.MOTOR, 'u8', motor, 'i32', steps);
 }
 
 function mvBoth(steps) {
     // M2 direction reversed
-    send({cmd: 'both', m1: steps, m2: -steps});
+    sendOp(OP.BOTH, 'i32', steps, 'i32', -steps);
 }
 
 // ==================== Settings ====================
@@ -141,6 +328,18 @@ function sendGains() {
     });
 }
 
+// Relay auto-tune of both axes (test mode); progress arrives as log lines
+// and the resulting gains as {"t":"gains"}
+function sendTune() {
+    send({cmd: 'tune', rule: document.getElementById('tuneRule').value});
+}
+
+function showGains(d) {
+    ['kpP', 'kiP', 'kpR', 'kiR'].forEach(function(k) {
+        document.getElementById(k).value = d[k];
+    });
+}
+
 function sendTol() {
     send({cmd: 'tolerance', deg: parseFloat(document.getElementById('tol').value)});
 }
@@ -149,6 +348,32 @@ function sendStabTimeout() {
     send({cmd: 'stabTimeout', sec: parseFloat(document.getElementById('stabTimeout').value)});
 }
 
+// Gain schedule: two tables of four [breakpoint, scale] points. Each
+// table is sent whole; the device rejects breakpoints that are not
+// ascending and answers with the schedule in effect.
+var SCHED_TABLES = [['schedEk', 'schedEs', 'e'], ['schedPk', 'schedPs', 'p']];
+
+function sendSchedule() {
+    SCHED_TABLES.forEach(function(t, table) {
+        var keys = [], scales = [];
+        for (var i = 0; i < 4; i++) {
+            keys.push(parseFloat(document.getElementById(t[0] + i).value));
+            scales.push(parseFloat(document.getElementById(t[1] + i).value));
+        }
+        send({cmd: 'sched', table: table, keys: keys, scales: scales});
+    });
+}
+
+function showSchedule(d) {
+    SCHED_TABLES.forEach(function(t) {
+        d[t[2]].forEach(function(p, i) {
+            document.getElementById(t[0] + i).value = p[0];
+            document.getElementById(t[1] + i).value = p[1];
+        });
+    });
+    document.getElementById('schedStatus').textContent = d.ok ? '' : 'Rejected: breakpoints must ascend, scales 0-5';
+}
+
 // ==================== Motor Limits Tab ====================
 var limitStep = 100;
 var limits = { m1in: null, m1out: null, m2in: null, m2out: null };
@@ -165,17 +390,16 @@ function mvLimit(motor, dir) {
     var steps = limitStep * dir;
     // M2 reversed
     if (motor === 2) steps = -steps;
-    send({cmd: 'motor', id: motor, steps: steps});
+    sendOp(OP.MOTOR, 'u8', motor, 'i32', steps);
 }
 
 function mvBothLimit(dir) {
     var steps = limitStep * dir;
-    send({cmd: 'both', m1: steps, m2: -steps});
+    sendOp(OP.BOTH, 'i32', steps, 'i32', -steps);
 }
 
 function zeroMotor(motor) {
-    if (motor === 1) send({cmd: 'mreset1'});
-    else send({cmd: 'mreset2'});
+    sendOp(motor === 1 ? OP.MRESET1 : OP.MRESET2);
 }
 
 function setIN(motor) {
@@ -247,5 +471,74 @@ function sendTerminal() {
     input.value = '';
 }
 
+// ==================== System Tab ====================
+function showWsStats(d) {
+    // One row per client: frames sent / coalesced, text queue depth / dropped
+    var el = document.getElementById('wsStats');
+    var html = '<span class="dlbl">Heap</span><span class="dval">' + d.heap + ' B</span>';
+    d.clients.forEach(function(c) {
+        html += '<span class="dlbl">#' + c.id + '</span><span class="dval">sent ' + c.sent +
+                ', coalesced ' + c.coal + ', queue ' + c.depth + ', dropped ' + c.drop + '</span>';
+    });
+    el.innerHTML = html;
+}
+
+// Control interval histograms, one message per monitor (imu, ctrl);
+// times in ms, h[i] counts intervals in [2^(h0+i), 2^(h0+i+1)) us
+var timingRows = {};
+function requestTiming(reset) {
+    timingRows = {};
+    send({cmd: 'timing', reset: reset ? 1 : 0});
+}
+
+function fmtMs(us) {
+    return us >= 1000 ? (us / 1000).toFixed(us < 10000 ? 1 : 0) + ' ms' : us + ' us';
+}
+
+function showTiming(d) {
+    timingRows[d.n] = d;
+    var html = '';
+    Object.keys(timingRows).forEach(function(k) {
+        var t = timingRows[k];
+        html += '<span class="dlbl">' + t.n + '</span><span class="dval">n ' + t.c +
+                ', mean ' + t.avg + ', p99 ' + t.p99 + ', max ' + t.max + ' ms<br>' +
+                t.miss + ' misses over ' + t.dl + ' ms' +
+                (t.ws ? ', worst ' + t.w + ' ms in ' + t.ws : '') + '</span>';
+        var peak = Math.max.apply(null, t.h.concat([1]));
+        t.h.forEach(function(n, i) {
+            if (!n) return;
+            var b = t.h0 + i;
+            var bar = new Array(Math.max(1, Math.round(20 * n / peak)) + 1).join('\u2588');
+            html += '<span class="dlbl">' + fmtMs(Math.pow(2, b)) + '</span><span class="dval">' +
+                    bar + ' ' + n + '</span>';
+        });
+    });
+    document.getElementById('timingStats').innerHTML = html;
+}
+
+// Loop stage timing; a report may span several messages, rows are
+// [stage, count, min, mean, p99, max] in microseconds
+var perfRows = {};
+function requestPerf(reset) {
+    perfRows = {};
+    send({cmd: 'perf', reset: reset ? 1 : 0});
+}
+
+function showPerf(d) {
+    var el = document.getElementById('perfStats');
+    if (!d.on) {
+        el.innerHTML = '<span class="dlbl">Stages</span><span class="dval">profiler not built in</span>';
+        return;
+    }
+    d.s.forEach(function(r) { perfRows[r[0]] = r; });
+    var html = '';
+    Object.keys(perfRows).forEach(function(k) {
+        var r = perfRows[k];
+        html += '<span class="dlbl">' + r[0] + '</span><span class="dval">n ' + r[1] +
+                ', min ' + r[2] + ', mean ' + r[3] + ', p99 ' + r[4] + ', max ' + r[5] + ' us</span>';
+    });
+    el.innerHTML = html;
+}
+
 // ==================== Start ====================
 connect();
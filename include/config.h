@@ -73,9 +73,100 @@
 #define DEFAULT_KP_ROLL 0.5f
 #define DEFAULT_KI_ROLL 0.03f
 
+// Derivative (0 = PI) acts on the measured angle, not the error, and is
+// low-pass filtered so IMU noise and step vibration do not reach the motors
+#define DEFAULT_KD_PITCH 0.0f
+#define DEFAULT_KD_ROLL 0.0f
+#define DERIVATIVE_FILTER_S 0.3f     // Time constant of the derivative low-pass
+
+// Weight of the target in the proportional term (1 = plain PI); below 1 a
+// target change is followed by the integral instead of a P kick
+#define DEFAULT_SETPOINT_WEIGHT 1.0f
+
+// Gains are per LEVEL_CHECK_INTERVAL_MS; the integral and derivative use
+// the measured interval, capped at this (first cycle, after a pause)
+#define CONTROL_DT_MAX_S 0.5f
+
 // Integral windup limits
 #define INTEGRAL_LIMIT 100.0f
 
+// Gain schedule (`sched`, dashboard Settings, kept in NVS). Kp and Ki of
+// each axis are scaled by its |error|: more gain far from level for the
+// coarse approach, less near level for gentle settling. Each motor's output
+// is scaled by its position, for plant gain that changes with leg extension
+// (1.0 everywhere until measured).
+#define GAIN_SCHEDULE_POINTS 4
+#define GAIN_SCHED_ERROR_DEG   {0.5f, 1.0f, 2.0f, 4.0f}
+#define GAIN_SCHED_ERROR_SCALE {0.6f, 1.0f, 1.5f, 2.0f}
+#define GAIN_SCHED_POSITION    {0.0f, 23000.0f, 47000.0f, 70000.0f}
+#define GAIN_SCHED_POS_SCALE   {1.0f, 1.0f, 1.0f, 1.0f}
+#define GAIN_SCHED_MAX_SCALE 5.0f
+
+// Relay auto-tune (`tune [zn|tl|simc]` in test mode, or the dashboard):
+// each axis in turn is driven by a fixed correction that flips sign as the
+// angle crosses its starting value. The period and amplitude of the
+// resulting oscillation give Ku and Tu, and from them the PI gains.
+#define AUTOTUNE_RELAY_STEPS 20          // Relay output per control interval (<= MAX_CORRECTION_STEPS)
+#define AUTOTUNE_HYSTERESIS_DEG 0.05f    // Switching band, above the IMU noise
+#define AUTOTUNE_SKIP_CYCLES 2           // Cycles ignored while the oscillation builds up
+#define AUTOTUNE_CYCLES 4                // Cycles averaged
+#define AUTOTUNE_TIMEOUT_MS 120000UL     // Per axis
+#define AUTOTUNE_MAX_DEVIATION_DEG 3.0f  // Abort if the axis strays further from its start
+
+// Back-calculation anti-windup: share of a clipped correction's shortfall
+// (step cap or position limit) taken back off the integral per cycle
+#define ANTIWINDUP_TRACKING 0.5f
+
+// Measured plant: degrees of tilt per motor step. M1 +1000 steps gives
+// pitch -0.22, roll +0.42. M2 was measured as pitch -0.20, roll -0.45 per
+// 1000 steps of leg raise, which is -1000 motor steps (reversed lead screw).
+#define PLANT_M1_PITCH_PER_STEP (-0.22f / 1000.0f)
+#define PLANT_M1_ROLL_PER_STEP  (0.42f / 1000.0f)
+#define PLANT_M2_PITCH_PER_STEP (0.20f / 1000.0f)
+#define PLANT_M2_ROLL_PER_STEP  (0.45f / 1000.0f)
+
+// ============================================================================
+// Predictive Controller
+// ============================================================================
+
+// `mpc on`: instead of the PI controllers, a small QP over the next
+// MPC_HORIZON control intervals plans both motors' steps from the plant
+// gains above, within MAX_CORRECTION_STEPS per interval and the position
+// limits (lib/PredictiveController)
+#define DEFAULT_CONTROLLER_MPC false
+#define MPC_HORIZON 8                // Control intervals planned ahead
+#define MPC_ITERATIONS 40            // Solver iterations (fixed: bounded time)
+#define MPC_STEP_WEIGHT 10.0f        // Cost of a step against the tilt it makes
+#define MPC_TERMINAL_WEIGHT 20.0f    // Cost of the steps still needed after the horizon
+#define MPC_TRAVEL_MARGIN_STEPS 7000 // Penalize legs closer than this to a limit...
+#define MPC_TRAVEL_COST_DEG 0.2f     // ...costing this much tilt error at the limit
+
+// ============================================================================
+// Attitude Predictor
+// ============================================================================
+
+// `predict on`: the leveling loop acts on the attitude dead-reckoned from
+// the steps made (plant gains above), fused with the IMU by a small Kalman
+// filter that models the complementary filter's lag (lib/AttitudePredictor)
+#define DEFAULT_ATTITUDE_PREDICTOR false
+#define PREDICT_GAIN_SIGMA 0.15f     // Plant gain uncertainty (fraction of a move)
+#define PREDICT_DRIFT_DEG 0.005f     // Attitude drift per IMU sample without a move
+#define PREDICT_LAG_SIGMA_DEG 0.005f // Filter model error per IMU sample
+#define PREDICT_IMU_NOISE_DEG 0.01f  // Filtered IMU angle noise
+
+// ============================================================================
+// Settling Detector
+// ============================================================================
+
+// With the settle gate on, the next correction after a move waits for the
+// response (lib/SettleDetector) instead of the LEVEL_CHECK_INTERVAL_MS tick
+#define DEFAULT_SETTLE_GATE true
+#define SETTLE_FILTER 0.3f           // Rate / variance filter weight per IMU sample
+#define SETTLE_RATE_DPS 0.3f         // Settled below this filtered rate...
+#define SETTLE_STDDEV_DEG 0.02f      // ...and this angle standard deviation
+#define SETTLE_MIN_SAMPLES 3         // IMU samples after a move before it can be settled
+#define SETTLE_MAX_MS 500            // Correct anyway after this long
+
 // ============================================================================
 // Motor Parameters
 // ============================================================================
@@ -93,6 +184,57 @@
 #define MOTOR_MIN_POSITION 0
 #define MOTOR_MAX_POSITION 70000
 
+// Sine microstepping (`mstep on`): coil pins driven by LEDC PWM instead of
+// on/off. Positions are still counted in half-steps.
+#define MICROSTEPS_PER_HALFSTEP 16   // 32 microsteps per full step
+#define MICROSTEP_LEDC_CHANNEL 4     // First of 8 channels (4-11); 0-3 share timers with the RGB LED
+#define MICROSTEP_PWM_FREQ 20000     // Hz, above audible range
+#define MICROSTEP_PWM_RESOLUTION 10  // bits (max at 20 kHz is 11)
+
+// Reduced-current hold at LEVEL_OK / IDLE instead of releasing the coils:
+// the last coil pattern is PWMed on the microstepping LEDC channels, and
+// fully released once the timeout passes (`mhold` to change at runtime)
+#define HOLD_DUTY_PERCENT 25         // 0 = release immediately
+#define HOLD_TIMEOUT_MS 300000UL     // 0 = hold until the next move
+
+// Backlash take-up: on a direction reversal, this many extra steps turn the
+// lead screw through its dead band without counting as position. Measured
+// per motor with `backlash cal` in test mode and kept in NVS.
+#define BACKLASH_MAX_STEPS 200
+#define BACKLASH_CAL_PRELOAD 200     // Steps that load the screw before measuring
+#define BACKLASH_CAL_INCREMENT 40    // Reverse steps between IMU readings
+#define BACKLASH_CAL_INCREMENTS 10
+
+// ============================================================================
+// Stall Detection / Adaptive Step Rate
+// ============================================================================
+
+// Missed steps are detected by comparing the settled IMU tilt change after
+// a leveling run (or a `stall cal` move) with PLANT_* x commanded steps
+#define STALL_MIN_SIGNAL_DEG 0.1f    // Expected tilt change needed to judge a motor
+#define STALL_EFFICIENCY_MIN 0.6f    // Measured / expected below this = missed steps
+#define STALL_CAL_EFFICIENCY 0.85f   // `stall cal` keeps delays at or above this
+#define STALL_SETTLE_MS 1500         // IMU filter settling before measuring
+#define STALL_CAL_STEPS 600          // Move size of `stall cal`
+
+// Per motor and direction step delay used for corrections; unlike
+// setSpeed() this may go below 1000 us once it has proven reliable
+#define STALL_MIN_DELAY_US 600
+#define STALL_MAX_DELAY_US 3000
+#define STALL_SPEEDUP_AFTER 3        // Clean checks before trying 10% faster
+
+// ============================================================================
+// Motion Planner
+// ============================================================================
+
+// Queued moves (m1, m2, mto, mcont, dashboard jog). Speeds are step events
+// per second of the axis with the most steps in a segment.
+#define PLANNER_QUEUE_SIZE 16        // Segments buffered for lookahead
+#define PLANNER_ACCEL 1500.0f        // steps/s^2
+#define PLANNER_START_SPEED 150.0f   // steps/s the motors start and stop at without ramping
+#define PLANNER_JERK 150.0f          // Max instant speed change of one axis at a segment junction (steps/s)
+#define PLANNER_JOG_STEPS 256        // Segment length queued by continuous rotation (mcont)
+
 // ============================================================================
 // IMU Parameters
 // ============================================================================
@@ -118,6 +260,49 @@
 // ============================================================================
 
 #define SERIAL_BAUD_RATE 115200
+#define SERIAL_TX_BUFFER_SIZE 1024   // Room for telemetry batches without blocking loop()
+#define SERIAL_LINE_MAX 128          // Longest text console command
+
+// ============================================================================
+// Deferred Logging
+// ============================================================================
+
+#define LOG_RING_RECORDS 64          // Record ring (power of two); new records dropped when full
+#define LOG_MAX_ARGS 12              // Arguments per record
+#define LOG_TX_RESERVE 256           // UART buffer bytes the drain leaves free for the console
+#define LOG_TASK_PRIORITY 1          // Below async_tcp and WiFi
+#define LOG_TASK_CORE 0              // loop() runs on core 1
+#define LOG_TASK_STACK 3072
+#define LOG_IDLE_DELAY_MS 5          // Drain poll interval while the ring is empty
+
+// ============================================================================
+// Control Timing
+// ============================================================================
+
+// Intervals longer than these count as deadline misses (`timing` command)
+#define IMU_DEADLINE_US (IMU_UPDATE_INTERVAL_MS * 1500UL)
+#define CONTROL_DEADLINE_US (LEVEL_CHECK_INTERVAL_MS * 1500UL)
+
+// ============================================================================
+// Loop Profiler
+// ============================================================================
+
+// Cycle-count timing of loop() stages (`perf` command). Off by default:
+// set to 1 here or add -DLOOP_PROFILER_ENABLED=1 to build_flags.
+#ifndef LOOP_PROFILER_ENABLED
+#define LOOP_PROFILER_ENABLED 0
+#endif
+
+// ============================================================================
+// High-Rate Telemetry Stream
+// ============================================================================
+
+#define STREAM_RING_SAMPLES 128      // Sample ring; oldest dropped when the sinks fall behind
+#define STREAM_MAX_BATCH 20          // Max samples per binary frame
+#define STREAM_BATCHES_PER_SEC 10    // Batch size = rate / this, so ~10 frames/s up to 200 Hz
+#define STREAM_DEFAULT_HZ 100
+#define STREAM_MAX_HZ 1000           // MPU6050 gyro output rate with DLPF enabled
+#define STREAM_SERIAL_MAX_HZ 300     // Serial sink: ~29 bytes/sample framed, 11.5 kB/s at 115200 baud
 
 // ============================================================================
 // WiFi / Web Dashboard
@@ -125,7 +310,11 @@
 
 #define WIFI_AP_SSID "LevelingPrism"
 #define WIFI_AP_PASSWORD "level1234"
-#define WEB_STATUS_INTERVAL_MS 100   // 10 Hz broadcast rate
+#define WEB_STATUS_INTERVAL_MS 100   // 10 Hz default status rate per client
+#define WEB_MAX_STATUS_HZ (1000 / IMU_UPDATE_INTERVAL_MS)  // Subscriptions capped at control-loop rate
+#define WEB_KEYFRAME_INTERVAL_MS 5000 // Full status resync; delta frames in between
 #define WS_MAX_CLIENTS 4             // Max simultaneous WebSocket clients
+#define WS_MSG_QUEUE_DEPTH 4         // Queued log/response messages per client
+#define WS_MSG_MAX_LEN 256           // Max length of one queued JSON message
 
 #endif // CONFIG_H
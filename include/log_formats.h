@@ -0,0 +1,40 @@
+#ifndef LOG_FORMATS_H
+#define LOG_FORMATS_H
+
+#include <stdint.h>
+
+// ============================================================================
+// Deferred Log Formats (see lib/DeferredLog)
+// ============================================================================
+//
+// Log records carry only a format ID and the raw arguments; the text lives
+// here and is expanded by the drain task (text mode) or on the host by
+// tools/log_decoder.py (binary mode), which parses this file. Keep one X()
+// entry per line and only append: the ID is the position in the list.
+//
+// Conversions: %d %i %ld (signed), %u %lu %x %X %c (unsigned), %f %e %g
+// (float), %S (SystemState name), %s (string literals only - the pointer is
+// recorded, not the text). Flags, width and precision work as in printf.
+
+#define LOG_FORMATS(X) \
+    X(LOG_DROPPED,         "[LOG] %lu records dropped") \
+    X(LOG_STATE_CHANGE,    "State: %S -> %S") \
+    X(LOG_STABLE,          "Platform stable. Starting leveling...") \
+    X(LOG_MOTION_WAIT,     "Motion detected - waiting for stability...") \
+    X(LOG_LEVEL_ACHIEVED,  "Level achieved! Pitch=%.2f, Roll=%.2f (stable for %dms)") \
+    X(LOG_MOTION_RELEVEL,  "Motion detected - re-leveling...") \
+    X(LOG_NOT_LEVEL,       "Platform no longer level - adjusting...") \
+    X(LOG_CONTINUOUS,      "P:%.2f R:%.2f M:%d M1:%ld M2:%ld") \
+    X(LOG_TEST_IMU,        "[IMU] P:%.2f R:%.2f | Ax:%.3f Ay:%.3f Az:%.3f | Gx:%.1f Gy:%.1f Gz:%.1f | M1:%ld M2:%ld") \
+    X(LOG_CORRECTION_CLIP, "Correction clipped: M1 %d -> %d, M2 %d -> %d") \
+    X(LOG_STALL,           "[STALL] Missed steps: M1 ~%ld of %ld (eff %.2f), M2 ~%ld of %ld (eff %.2f)") \
+    X(LOG_STEP_RATE,       "[STALL] Correction step delay M%u %c: %lu us")
+
+enum LogFormatId : uint16_t {
+#define LOG_FORMAT_ID(id, fmt) id,
+    LOG_FORMATS(LOG_FORMAT_ID)
+#undef LOG_FORMAT_ID
+    LOG_FORMAT_COUNT
+};
+
+#endif // LOG_FORMATS_H
@@ -2,6 +2,7 @@
 #define TYPES_H
 
 #include <Arduino.h>
+#include "config.h"
 
 // ============================================================================
 // System State Machine
@@ -99,8 +100,19 @@ struct IMUCalibration {
 struct PIController {
     float kp;
     float ki;
-    float integral;
-    float lastError;
+    float kd;               // Derivative gain on the measurement (0 = PI)
+    float integral;         // Error x nominal control intervals
+    float lastMeasurement;
+    float derivative;       // Low-pass filtered measurement change per interval
+};
+
+// Gain schedule: piecewise-linear multipliers between breakpoints (keys
+// ascending), held constant past the first and last
+struct GainSchedule {
+    float errorDeg[GAIN_SCHEDULE_POINTS];       // |axis error| breakpoints
+    float errorScale[GAIN_SCHEDULE_POINTS];     // Kp and Ki multiplier
+    float position[GAIN_SCHEDULE_POINTS];       // Motor position breakpoints (steps)
+    float positionScale[GAIN_SCHEDULE_POINTS];  // Output multiplier of that motor
 };
 
 // Motor correction output
@@ -118,6 +130,9 @@ struct SystemConfig {
     float levelTolerance;
     bool continuousLogging;
     unsigned long stabilityTimeoutMs;  // How long platform must be still before leveling (ms)
+    bool predictive;                   // PredictiveController instead of the PI controllers
+    bool attitudePredictor;            // Control on AttitudePredictor's estimate
+    bool settleGate;                   // SettleDetector instead of the fixed correction tick
 };
 
 #endif // TYPES_H
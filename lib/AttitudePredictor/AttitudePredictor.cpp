@@ -0,0 +1,59 @@
+#include "AttitudePredictor.h"
+
+AttitudePredictor::AttitudePredictor() {
+    reset(0, 0);
+}
+
+void AttitudePredictor::reset(float pitch, float roll) {
+    resetAxis(_pitch, pitch);
+    resetAxis(_roll, roll);
+}
+
+void AttitudePredictor::resetAxis(Axis& a, float angle) {
+    a.x = angle;
+    a.m = angle;
+    a.pxx = PREDICT_IMU_NOISE_DEG * PREDICT_IMU_NOISE_DEG;
+    a.pxm = a.pxx;
+    a.pmm = a.pxx;
+}
+
+void AttitudePredictor::addMove(const MotorCorrection& moved) {
+    move(_pitch, PLANT_M1_PITCH_PER_STEP * moved.motor1Steps + PLANT_M2_PITCH_PER_STEP * moved.motor2Steps);
+    move(_roll, PLANT_M1_ROLL_PER_STEP * moved.motor1Steps + PLANT_M2_ROLL_PER_STEP * moved.motor2Steps);
+}
+
+void AttitudePredictor::update(float imuPitch, float imuRoll) {
+    sample(_pitch, imuPitch);
+    sample(_roll, imuRoll);
+}
+
+void AttitudePredictor::move(Axis& a, float delta) {
+    float sigma = PREDICT_GAIN_SIGMA * delta;
+    a.x += delta;
+    a.pxx += sigma * sigma;
+}
+
+void AttitudePredictor::sample(Axis& a, float measured) {
+    const float alpha = COMPLEMENTARY_ALPHA;
+    const float qx = PREDICT_DRIFT_DEG * PREDICT_DRIFT_DEG;
+    const float qm = PREDICT_LAG_SIGMA_DEG * PREDICT_LAG_SIGMA_DEG;
+    const float r = PREDICT_IMU_NOISE_DEG * PREDICT_IMU_NOISE_DEG;
+
+    // Predict: x holds, m follows x through the filter; P = F P F' + Q
+    // with F = [1 0; alpha 1-alpha]
+    a.m += alpha * (a.x - a.m);
+    float pxx = a.pxx + qx;
+    float pxm = alpha * a.pxx + (1 - alpha) * a.pxm;
+    float pmm = alpha * alpha * a.pxx + 2 * alpha * (1 - alpha) * a.pxm + (1 - alpha) * (1 - alpha) * a.pmm + qm;
+
+    // Update: the IMU measures m
+    float s = pmm + r;
+    float kx = pxm / s;
+    float km = pmm / s;
+    float innovation = measured - a.m;
+    a.x += kx * innovation;
+    a.m += km * innovation;
+    a.pxx = pxx - kx * pxm;
+    a.pxm = pxm - kx * pmm;
+    a.pmm = pmm - km * pmm;
+}
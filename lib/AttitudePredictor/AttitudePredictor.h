@@ -0,0 +1,81 @@
+#ifndef ATTITUDE_PREDICTOR_H
+#define ATTITUDE_PREDICTOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+/**
+ * AttitudePredictor - Dead-reckoned attitude from commanded leg moves
+ *
+ * Corrections block loop() while the legs move, so the IMU's gyro is not
+ * sampled during a move and never sees the rotation. The complementary
+ * filter then picks the tilt change up through the accelerometer path
+ * only, at COMPLEMENTARY_ALPHA per sample, and the controller would act on
+ * an angle that is still catching up (and correct the same error twice).
+ *
+ * Per axis, a two-state Kalman filter tracks the true angle x and the
+ * complementary filter's output m, with the filter's own lag as the model:
+ *
+ *   move:        x += J steps                   (plant gains, PLANT_*)
+ *   IMU sample:  m += alpha (x - m)             (predict)
+ *                x, m += K (imu - m)            (update, measurement = m)
+ *
+ * A move is the predict step: it raises the uncertainty of x by
+ * PREDICT_GAIN_SIGMA of its size, so the IMU still corrects the estimate
+ * when steps are missed or the plant gain is off. Between moves x is a
+ * slow random walk (PREDICT_DRIFT_DEG per sample), and the filter model
+ * itself is trusted to PREDICT_LAG_SIGMA_DEG per sample.
+ *
+ * getPitch()/getRoll() are then current right after a move instead of
+ * lagging it, and equal the IMU angle once it has settled.
+ */
+class AttitudePredictor {
+public:
+    AttitudePredictor();
+
+    /**
+     * Start from a settled IMU angle (estimate = filter output = IMU)
+     */
+    void reset(float pitch, float roll);
+
+    /**
+     * Predict: steps that were actually made
+     */
+    void addMove(const MotorCorrection& moved);
+
+    /**
+     * One complementary filter sample (call after every IMU update)
+     */
+    void update(float imuPitch, float imuRoll);
+
+    /**
+     * Estimated attitude in degrees
+     */
+    float getPitch() const { return _pitch.x; }
+    float getRoll() const { return _roll.x; }
+
+    /**
+     * Tilt change the IMU has not shown yet (estimate - filter model)
+     */
+    float getPendingPitch() const { return _pitch.x - _pitch.m; }
+    float getPendingRoll() const { return _roll.x - _roll.m; }
+
+private:
+    struct Axis {
+        float x;            // Estimated angle
+        float m;            // Modelled complementary filter output
+        float pxx;          // Covariance
+        float pxm;
+        float pmm;
+    };
+
+    Axis _pitch;
+    Axis _roll;
+
+    static void resetAxis(Axis& a, float angle);
+    static void move(Axis& a, float delta);
+    static void sample(Axis& a, float measured);
+};
+
+#endif // ATTITUDE_PREDICTOR_H
@@ -0,0 +1,101 @@
+#include "ControlTiming.h"
+
+// Recently finished blocking sites, oldest overwritten
+struct SiteRecord {
+    const char* name;
+    uint32_t startUs;
+    uint32_t endUs;
+};
+
+static SiteRecord siteRing[TIMING_SITE_RING];
+static uint8_t siteNext = 0;
+
+BlockingSite::~BlockingSite() {
+    SiteRecord& r = siteRing[siteNext];
+    r.name = _name;
+    r.startUs = _startUs;
+    r.endUs = micros();
+    siteNext = (siteNext + 1) % TIMING_SITE_RING;
+}
+
+// Longest site that finished after sinceUs
+static const char* blameSite(uint32_t sinceUs, uint32_t nowUs) {
+    const char* site = "loop";
+    uint32_t longest = 0;
+    for (int i = 0; i < TIMING_SITE_RING; i++) {
+        const SiteRecord& r = siteRing[i];
+        if (!r.name || r.endUs - sinceUs > nowUs - sinceUs) continue;
+        if (r.endUs - r.startUs > longest) {
+            longest = r.endUs - r.startUs;
+            site = r.name;
+        }
+    }
+    return site;
+}
+
+IntervalMonitor::IntervalMonitor(const char* name, uint32_t deadlineUs)
+    : _name(name)
+    , _deadlineUs(deadlineUs)
+    , _running(false)
+    , _lastUs(0)
+    , _excludedUs(0)
+{
+    reset();
+}
+
+void IntervalMonitor::reset() {
+    _count = 0;
+    _sumUs = 0;
+    _maxUs = 0;
+    _misses = 0;
+    _worstMissUs = 0;
+    _worstSite = nullptr;
+    memset(_hist, 0, sizeof(_hist));
+}
+
+void IntervalMonitor::tick(uint32_t nowUs) {
+    if (_running) {
+        uint32_t interval = nowUs - _lastUs;
+        interval = _excludedUs < interval ? interval - _excludedUs : 0;
+        _count++;
+        _sumUs += interval;
+        if (interval > _maxUs) _maxUs = interval;
+        uint8_t b = 31 - __builtin_clz(interval | 1);
+        _hist[b < TIMING_BUCKETS ? b : TIMING_BUCKETS - 1]++;
+
+        if (interval > _deadlineUs) {
+            _misses++;
+            if (interval > _worstMissUs) {
+                _worstMissUs = interval;
+                _worstSite = blameSite(_lastUs, nowUs);
+            }
+        }
+    }
+    _lastUs = nowUs;
+    _excludedUs = 0;
+    _running = true;
+}
+
+void IntervalMonitor::getStats(IntervalStats& out) const {
+    out.count = _count;
+    out.misses = _misses;
+    out.deadlineUs = _deadlineUs;
+    out.meanUs = _count ? (float)_sumUs / _count : 0.0f;
+    out.maxUs = _maxUs;
+    out.worstMissUs = _worstMissUs;
+    out.worstSite = _worstSite;
+
+    // p99: interpolate inside the bucket holding the 99th percentile
+    out.p99Us = 0.0f;
+    uint32_t target = _count - _count / 100;
+    uint32_t below = 0;
+    for (int b = 0; b < TIMING_BUCKETS && _count > 0; b++) {
+        if (below + _hist[b] >= target) {
+            float lo = b == 0 ? 0.0f : (float)(1UL << b);
+            float hi = b == TIMING_BUCKETS - 1 ? (float)_maxUs : (float)(2UL << b);
+            out.p99Us = min(lo + (hi - lo) * (target - below) / _hist[b], (float)_maxUs);
+            break;
+        }
+        below += _hist[b];
+    }
+}
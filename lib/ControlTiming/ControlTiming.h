@@ -0,0 +1,102 @@
+#ifndef CONTROL_TIMING_H
+#define CONTROL_TIMING_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * ControlTiming - Jitter and deadline misses of periodic control work
+ *
+ * An IntervalMonitor is ticked each time its periodic job runs (IMU update,
+ * controller evaluation) and records the time since the previous tick in a
+ * log2 histogram. Intervals above the deadline are counted as misses.
+ *
+ * Code that may block loop() (console commands, NVS writes, blocking motor
+ * moves) is wrapped in TIMING_SITE("name"). When a miss happens, the
+ * longest such site that finished since the previous tick is blamed, and
+ * the site behind the worst miss is kept. A miss with no marked site is
+ * blamed on "loop".
+ *
+ * Everything here runs on the loop() task.
+ */
+
+#define TIMING_BUCKETS 24            // log2 microseconds: bucket b = [2^b, 2^(b+1)) us, last is open
+#define TIMING_SITE_RING 8           // Recent blocking sites kept for attribution
+
+// Summary of one monitor, intervals in microseconds
+struct IntervalStats {
+    uint32_t count;
+    uint32_t misses;
+    uint32_t deadlineUs;
+    float meanUs;
+    float p99Us;
+    uint32_t maxUs;
+    uint32_t worstMissUs;           // 0 if no miss yet
+    const char* worstSite;          // Site blamed for worstMissUs, nullptr if no miss
+};
+
+class IntervalMonitor {
+public:
+    IntervalMonitor(const char* name, uint32_t deadlineUs);
+
+    /**
+     * Record the interval since the previous tick
+     */
+    void tick(uint32_t nowUs);
+
+    /**
+     * Forget the previous tick, e.g. when the job was paused on purpose
+     * (state change); the next tick only starts a new interval
+     */
+    void restart() { _running = false; _excludedUs = 0; }
+
+    /**
+     * Take a deliberate wait (settle gate) out of the current interval;
+     * the rest of the interval, blocking work included, still counts
+     */
+    void exclude(uint32_t us) { _excludedUs += us; }
+
+    /**
+     * Clear statistics (deadline is kept)
+     */
+    void reset();
+
+    void setDeadline(uint32_t us) { _deadlineUs = us; }
+
+    void getStats(IntervalStats& out) const;
+    uint32_t getBucket(uint8_t b) const { return b < TIMING_BUCKETS ? _hist[b] : 0; }
+    const char* getName() const { return _name; }
+
+private:
+    const char* _name;
+    uint32_t _deadlineUs;
+    bool _running;
+    uint32_t _lastUs;
+    uint32_t _excludedUs;
+
+    uint32_t _count;
+    uint64_t _sumUs;
+    uint32_t _maxUs;
+    uint32_t _misses;
+    uint32_t _worstMissUs;
+    const char* _worstSite;
+    uint32_t _hist[TIMING_BUCKETS];
+};
+
+/**
+ * Marks a stretch of code that may hold up loop(); use TIMING_SITE.
+ * name must be a string with static storage (a literal or a table entry).
+ */
+class BlockingSite {
+public:
+    explicit BlockingSite(const char* name) : _name(name), _startUs(micros()) {}
+    ~BlockingSite();
+
+private:
+    const char* _name;
+    uint32_t _startUs;
+};
+
+#define TIMING_SITE(name) BlockingSite timingSite(name)
+
+#endif // CONTROL_TIMING_H
@@ -0,0 +1,187 @@
+#include "DeferredLog.h"
+
+#define LOG_FORMAT_TEXT(id, fmt) fmt,
+static const char* const LOG_FORMAT_TEXTS[] = { LOG_FORMATS(LOG_FORMAT_TEXT) };
+#undef LOG_FORMAT_TEXT
+
+DeferredLog::DeferredLog()
+    : _head(0)
+    , _tail(0)
+    , _dropped(0)
+    , _binary(false)
+    , _port(nullptr)
+    , _droppedReported(0)
+{
+}
+
+void DeferredLog::begin(HardwareSerial& port) {
+    _port = &port;
+    xTaskCreatePinnedToCore(drainTask, "log", LOG_TASK_STACK, this,
+                            LOG_TASK_PRIORITY, nullptr, LOG_TASK_CORE);
+}
+
+void DeferredLog::push(uint16_t id, const uint32_t* args, uint8_t argc) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= LOG_RING_RECORDS) {
+        _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& r = _ring[head & (LOG_RING_RECORDS - 1)];
+    r.header.id = id;
+    r.header.argc = argc;
+    r.header.reserved = 0;
+    r.header.timeUs = micros();
+    memcpy(r.args, args, argc * sizeof(uint32_t));
+    // Publish only after the record is complete
+    _head.store(head + 1, std::memory_order_release);
+}
+
+void DeferredLog::drainTask(void* arg) {
+    static_cast<DeferredLog*>(arg)->drain();
+}
+
+void DeferredLog::drain() {
+    while (true) {
+        uint32_t dropped = _dropped.load(std::memory_order_relaxed);
+        if (dropped != _droppedReported) {
+            LogRecordHeader header = {LOG_DROPPED, 1, 0, (uint32_t)micros()};
+            uint32_t count = dropped - _droppedReported;
+            emit(header, &count);
+            _droppedReported = dropped;
+        }
+
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            vTaskDelay(pdMS_TO_TICKS(LOG_IDLE_DELAY_MS));
+            continue;
+        }
+
+        // The slot stays ours until the tail moves past it
+        const Record& r = _ring[tail & (LOG_RING_RECORDS - 1)];
+        emit(r.header, r.args);
+        _tail.store(tail + 1, std::memory_order_release);
+    }
+}
+
+bool DeferredLog::emit(const LogRecordHeader& header, const uint32_t* args) {
+    const uint8_t* out;
+    size_t len;
+
+    if (_binary.load()) {
+        memcpy(_text, &header, sizeof(header));
+        memcpy(_text + sizeof(header), args, header.argc * sizeof(uint32_t));
+        len = SerialProtocol::encodeFrame(LINK_EVT_LOG, 0, _text,
+                                          sizeof(header) + header.argc * sizeof(uint32_t),
+                                          _frameRaw, _frameEnc);
+        out = _frameEnc;
+    } else {
+        len = format(header, args, _text, sizeof(_text) - 1);
+        _text[len++] = '\n';
+        out = (const uint8_t*)_text;
+    }
+
+    // Wait here, not in the logging call. Leave room in the UART buffer so
+    // console replies and telemetry from loop() are not starved.
+    while ((size_t)_port->availableForWrite() < len + LOG_TX_RESERVE) {
+        vTaskDelay(1);
+    }
+    // One write call so output from other tasks cannot land mid-line
+    return _port->write(out, len) == len;
+}
+
+size_t DeferredLog::format(const LogRecordHeader& header, const uint32_t* args, char* out, size_t size) {
+    if (size == 0) return 0;
+    if (header.id >= LOG_FORMAT_COUNT) {
+        int n = snprintf(out, size, "[LOG] unknown record %u", header.id);
+        return n < 0 ? 0 : ((size_t)n < size ? n : size - 1);
+    }
+
+    const char* p = LOG_FORMAT_TEXTS[header.id];
+    size_t len = 0;
+    uint8_t argi = 0;
+
+    while (*p && len < size - 1) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[len++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Copy flags, width and precision; drop length modifiers since
+        // every argument is a 32-bit word
+        char spec[16];
+        size_t n = 0;
+        spec[n++] = *p++;
+        while (*p && strchr("-+ #0123456789.", *p) && n < sizeof(spec) - 3) spec[n++] = *p++;
+        while (*p == 'l' || *p == 'h') p++;
+        char conv = *p;
+        if (!conv) break;
+        p++;
+
+        uint32_t w = argi < header.argc ? args[argi] : 0;
+        argi++;
+
+        size_t room = size - len;
+        int written = 0;
+        switch (conv) {
+            case 'd':
+            case 'i':
+                spec[n++] = 'l';
+                spec[n++] = conv;
+                spec[n] = '\0';
+                written = snprintf(out + len, room, spec, (long)(int32_t)w);
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+                spec[n++] = 'l';
+                spec[n++] = conv;
+                spec[n] = '\0';
+                written = snprintf(out + len, room, spec, (unsigned long)w);
+                break;
+            case 'c':
+                spec[n++] = conv;
+                spec[n] = '\0';
+                written = snprintf(out + len, room, spec, (int)w);
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G': {
+                float f;
+                memcpy(&f, &w, 4);
+                spec[n++] = conv;
+                spec[n] = '\0';
+                written = snprintf(out + len, room, spec, (double)f);
+                break;
+            }
+            case 'S':
+                spec[n++] = 's';
+                spec[n] = '\0';
+                written = snprintf(out + len, room, spec, stateToString((SystemState)w));
+                break;
+            case 's': {
+                const char* s = (const char*)(uintptr_t)w;
+                spec[n++] = 's';
+                spec[n] = '\0';
+                written = snprintf(out + len, room, spec, s ? s : "(null)");
+                break;
+            }
+            default:
+                out[len] = '?';
+                written = 1;
+                break;
+        }
+        if (written > 0) len += (size_t)written < room ? (size_t)written : room - 1;
+    }
+
+    out[len] = '\0';
+    return len;
+}
@@ -0,0 +1,147 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+#include "types.h"
+#include "log_formats.h"
+#include "SerialProtocol.h"
+
+/**
+ * DeferredLog - Logging that never waits for the UART
+ *
+ * LOG(LOG_STATE_CHANGE, from, to) copies the format ID and raw argument
+ * words into a lock-free ring and returns; it takes a few microseconds
+ * whatever the link speed. A low-priority task on the other core drains
+ * the ring, either formatting each record as a text line or sending it
+ * as a LINK_EVT_LOG frame for tools/log_decoder.py to expand. When the
+ * ring is full new records are dropped and counted, and the drain reports
+ * the count as a LOG_DROPPED record once there is room again.
+ *
+ * The ring is single-producer: log from the loop() task only.
+ * Formats and their IDs are in include/log_formats.h.
+ *
+ * LINK_EVT_LOG body: LogRecordHeader followed by argc uint32 words.
+ */
+
+struct __attribute__((packed)) LogRecordHeader {
+    uint16_t id;           // LogFormatId
+    uint8_t argc;
+    uint8_t reserved;
+    uint32_t timeUs;       // micros() when logged
+};
+
+namespace LogFormat {
+
+// Number of arguments a format consumes ("%%" is a literal percent sign)
+constexpr uint8_t countArgs(const char* fmt) {
+    return *fmt == '\0' ? 0
+         : (fmt[0] == '%' && fmt[1] == '%') ? countArgs(fmt + 2)
+         : (fmt[0] == '%') ? 1 + countArgs(fmt + 1)
+         : countArgs(fmt + 1);
+}
+
+#define LOG_FORMAT_ARGC(id, fmt) \
+    constexpr uint8_t id##_ARGC = countArgs(fmt); \
+    static_assert(id##_ARGC <= LOG_MAX_ARGS, #id " has too many arguments");
+LOG_FORMATS(LOG_FORMAT_ARGC)
+#undef LOG_FORMAT_ARGC
+
+// Argument words: integers as 32-bit, floating point as float bits
+inline uint32_t toWord(int v)               { return (uint32_t)v; }
+inline uint32_t toWord(unsigned int v)      { return v; }
+inline uint32_t toWord(long v)              { return (uint32_t)v; }
+inline uint32_t toWord(unsigned long v)     { return (uint32_t)v; }
+inline uint32_t toWord(bool v)              { return v ? 1 : 0; }
+inline uint32_t toWord(SystemState v)       { return (uint32_t)v; }
+inline uint32_t toWord(const char* v)       { return (uint32_t)(uintptr_t)v; }
+inline uint32_t toWord(float v) {
+    uint32_t w;
+    memcpy(&w, &v, 4);
+    return w;
+}
+inline uint32_t toWord(double v)            { return toWord((float)v); }
+
+} // namespace LogFormat
+
+/**
+ * Log a record; the argument count is checked against the format at
+ * compile time
+ */
+#define LOG(id, ...) deferredLog.write<LogFormat::id##_ARGC>(id, ##__VA_ARGS__)
+
+class DeferredLog {
+public:
+    DeferredLog();
+
+    /**
+     * Start the drain task writing to port
+     */
+    void begin(HardwareSerial& port);
+
+    template <uint8_t N, typename... Args>
+    void write(LogFormatId id, Args... args) {
+        static_assert(sizeof...(Args) == N, "Argument count does not match the log format");
+        // One spare element so a format without arguments is not a zero-size array
+        const uint32_t words[sizeof...(Args) + 1] = {LogFormat::toWord(args)..., 0};
+        push(id, words, sizeof...(Args));
+    }
+
+    /**
+     * Binary mode sends LINK_EVT_LOG frames instead of text lines
+     */
+    void setBinary(bool binary) { _binary.store(binary); }
+    bool isBinary() const { return _binary.load(); }
+
+    /**
+     * Records dropped because the ring was full (since boot)
+     */
+    uint32_t getDropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    /**
+     * Records waiting to be drained
+     */
+    uint32_t getPending() const {
+        return _head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Expand a record into text (no newline)
+     * @return Length written, truncated to size - 1
+     */
+    static size_t format(const LogRecordHeader& header, const uint32_t* args, char* out, size_t size);
+
+private:
+    struct Record {
+        LogRecordHeader header;
+        uint32_t args[LOG_MAX_ARGS];
+    };
+
+    static_assert((LOG_RING_RECORDS & (LOG_RING_RECORDS - 1)) == 0,
+                  "LOG_RING_RECORDS must be a power of two");
+
+    Record _ring[LOG_RING_RECORDS];
+    std::atomic<uint32_t> _head;      // Written by the producer only
+    std::atomic<uint32_t> _tail;      // Written by the drain task only
+    std::atomic<uint32_t> _dropped;
+    std::atomic<bool> _binary;
+
+    HardwareSerial* _port;
+    uint32_t _droppedReported;
+
+    // Drain task buffers
+    static const size_t FRAME_RAW_SIZE = LINK_HEADER_SIZE + sizeof(Record) + LINK_CRC_SIZE;
+    char _text[256];
+    uint8_t _frameRaw[FRAME_RAW_SIZE];
+    uint8_t _frameEnc[FRAME_RAW_SIZE + FRAME_RAW_SIZE / 254 + 3];
+
+    void push(uint16_t id, const uint32_t* args, uint8_t argc);
+    static void drainTask(void* arg);
+    void drain();
+    bool emit(const LogRecordHeader& header, const uint32_t* args);
+};
+
+extern DeferredLog deferredLog;
+
+#endif // DEFERRED_LOG_H
@@ -1,17 +1,26 @@
 #include "LevelingController.h"
+#include <cmath>
 
 LevelingController::LevelingController()
     : _stepsPerDegree(60.0f)  // Steps per degree of PI output (~1/deg-per-step for roll axis)
+    , _pitchTarget(0)
+    , _rollTarget(0)
+    , _setpointWeight(DEFAULT_SETPOINT_WEIGHT)
+    , _antiWindup(ANTIWINDUP_TRACKING)
+    , _primed(false)
+    , _schedule(defaultSchedule())
+    , _position1(0)
+    , _position2(0)
 {
     _pitchController.kp = DEFAULT_KP_PITCH;
     _pitchController.ki = DEFAULT_KI_PITCH;
-    _pitchController.integral = 0;
-    _pitchController.lastError = 0;
+    _pitchController.kd = DEFAULT_KD_PITCH;
 
     _rollController.kp = DEFAULT_KP_ROLL;
     _rollController.ki = DEFAULT_KI_ROLL;
-    _rollController.integral = 0;
-    _rollController.lastError = 0;
+    _rollController.kd = DEFAULT_KD_ROLL;
+
+    reset();
 }
 
 void LevelingController::begin() {
@@ -21,24 +30,22 @@ void LevelingController::begin() {
     Serial.printf("  Roll gains: Kp=%.2f, Ki=%.2f\n", _rollController.kp, _rollController.ki);
 }
 
-MotorCorrection LevelingController::calculate(float pitch, float roll) {
+MotorCorrection LevelingController::calculate(float pitch, float roll, float dt) {
     MotorCorrection correction;
 
     // Error sign: positive error means positive angle needs correction.
     // Our motor mapping has NEGATIVE plant gain (positive steps decrease angles),
-    // so we use error = +actual to get net negative feedback.
+    // so we use error = actual - target (0 = level) to get net negative feedback.
     //
     // Measured: M1 +steps → pitch -0.22, roll +0.42
     //           M2 +steps → pitch -0.20, roll -0.45
     // Motor mapping below: M1 = pitch - roll, M2 = pitch + roll
     // For roll>0: M1 goes negative (dRoll negative ✓), M2 goes positive (dRoll negative ✓)
     // For pitch>0: both go positive (dPitch negative ✓)
-    float pitchError = pitch;
-    float rollError = roll;
-
-    // Calculate PI outputs
-    float pitchOutput = calculatePI(_pitchController, pitchError);
-    float rollOutput = calculatePI(_rollController, rollError);
+    dt = constrain(dt, 0.0f, CONTROL_DT_MAX_S);
+    float pitchOutput = calculatePID(_pitchController, pitch, _pitchTarget, dt);
+    float rollOutput = calculatePID(_rollController, roll, _rollTarget, dt);
+    _primed = true;
 
     // Convert to steps
     pitchOutput *= _stepsPerDegree;
@@ -51,12 +58,27 @@ MotorCorrection LevelingController::calculate(float pitch, float roll) {
     // Pitch positive = platform tilted back = both motors need to raise (positive steps)
     // Roll positive = platform tilted right = M1 raises, M2 lowers
 
-    correction.motor1Steps = (int)(pitchOutput - rollOutput);
-    correction.motor2Steps = -(int)(pitchOutput + rollOutput);  // Negated: M2 lead screw is physically reversed
+    // Scale each motor for the plant gain at its leg extension
+    float scale1 = interpolate(_schedule.position, _schedule.positionScale, _position1);
+    float scale2 = interpolate(_schedule.position, _schedule.positionScale, _position2);
+
+    correction.motor1Steps = (int)((pitchOutput - rollOutput) * scale1);
+    correction.motor2Steps = -(int)((pitchOutput + rollOutput) * scale2);  // Negated: M2 lead screw is physically reversed
 
     return correction;
 }
 
+void LevelingController::reportApplied(const MotorCorrection& requested, const MotorCorrection& applied) {
+    // Invert the motor mapping of calculate(): M1 = pitch - roll, M2 = -(pitch + roll)
+    float pitchRequested = (requested.motor1Steps - requested.motor2Steps) * 0.5f;
+    float rollRequested = -(requested.motor1Steps + requested.motor2Steps) * 0.5f;
+    float pitchApplied = (applied.motor1Steps - applied.motor2Steps) * 0.5f;
+    float rollApplied = -(applied.motor1Steps + applied.motor2Steps) * 0.5f;
+
+    unwindIntegral(_pitchController, pitchRequested, pitchApplied);
+    unwindIntegral(_rollController, rollRequested, rollApplied);
+}
+
 void LevelingController::setPitchGains(float kp, float ki) {
     _pitchController.kp = kp;
     _pitchController.ki = ki;
@@ -69,6 +91,63 @@ void LevelingController::setRollGains(float kp, float ki) {
     Serial.printf("LevelingController: Roll gains set to Kp=%.2f, Ki=%.2f\n", kp, ki);
 }
 
+void LevelingController::setDerivativeGains(float kdPitch, float kdRoll) {
+    _pitchController.kd = kdPitch;
+    _rollController.kd = kdRoll;
+    Serial.printf("LevelingController: Derivative gains set to Kd=%.2f (pitch), %.2f (roll)\n", kdPitch, kdRoll);
+}
+
+void LevelingController::getDerivativeGains(float& kdPitch, float& kdRoll) const {
+    kdPitch = _pitchController.kd;
+    kdRoll = _rollController.kd;
+}
+
+void LevelingController::setTarget(float pitch, float roll) {
+    _pitchTarget = pitch;
+    _rollTarget = roll;
+}
+
+bool LevelingController::setSchedule(const GainSchedule& schedule) {
+    for (int i = 0; i < GAIN_SCHEDULE_POINTS; i++) {
+        // NaN fails every comparison below, so check finiteness first
+        if (!std::isfinite(schedule.errorDeg[i]) || !std::isfinite(schedule.position[i]) ||
+            !std::isfinite(schedule.errorScale[i]) || !std::isfinite(schedule.positionScale[i])) {
+            return false;
+        }
+        if (i > 0 && (schedule.errorDeg[i] <= schedule.errorDeg[i - 1] ||
+                      schedule.position[i] <= schedule.position[i - 1])) {
+            return false;
+        }
+        if (!(schedule.errorScale[i] >= 0 && schedule.errorScale[i] <= GAIN_SCHED_MAX_SCALE &&
+              schedule.positionScale[i] >= 0 && schedule.positionScale[i] <= GAIN_SCHED_MAX_SCALE)) {
+            return false;
+        }
+    }
+    _schedule = schedule;
+    return true;
+}
+
+GainSchedule LevelingController::defaultSchedule() {
+    GainSchedule s = {GAIN_SCHED_ERROR_DEG, GAIN_SCHED_ERROR_SCALE, GAIN_SCHED_POSITION, GAIN_SCHED_POS_SCALE};
+    return s;
+}
+
+void LevelingController::setMotorPositions(long pos1, long pos2) {
+    _position1 = pos1;
+    _position2 = pos2;
+}
+
+float LevelingController::interpolate(const float* keys, const float* values, float x) {
+    if (x <= keys[0]) return values[0];
+    for (int i = 1; i < GAIN_SCHEDULE_POINTS; i++) {
+        if (x < keys[i]) {
+            float t = (x - keys[i - 1]) / (keys[i] - keys[i - 1]);
+            return values[i - 1] + t * (values[i] - values[i - 1]);
+        }
+    }
+    return values[GAIN_SCHEDULE_POINTS - 1];
+}
+
 void LevelingController::getPitchGains(float& kp, float& ki) const {
     kp = _pitchController.kp;
     ki = _pitchController.ki;
@@ -81,29 +160,56 @@ void LevelingController::getRollGains(float& kp, float& ki) const {
 
 void LevelingController::reset() {
     _pitchController.integral = 0;
-    _pitchController.lastError = 0;
+    _pitchController.lastMeasurement = 0;
+    _pitchController.derivative = 0;
     _rollController.integral = 0;
-    _rollController.lastError = 0;
+    _rollController.lastMeasurement = 0;
+    _rollController.derivative = 0;
+    _primed = false;
 }
 
 void LevelingController::setStepsPerDegree(float factor) {
     _stepsPerDegree = factor;
 }
 
-float LevelingController::calculatePI(PIController& controller, float error) {
-    // Proportional term
-    float pTerm = controller.kp * error;
+void LevelingController::unwindIntegral(PIController& controller, float requested, float applied) {
+    // Rounding to whole steps is not clipping
+    if (fabsf(applied) >= fabsf(requested) - 1.0f) return;
+    if (controller.ki <= 0 || _antiWindup <= 0) return;
+
+    // Shortfall in steps back to integral units. Only unwinds an integral
+    // that pushed in the clipped direction, and never past zero.
+    float shortfall = applied - requested;
+    if (shortfall * controller.integral >= 0) return;
+    float integral = controller.integral + _antiWindup * shortfall / (controller.ki * _stepsPerDegree);
+    controller.integral = integral * controller.integral > 0 ? integral : 0;
+}
+
+float LevelingController::calculatePID(PIController& controller, float measurement, float target, float dt) {
+    // Fraction of a nominal control interval
+    float intervals = dt * 1000.0f / LEVEL_CHECK_INTERVAL_MS;
+    float error = measurement - target;
+    float scale = interpolate(_schedule.errorDeg, _schedule.errorScale, fabsf(error));
+
+    // Proportional term on the weighted target
+    float pTerm = scale * controller.kp * (measurement - _setpointWeight * target);
 
-    // Integral term with anti-windup
-    controller.integral += error;
+    // Integral term, clamped as a last resort (see unwindIntegral). The
+    // schedule scales the integration rate, not the sum, so a change of
+    // factor does not step the output.
+    controller.integral += scale * error * intervals;
     controller.integral = constrain(controller.integral, -INTEGRAL_LIMIT, INTEGRAL_LIMIT);
     float iTerm = controller.ki * controller.integral;
 
-    // Store error for potential derivative term (not used in PI)
-    controller.lastError = error;
+    // Derivative of the measurement (no kick on a target change), per
+    // nominal interval and low-pass filtered
+    if (_primed && intervals > 0) {
+        float rate = (measurement - controller.lastMeasurement) / intervals;
+        controller.derivative += (rate - controller.derivative) * dt / (DERIVATIVE_FILTER_S + dt);
+    }
+    float dTerm = controller.kd * controller.derivative;
 
-    // Calculate output
-    float output = pTerm + iTerm;
+    controller.lastMeasurement = measurement;
 
-    return output;
+    return pTerm + iTerm + dTerm;
 }
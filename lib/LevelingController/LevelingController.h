@@ -6,11 +6,23 @@
 #include "types.h"
 
 /**
- * LevelingController - PI control algorithm for platform leveling
+ * LevelingController - PI(D) control algorithm for platform leveling
  *
- * Uses two independent PI controllers for pitch and roll correction.
+ * Uses two independent controllers for pitch and roll correction.
  * Maps angular errors to motor steps for the two back legs.
  *
+ * Per axis: output = Kp (y - b r) + Ki sum((y - r) dt/T) + Kd dy_f/dt T
+ * where y is the measured angle, r the target (0 = level), b the setpoint
+ * weight, T = LEVEL_CHECK_INTERVAL_MS and y_f the low-pass filtered angle.
+ * Gains are per nominal control interval, so existing gains keep their
+ * meaning, but the integral and derivative follow the measured interval.
+ * The integral is unwound by back-calculation from the steps that were
+ * actually applied (see reportApplied()).
+ *
+ * Gain schedule (GainSchedule): Kp and the integration rate of each axis
+ * are multiplied by a factor interpolated from its |error|, and each
+ * motor's steps by a factor interpolated from its position.
+ *
  * Motor mapping (viewed from above):
  *           FRONT (Fixed Leg)
  *                *
@@ -36,9 +48,21 @@ public:
      * Calculate motor corrections based on current pitch and roll
      * @param pitch Current pitch angle in degrees
      * @param roll Current roll angle in degrees
+     * @param dt Seconds since the previous control interval
      * @return Motor steps for each motor
      */
-    MotorCorrection calculate(float pitch, float roll);
+    MotorCorrection calculate(float pitch, float roll, float dt = LEVEL_CHECK_INTERVAL_MS / 1000.0f);
+
+    /**
+     * Report what applyCorrection() actually moved. Where an axis got less
+     * than it asked for (step cap or position limit), the integral is
+     * moved back by a share (ANTIWINDUP_TRACKING) of the shortfall, toward
+     * zero only, so it does not wind up against a limit it cannot push
+     * through.
+     * @param requested Correction returned by calculate()
+     * @param applied Correction returned by StepperController::applyCorrection()
+     */
+    void reportApplied(const MotorCorrection& requested, const MotorCorrection& applied);
 
     /**
      * Set pitch PI gains
@@ -54,6 +78,44 @@ public:
      */
     void setRollGains(float kp, float ki);
 
+    /**
+     * Set derivative gains (0 = PI)
+     */
+    void setDerivativeGains(float kdPitch, float kdRoll);
+    void getDerivativeGains(float& kdPitch, float& kdRoll) const;
+
+    /**
+     * Target attitude (default level) and the weight of the target in the
+     * proportional term
+     */
+    void setTarget(float pitch, float roll);
+    void setSetpointWeight(float weight) { _setpointWeight = weight; }
+
+    /**
+     * Gain schedule
+     * @return False (schedule unchanged) if a value is NaN or infinite,
+     *         keys are not ascending or a scale is outside
+     *         0..GAIN_SCHED_MAX_SCALE
+     */
+    bool setSchedule(const GainSchedule& schedule);
+    const GainSchedule& getSchedule() const { return _schedule; }
+
+    /**
+     * Built-in schedule from config.h
+     */
+    static GainSchedule defaultSchedule();
+
+    /**
+     * Motor positions for the position schedule (before calculate())
+     */
+    void setMotorPositions(long pos1, long pos2);
+
+    /**
+     * Share of a clipped correction's shortfall taken off the integral per
+     * cycle (0 = no anti-windup beyond INTEGRAL_LIMIT)
+     */
+    void setAntiWindup(float tracking) { _antiWindup = tracking; }
+
     /**
      * Get current pitch gains
      */
@@ -75,20 +137,43 @@ public:
      * @param factor Steps needed to correct one degree of tilt
      */
     void setStepsPerDegree(float factor);
+    float getStepsPerDegree() const { return _stepsPerDegree; }
 
 private:
     PIController _pitchController;
     PIController _rollController;
 
     float _stepsPerDegree;  // Conversion factor from degrees to steps
+    float _pitchTarget;
+    float _rollTarget;
+    float _setpointWeight;
+    float _antiWindup;
+    bool _primed;           // lastMeasurement valid (derivative needs two samples)
+    GainSchedule _schedule;
+    long _position1;
+    long _position2;
+
+    /**
+     * Piecewise-linear lookup, constant past the end points
+     */
+    static float interpolate(const float* keys, const float* values, float x);
 
     /**
-     * Calculate PI output for one axis
-     * @param controller PI controller state
-     * @param error Current error (target - actual)
+     * Calculate controller output for one axis
+     * @param controller Controller state
+     * @param measurement Measured angle
+     * @param target Target angle
+     * @param dt Seconds since the previous interval
      * @return Control output
      */
-    float calculatePI(PIController& controller, float error);
+    float calculatePID(PIController& controller, float measurement, float target, float dt);
+
+    /**
+     * Back-calculate the integral of one axis if its output was cut short
+     * @param requested Axis output in steps before clipping
+     * @param applied Axis output in steps after clipping
+     */
+    void unwindIntegral(PIController& controller, float requested, float applied);
 };
 
 #endif // LEVELING_CONTROLLER_H
@@ -0,0 +1,57 @@
+#include "LoopProfiler.h"
+
+#if LOOP_PROFILER_ENABLED
+
+#define LOOP_STAGE_NAME(id, name) name,
+static const char* const STAGE_NAMES[] = { LOOP_STAGES(LOOP_STAGE_NAME) };
+#undef LOOP_STAGE_NAME
+
+LoopProfiler::LoopProfiler()
+    : _resetPending(false)
+{
+    clear();
+}
+
+void LoopProfiler::clear() {
+    memset(_stages, 0, sizeof(_stages));
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        _stages[i].min = UINT32_MAX;
+    }
+    _resetPending = false;
+}
+
+bool LoopProfiler::getStats(LoopStage stage, StageStats& out) const {
+    // Copy first: the loop task keeps recording while we read
+    Stage s = _stages[stage];
+    if (s.count == 0) return false;
+
+    // p99: walk the histogram to the bucket holding the 99th percentile
+    // sample and interpolate linearly inside it
+    uint32_t target = s.count - s.count / 100;
+    uint32_t below = 0;
+    float p99 = (float)s.max;
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        if (below + s.hist[b] >= target) {
+            float lo = b == 0 ? 0.0f : (float)(1UL << b);
+            float hi = (float)(2ULL << b);
+            p99 = lo + (hi - lo) * (target - below) / s.hist[b];
+            break;
+        }
+        below += s.hist[b];
+    }
+    p99 = constrain(p99, (float)s.min, (float)s.max);
+
+    float cyclesPerUs = ESP.getCpuFreqMHz();
+    out.count = s.count;
+    out.minUs = s.min / cyclesPerUs;
+    out.meanUs = (float)s.sum / s.count / cyclesPerUs;
+    out.p99Us = p99 / cyclesPerUs;
+    out.maxUs = s.max / cyclesPerUs;
+    return true;
+}
+
+const char* LoopProfiler::stageName(uint8_t stage) {
+    return stage < STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
+
+#endif // LOOP_PROFILER_ENABLED
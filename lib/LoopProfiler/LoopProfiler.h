@@ -0,0 +1,127 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * LoopProfiler - Cycle-count timing of loop() stages
+ *
+ * PROFILE_STAGE(STAGE_IMU) at the top of a block times the rest of that
+ * block with ESP.getCycleCount() and adds the duration to the stage's
+ * min / max / sum and a log2 histogram, from which the p99 is estimated.
+ * Stages may nest (STAGE_CONTROL runs inside STAGE_STATE); each one is
+ * inclusive of whatever it encloses. STAGE_CONTROL is the controller's
+ * calculation only; the blocking move that applies it is STAGE_CORRECTION.
+ *
+ * The cycle counter is 32 bits and wraps after 2^32 cycles (17.9 s at
+ * 240 MHz), so a stage longer than that records the remainder. Long
+ * blocking moves and calibrations run from the console inside
+ * STAGE_SERIAL / STAGE_STATE can take that long; reset after them before
+ * reading max and p99.
+ *
+ * Built only with LOOP_PROFILER_ENABLED (config.h or -D in platformio.ini).
+ * Otherwise PROFILE_STAGE expands to nothing and no profiler exists.
+ *
+ * Recording happens on the loop() task only. reset() may be called from
+ * any task; it is applied by the next record.
+ */
+
+#define LOOP_STAGES(X) \
+    X(STAGE_LOOP,      "loop") \
+    X(STAGE_BUTTON,    "button") \
+    X(STAGE_LED,       "led") \
+    X(STAGE_SERIAL,    "serial") \
+    X(STAGE_MOTION,    "motion") \
+    X(STAGE_STATE,     "state") \
+    X(STAGE_IMU,       "imu") \
+    X(STAGE_CONTROL,   "control") \
+    X(STAGE_CORRECTION, "correction") \
+    X(STAGE_TELEMETRY, "telemetry") \
+    X(STAGE_BROADCAST, "broadcast") \
+    X(STAGE_CLEANUP,   "cleanup")
+
+enum LoopStage : uint8_t {
+#define LOOP_STAGE_ID(id, name) id,
+    LOOP_STAGES(LOOP_STAGE_ID)
+#undef LOOP_STAGE_ID
+    STAGE_COUNT
+};
+
+#define PROFILE_BUCKETS 32           // log2 buckets: bucket b holds [2^b, 2^(b+1)) cycles
+
+// Summary of one stage, in microseconds
+struct StageStats {
+    uint32_t count;
+    float minUs;
+    float meanUs;
+    float p99Us;
+    float maxUs;
+};
+
+#if LOOP_PROFILER_ENABLED
+
+class LoopProfiler {
+public:
+    LoopProfiler();
+
+    void record(LoopStage stage, uint32_t cycles) {
+        if (_resetPending) clear();
+        Stage& s = _stages[stage];
+        s.count++;
+        s.sum += cycles;
+        if (cycles < s.min) s.min = cycles;
+        if (cycles > s.max) s.max = cycles;
+        s.hist[31 - __builtin_clz(cycles | 1)]++;
+    }
+
+    /**
+     * Clear all stages (applied on the next record)
+     */
+    void reset() { _resetPending = true; }
+
+    /**
+     * Summarize a stage
+     * @return false if the stage has no samples
+     */
+    bool getStats(LoopStage stage, StageStats& out) const;
+
+    static const char* stageName(uint8_t stage);
+
+private:
+    struct Stage {
+        uint32_t count;
+        uint64_t sum;
+        uint32_t min;
+        uint32_t max;
+        uint32_t hist[PROFILE_BUCKETS];
+    };
+
+    Stage _stages[STAGE_COUNT];
+    volatile bool _resetPending;
+
+    void clear();
+};
+
+extern LoopProfiler loopProfiler;
+
+// Times the rest of the enclosing block
+class ProfileScope {
+public:
+    explicit ProfileScope(LoopStage stage) : _stage(stage), _start(ESP.getCycleCount()) {}
+    ~ProfileScope() { loopProfiler.record(_stage, ESP.getCycleCount() - _start); }
+
+private:
+    LoopStage _stage;
+    uint32_t _start;
+};
+
+#define PROFILE_STAGE(stage) ProfileScope profileScope_##stage(stage)
+
+#else
+
+#define PROFILE_STAGE(stage) ((void)0)
+
+#endif // LOOP_PROFILER_ENABLED
+
+#endif // LOOP_PROFILER_H
@@ -20,6 +20,7 @@ MPU6050Handler::MPU6050Handler()
     , _accelRoll(0)
     , _lastAccelMagnitude(1.0f)
     , _isMoving(false)
+    , _updateCount(0)
 {
     memset(&_rawData, 0, sizeof(_rawData));
     memset(&_data, 0, sizeof(_data));
@@ -39,7 +40,7 @@ bool MPU6050Handler::begin() {
     }
 
     // Verify WHO_AM_I register (should be 0x68)
-    uint8_t whoAmI;
+    uint8_t whoAmI = 0;  // Stays 0 if the read comes back short
     readRegisters(MPU6050_REG_WHO_AM_I, &whoAmI, 1);
     if (whoAmI != 0x68) {
         Serial.printf("MPU6050: Unexpected WHO_AM_I value: 0x%02X\n", whoAmI);
@@ -62,15 +63,16 @@ bool MPU6050Handler::begin() {
     // Set accelerometer range to ±2g
     writeRegister(MPU6050_REG_ACCEL_CONFIG, 0x00);
 
-    _lastUpdateTime = millis();
+    _lastUpdateTime = micros();
 
     Serial.println("MPU6050: Initialized successfully");
     return true;
 }
 
 void MPU6050Handler::update() {
-    unsigned long currentTime = millis();
-    float dt = (currentTime - _lastUpdateTime) / 1000.0f;
+    // micros() so dt stays accurate when streaming at up to 1 kHz
+    unsigned long currentTime = micros();
+    float dt = (currentTime - _lastUpdateTime) / 1000000.0f;
     _lastUpdateTime = currentTime;
 
     // Clamp dt to reasonable values (prevent issues on first call or delays)
@@ -82,6 +84,18 @@ void MPU6050Handler::update() {
     processData();
     applyComplementaryFilter(dt);
     detectMotion();
+    _updateCount++;
+}
+
+void MPU6050Handler::setSampleRate(uint16_t hz) {
+    // Gyro output rate is 1 kHz with the DLPF enabled
+    hz = constrain(hz, 4, 1000);
+    writeRegister(MPU6050_REG_SMPLRT_DIV, (uint8_t)(1000 / hz - 1));
+
+    // Widest DLPF bandwidth under half the rate: 44 Hz up to 195 Hz (the
+    // begin() setting), 94 Hz up to 375 Hz, 184 Hz above. DLPF_CFG 0
+    // (260 Hz) would switch the gyro to 8 kHz, so 184 Hz is the cap.
+    writeRegister(MPU6050_REG_CONFIG, hz >= 376 ? 0x01 : hz >= 196 ? 0x02 : 0x03);
 }
 
 bool MPU6050Handler::calibrate() {
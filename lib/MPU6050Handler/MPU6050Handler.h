@@ -28,6 +28,18 @@ public:
      */
     void update();
 
+    /**
+     * Set the sensor output data rate (SMPLRT_DIV) and widen the low-pass
+     * filter (DLPF) with it, up to 184 Hz
+     * @param hz 4-1000 Hz; begin() configures 100 Hz with a 44 Hz DLPF
+     */
+    void setSampleRate(uint16_t hz);
+
+    /**
+     * Number of update() calls so far, used to detect fresh samples
+     */
+    uint32_t getUpdateCount() const { return _updateCount; }
+
     /**
      * Run calibration routine - platform must be stationary and level
      * @return true if calibration successful
@@ -85,6 +97,8 @@ private:
     float _lastAccelMagnitude;
     bool _isMoving;
 
+    uint32_t _updateCount;
+
     /**
      * Read raw data from sensor
      */
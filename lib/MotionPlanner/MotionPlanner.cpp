@@ -0,0 +1,206 @@
+#include "MotionPlanner.h"
+
+MotionPlanner::MotionPlanner(StepperController& motors)
+    : _motors(motors)
+    , _tail(0)
+    , _count(0)
+    , _endPos1(0)
+    , _endPos2(0)
+    , _endDir1(0)
+    , _endDir2(0)
+    , _mux(portMUX_INITIALIZER_UNLOCKED)
+    , _executing(false)
+    , _done(0)
+    , _err1(0)
+    , _err2(0)
+    , _speed(0.0f)
+    , _nextStepUs(0)
+    , _intervalUs(1)
+{
+}
+
+bool MotionPlanner::queueMove(long steps1, long steps2) {
+    portENTER_CRITICAL(&_mux);
+    if (_count == 0) {
+        _endPos1 = _motors.getPosition1();
+        _endPos2 = _motors.getPosition2();
+    }
+    bool ok = push(_endPos1 + steps1, _endPos2 + steps2);
+    portEXIT_CRITICAL(&_mux);
+    return ok;
+}
+
+bool MotionPlanner::queueTarget(long pos1, long pos2) {
+    portENTER_CRITICAL(&_mux);
+    if (_count == 0) {
+        _endPos1 = _motors.getPosition1();
+        _endPos2 = _motors.getPosition2();
+    }
+    bool ok = push(pos1, pos2);
+    portEXIT_CRITICAL(&_mux);
+    return ok;
+}
+
+bool MotionPlanner::push(long pos1, long pos2) {
+    // Clip up front so no time is planned for steps past a limit
+    long minPos = _motors.getMinPosition();
+    long maxPos = _motors.getMaxPosition();
+    long steps1 = constrain(pos1, minPos, maxPos) - _endPos1;
+    long steps2 = constrain(pos2, minPos, maxPos) - _endPos2;
+
+    if (steps1 == 0 && steps2 == 0) return true;
+    if (_count >= PLANNER_QUEUE_SIZE) return false;
+
+    _endPos1 += steps1;
+    _endPos2 += steps2;
+    steps1 += takeUp(1, steps1, _endDir1);
+    steps2 += takeUp(2, steps2, _endDir2);
+    uint32_t events = max(labs(steps1), labs(steps2));
+
+    Segment& s = _queue[index(_count)];
+    s.steps1 = steps1;
+    s.steps2 = steps2;
+    s.events = events;
+    s.nominalSpeed = max(1000000.0f / _motors.getStepDelayUs(), PLANNER_START_SPEED);
+    s.maxEntrySpeed = PLANNER_START_SPEED;
+
+    if (_count > 0) {
+        // Speed change of each motor at the corner per unit of path speed;
+        // 0 for a straight continuation, up to 2 for a full reversal
+        const Segment& prev = _queue[index(_count - 1)];
+        float dv1 = fabsf((float)prev.steps1 / prev.events - (float)steps1 / events);
+        float dv2 = fabsf((float)prev.steps2 / prev.events - (float)steps2 / events);
+        float dv = max(dv1, dv2);
+        float limit = min(s.nominalSpeed, prev.nominalSpeed);
+        float junction = dv > 0.0f ? PLANNER_JERK / dv : limit;
+        s.maxEntrySpeed = constrain(junction, PLANNER_START_SPEED, limit);
+    }
+
+    _count++;
+    replan();
+    return true;
+}
+
+long MotionPlanner::takeUp(uint8_t motor, long steps, int& endDir) const {
+    if (steps == 0) return 0;
+    int dir = steps > 0 ? 1 : -1;
+
+    // Nothing queued: the motor knows exactly what is pending
+    long extra = _count == 0 ? _motors.takeUpFor(motor, steps)
+               : (endDir != 0 && dir != endDir) ? dir * (long)_motors.getBacklash(motor) : 0;
+    endDir = dir;
+    return extra;
+}
+
+void MotionPlanner::replan() {
+    // The executing segment has already started at its entry speed
+    int first = _executing ? 1 : 0;
+
+    // Reverse: the queue ends at standstill, so each segment may only be
+    // entered as fast as it can still brake down to the next one
+    float exitSpeed = PLANNER_START_SPEED;
+    for (int i = _count - 1; i >= first; i--) {
+        Segment& s = _queue[index(i)];
+        s.entrySpeed = min(s.maxEntrySpeed, reachable(exitSpeed, s.events));
+        exitSpeed = s.entrySpeed;
+    }
+
+    // Forward: and no faster than the previous segment can accelerate to
+    for (int i = 1; i < _count; i++) {
+        const Segment& prev = _queue[index(i - 1)];
+        Segment& s = _queue[index(i)];
+        s.entrySpeed = min(s.entrySpeed, reachable(prev.entrySpeed, prev.events));
+    }
+}
+
+void MotionPlanner::startSegment() {
+    const Segment& s = _queue[_tail];
+    _done = 0;
+    _err1 = s.events / 2;
+    _err2 = s.events / 2;
+    _executing = true;
+}
+
+void MotionPlanner::run() {
+    uint32_t now = micros();
+
+    if (!_executing) {
+        portENTER_CRITICAL(&_mux);
+        if (_count > 0) startSegment();
+        portEXIT_CRITICAL(&_mux);
+        if (!_executing) return;
+
+        // From standstill: first step now
+        _speed = PLANNER_START_SPEED;
+        _nextStepUs = now;
+    }
+
+    if ((int32_t)(now - _nextStepUs) < 0) {
+        _motors.interpolate(1.0f - (float)(_nextStepUs - now) / _intervalUs);
+        return;
+    }
+
+    // One step event of the executing segment (Bresenham as in moveBoth)
+    portENTER_CRITICAL(&_mux);
+    if (!_executing) {
+        // stop() from another task
+        portEXIT_CRITICAL(&_mux);
+        return;
+    }
+    const Segment& s = _queue[_tail];
+    int dir1 = 0;
+    int dir2 = 0;
+    _err1 -= labs(s.steps1);
+    if (_err1 < 0) {
+        _err1 += s.events;
+        dir1 = s.steps1 > 0 ? 1 : -1;
+    }
+    _err2 -= labs(s.steps2);
+    if (_err2 < 0) {
+        _err2 += s.events;
+        dir2 = s.steps2 > 0 ? 1 : -1;
+    }
+
+    if (++_done >= s.events) {
+        _tail = index(1);
+        _count--;
+        _executing = false;
+        if (_count > 0) startSegment();
+    }
+
+    // Speed until the next step: accelerate, cruise, or brake so the
+    // segment ends at the next one's entry speed
+    float stepSpeed = 0.0f;
+    if (_executing) {
+        const Segment& cur = _queue[_tail];
+        float exitSpeed = _count > 1 ? _queue[index(1)].entrySpeed : PLANNER_START_SPEED;
+        stepSpeed = min(cur.nominalSpeed, reachable(_speed, 1));
+        stepSpeed = min(stepSpeed, reachable(exitSpeed, cur.events - _done));
+        stepSpeed = max(stepSpeed, PLANNER_START_SPEED);
+    }
+    portEXIT_CRITICAL(&_mux);
+
+    _motors.step(dir1, dir2);
+
+    if (stepSpeed > 0.0f) {
+        // Stay on schedule after a short delay in loop(), but never bunch
+        // steps closer than half an interval after a long one
+        uint32_t interval = (uint32_t)(1000000.0f / stepSpeed);
+        _speed = stepSpeed;
+        _nextStepUs += interval;
+        if ((int32_t)(_nextStepUs - now) < (int32_t)(interval / 2)) {
+            _nextStepUs = now + interval / 2;
+        }
+        _intervalUs = _nextStepUs - now;
+    } else {
+        // Last step of the queue
+        _motors.interpolate(1.0f);
+    }
+}
+
+void MotionPlanner::stop() {
+    portENTER_CRITICAL(&_mux);
+    _count = 0;
+    _executing = false;
+    portEXIT_CRITICAL(&_mux);
+}
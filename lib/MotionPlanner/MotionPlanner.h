@@ -0,0 +1,140 @@
+#ifndef MOTION_PLANNER_H
+#define MOTION_PLANNER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "StepperController.h"
+
+/**
+ * MotionPlanner - Queued, blended two-axis moves for the stepper motors
+ *
+ * Moves are queued as straight segments in (motor 1, motor 2) step space and
+ * executed from loop() by run(), which issues at most one step event per call
+ * when it is due. Each segment accelerates and decelerates with a trapezoidal
+ * profile; instead of stopping between segments, the planner looks ahead over
+ * the whole queue and passes each junction at the highest speed that
+ *   - keeps the speed change of each motor at the corner within PLANNER_JERK,
+ *   - lets every later segment still brake to a stop by the end of the queue.
+ * A straight run of segments (continuous rotation) therefore runs at full
+ * speed without stuttering.
+ *
+ * Speeds are step events per second along the segment's dominant axis; the
+ * other motor is interleaved with Bresenham as in StepperController::moveBoth.
+ * Cruise speed is taken from StepperController::setSpeed when a segment is
+ * queued. Targets are clipped to the position limits when queued, and a
+ * segment that reverses a motor gets its backlash take-up steps added. With
+ * microstepping on, run() also sweeps the coil phases between steps.
+ *
+ * Queueing and stop() may be called from other tasks (dashboard callbacks);
+ * run() must only be called from loop().
+ */
+class MotionPlanner {
+public:
+    explicit MotionPlanner(StepperController& motors);
+
+    /**
+     * Queue a relative move of both motors
+     * @return false if the queue is full
+     */
+    bool queueMove(long steps1, long steps2);
+
+    /**
+     * Queue a move to absolute positions
+     * @return false if the queue is full
+     */
+    bool queueTarget(long pos1, long pos2);
+
+    /**
+     * Issue the next step if it is due; call every loop()
+     */
+    void run();
+
+    /**
+     * Drop all queued segments and stop immediately (coils stay energized)
+     */
+    void stop();
+
+    /**
+     * True while a segment is executing or queued
+     */
+    bool isBusy() const { return _count > 0; }
+
+    /**
+     * Number of queued segments, including the executing one
+     */
+    uint8_t queued() const { return _count; }
+
+    /**
+     * Free queue slots
+     */
+    uint8_t space() const { return PLANNER_QUEUE_SIZE - _count; }
+
+    /**
+     * Current step rate in steps/s (0 when idle)
+     */
+    float getSpeed() const { return _executing ? _speed : 0.0f; }
+
+private:
+    struct Segment {
+        long steps1;           // Signed steps for each motor
+        long steps2;
+        uint32_t events;       // Steps of the dominant axis
+        float nominalSpeed;    // Cruise speed (steps/s)
+        float maxEntrySpeed;   // Junction limit with the previous segment
+        float entrySpeed;      // Planned speed at the start of this segment
+    };
+
+    StepperController& _motors;
+    Segment _queue[PLANNER_QUEUE_SIZE];
+    uint8_t _tail;             // Oldest segment (executing when _executing)
+    uint8_t _count;
+    long _endPos1;             // Position at the end of the last queued segment
+    long _endPos2;
+    int _endDir1;              // Direction of the last queued move of each motor
+    int _endDir2;
+    mutable portMUX_TYPE _mux;
+
+    // Execution state of the segment at _tail (loop task only)
+    volatile bool _executing;
+    uint32_t _done;            // Step events issued in this segment
+    long _err1;
+    long _err2;
+    float _speed;              // Current step rate
+    uint32_t _nextStepUs;
+    uint32_t _intervalUs;      // Time from the last step to _nextStepUs
+
+    uint8_t index(uint8_t offset) const { return (_tail + offset) % PLANNER_QUEUE_SIZE; }
+
+    /**
+     * Append a segment from _endPos to the target, clipped to the motor
+     * limits, and replan. Called with _mux held.
+     * @return false if the queue is full
+     */
+    bool push(long pos1, long pos2);
+
+    /**
+     * Uncounted take-up steps a segment needs (see StepperController)
+     */
+    long takeUp(uint8_t motor, long steps, int& endDir) const;
+
+    /**
+     * Recompute entry speeds of all segments after the executing one:
+     * a reverse pass so each can brake in time, then a forward pass so each
+     * is reachable from the one before. Called with _mux held.
+     */
+    void replan();
+
+    /**
+     * Start the segment at _tail. Called with _mux held.
+     */
+    void startSegment();
+
+    /**
+     * Speed reachable after accelerating from v over the given steps
+     */
+    static float reachable(float v, uint32_t steps) {
+        return sqrtf(v * v + 2.0f * PLANNER_ACCEL * steps);
+    }
+};
+
+#endif // MOTION_PLANNER_H
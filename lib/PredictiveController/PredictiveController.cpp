@@ -0,0 +1,151 @@
+#include "PredictiveController.h"
+
+// Plant model: tilt change (pitch, roll) per step of each motor
+static const float J[2][2] = {
+    {PLANT_M1_PITCH_PER_STEP, PLANT_M2_PITCH_PER_STEP},
+    {PLANT_M1_ROLL_PER_STEP,  PLANT_M2_ROLL_PER_STEP},
+};
+
+PredictiveController::PredictiveController()
+    : _pitchTarget(0)
+    , _rollTarget(0)
+    , _predictedError(0)
+{
+    float jj = J[0][0] * J[0][0] + J[0][1] * J[0][1] + J[1][0] * J[1][0] + J[1][1] * J[1][1];
+    _stepWeight = MPC_STEP_WEIGHT * MPC_STEP_WEIGHT * jj * 0.5f;
+    _travelWeight = MPC_TRAVEL_COST_DEG * MPC_TRAVEL_COST_DEG /
+                    ((float)MPC_TRAVEL_MARGIN_STEPS * MPC_TRAVEL_MARGIN_STEPS);
+    _terminalWeight = MPC_TERMINAL_WEIGHT * jj * 0.5f;
+
+    float det = J[0][0] * J[1][1] - J[0][1] * J[1][0];
+    _inverse[0][0] = J[1][1] / det;
+    _inverse[0][1] = -J[0][1] / det;
+    _inverse[1][0] = -J[1][0] / det;
+    _inverse[1][1] = J[0][0] / det;
+
+    // Hessian = A'A (x) 2 (J'J + travel) + 2 stepWeight I, with A the
+    // lower-triangular ones (positions are running sums of the steps);
+    // |A'A| <= N(N+1)/2 (largest row sum) and |J'J| <= trace; the
+    // terminal cost adds 2 terminalWeight x all-ones (norm N)
+    const float n = MPC_HORIZON;
+    _lipschitz = n * (n + 1) / 2 * 2 * (jj + _travelWeight) + 2 * _stepWeight + 2 * _terminalWeight * n;
+
+    setLimits(MOTOR_MIN_POSITION, MOTOR_MAX_POSITION);
+    reset();
+}
+
+void PredictiveController::setTarget(float pitch, float roll) {
+    _pitchTarget = pitch;
+    _rollTarget = roll;
+}
+
+void PredictiveController::setLimits(long minPos, long maxPos) {
+    _minPos = minPos;
+    _maxPos = maxPos;
+}
+
+void PredictiveController::reset() {
+    memset(_u, 0, sizeof(_u));
+    _predictedError = 0;
+}
+
+float PredictiveController::travelGradient(float p) const {
+    float low = _minPos + MPC_TRAVEL_MARGIN_STEPS;
+    float high = _maxPos - MPC_TRAVEL_MARGIN_STEPS;
+    if (p < low) return 2 * _travelWeight * (p - low);
+    if (p > high) return 2 * _travelWeight * (p - high);
+    return 0;
+}
+
+void PredictiveController::gradient(const float u[][2], float e0, float e1, float p1, float p2,
+                                    float g[][2]) const {
+    // Steps still needed after the horizon: J^-1 e0 + sum of u
+    // Forward: predicted error and positions after each interval; r_k is
+    // the cost gradient with respect to the positions at interval k
+    float r[MPC_HORIZON][2];
+    float s1 = 0, s2 = 0;
+    for (int k = 0; k < MPC_HORIZON; k++) {
+        s1 += u[k][0];
+        s2 += u[k][1];
+        float ep = e0 + J[0][0] * s1 + J[0][1] * s2;
+        float er = e1 + J[1][0] * s1 + J[1][1] * s2;
+        r[k][0] = 2 * (J[0][0] * ep + J[1][0] * er) + travelGradient(p1 + s1);
+        r[k][1] = 2 * (J[0][1] * ep + J[1][1] * er) + travelGradient(p2 + s2);
+    }
+    r[MPC_HORIZON - 1][0] += 2 * _terminalWeight * (_inverse[0][0] * e0 + _inverse[0][1] * e1 + s1);
+    r[MPC_HORIZON - 1][1] += 2 * _terminalWeight * (_inverse[1][0] * e0 + _inverse[1][1] * e1 + s2);
+
+    // Backward: steps in interval j move every position from j on
+    float a1 = 0, a2 = 0;
+    for (int j = MPC_HORIZON - 1; j >= 0; j--) {
+        a1 += r[j][0];
+        a2 += r[j][1];
+        g[j][0] = a1 + 2 * _stepWeight * u[j][0];
+        g[j][1] = a2 + 2 * _stepWeight * u[j][1];
+    }
+}
+
+void PredictiveController::project(float u[][2], float p1, float p2) const {
+    for (int k = 0; k < MPC_HORIZON; k++) {
+        u[k][0] = constrain(u[k][0], max(-(float)MAX_CORRECTION_STEPS, _minPos - p1),
+                                     min((float)MAX_CORRECTION_STEPS, _maxPos - p1));
+        u[k][1] = constrain(u[k][1], max(-(float)MAX_CORRECTION_STEPS, _minPos - p2),
+                                     min((float)MAX_CORRECTION_STEPS, _maxPos - p2));
+        p1 += u[k][0];
+        p2 += u[k][1];
+    }
+}
+
+MotorCorrection PredictiveController::calculate(float pitch, float roll, long pos1, long pos2) {
+    float e0 = pitch - _pitchTarget;
+    float e1 = roll - _rollTarget;
+    float p1 = constrain((float)pos1, _minPos, _maxPos);
+    float p2 = constrain((float)pos2, _minPos, _maxPos);
+
+    // Warm start: last plan shifted by one interval
+    float x[MPC_HORIZON][2];
+    for (int k = 0; k < MPC_HORIZON; k++) {
+        int from = min(k + 1, MPC_HORIZON - 1);
+        x[k][0] = _u[from][0];
+        x[k][1] = _u[from][1];
+    }
+    project(x, p1, p2);
+
+    float y[MPC_HORIZON][2];
+    float g[MPC_HORIZON][2];
+    memcpy(y, x, sizeof(y));
+    float t = 1.0f;
+    for (int it = 0; it < MPC_ITERATIONS; it++) {
+        gradient(y, e0, e1, p1, p2, g);
+        float next[MPC_HORIZON][2];
+        for (int k = 0; k < MPC_HORIZON; k++) {
+            next[k][0] = y[k][0] - g[k][0] / _lipschitz;
+            next[k][1] = y[k][1] - g[k][1] / _lipschitz;
+        }
+        project(next, p1, p2);
+
+        float tNext = (1.0f + sqrtf(1.0f + 4.0f * t * t)) * 0.5f;
+        float momentum = (t - 1.0f) / tNext;
+        for (int k = 0; k < MPC_HORIZON; k++) {
+            y[k][0] = next[k][0] + momentum * (next[k][0] - x[k][0]);
+            y[k][1] = next[k][1] + momentum * (next[k][1] - x[k][1]);
+        }
+        memcpy(x, next, sizeof(x));
+        t = tNext;
+    }
+    memcpy(_u, x, sizeof(_u));
+
+    float s1 = 0, s2 = 0;
+    for (int k = 0; k < MPC_HORIZON; k++) {
+        s1 += x[k][0];
+        s2 += x[k][1];
+    }
+    float ep = e0 + J[0][0] * s1 + J[0][1] * s2;
+    float er = e1 + J[1][0] * s1 + J[1][1] * s2;
+    _predictedError = sqrtf(ep * ep + er * er);
+
+    MotorCorrection correction;
+    correction.motor1Steps = lroundf(x[0][0]);
+    correction.motor2Steps = lroundf(x[0][1]);
+    return correction;
+}
@@ -0,0 +1,92 @@
+#ifndef PREDICTIVE_CONTROLLER_H
+#define PREDICTIVE_CONTROLLER_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+/**
+ * PredictiveController - Model-predictive leveling with travel limits
+ *
+ * Alternative to the PI controllers (`mpc on`). Every control interval it
+ * plans the steps of both motors over the next MPC_HORIZON intervals with
+ * the identified plant model (PLANT_* in config.h), minimizing
+ *
+ *   sum_k |e_k|^2 + (w g)^2 |u_k|^2 + c(p_k)  +  T g^2 |J^-1 e_N|^2
+ *
+ * where e_k is the predicted pitch/roll error after interval k, u_k the
+ * steps in interval k, p_k the predicted motor positions and c a penalty
+ * on legs within MPC_TRAVEL_MARGIN_STEPS of a limit. Summing the error
+ * over the horizon rewards reaching level early. The step term, with g the
+ * mean tilt per step and w = MPC_STEP_WEIGHT, avoids spending steps for
+ * little gain. A large correction takes longer than the horizon; the
+ * terminal term (T = MPC_TERMINAL_WEIGHT) on the steps each motor still
+ * needs after it keeps the plan heading straight for the target instead of
+ * fixing the axis that responds fastest first and backtracking later.
+ * Every u_k is limited to MAX_CORRECTION_STEPS per motor, and every p_k
+ * to the position limits. Only the first interval's steps are applied;
+ * the rest warm-starts the next solve.
+ *
+ * The QP is solved by accelerated projected gradient (FISTA) with a fixed
+ * MPC_ITERATIONS, so the solve time is bounded (a few thousand flops). The
+ * projection clips each interval's steps to the step limit and to what
+ * keeps the position within limits after the previous intervals.
+ *
+ * With the front leg fixed, the attitude determines both leg positions, so
+ * the legs cannot be re-centred without tilting. The travel penalty
+ * therefore only biases the result (by hundredths of a degree) when a leg
+ * is near a limit; the hard limits make a leg that cannot follow leave the
+ * whole correction to the other one, in the least-squares sense.
+ */
+class PredictiveController {
+public:
+    PredictiveController();
+
+    /**
+     * Target attitude in degrees (0, 0 = level)
+     */
+    void setTarget(float pitch, float roll);
+
+    /**
+     * Motor position limits the plan must stay within
+     */
+    void setLimits(long minPos, long maxPos);
+
+    /**
+     * Drop the warm start (new leveling cycle)
+     */
+    void reset();
+
+    /**
+     * Plan and return the steps for the coming interval
+     * @param pitch Current pitch in degrees
+     * @param roll Current roll in degrees
+     * @param pos1 Current motor 1 position
+     * @param pos2 Current motor 2 position
+     */
+    MotorCorrection calculate(float pitch, float roll, long pos1, long pos2);
+
+    /**
+     * Predicted |error| at the end of the horizon from the last plan (deg)
+     */
+    float getPredictedError() const { return _predictedError; }
+
+private:
+    float _u[MPC_HORIZON][2];   // Planned steps per interval and motor
+    float _pitchTarget;
+    float _rollTarget;
+    float _minPos;
+    float _maxPos;
+    float _stepWeight;          // (w g)^2
+    float _travelWeight;        // Travel penalty per step^2 outside the margin
+    float _terminalWeight;      // T g^2
+    float _inverse[2][2];       // J^-1: steps per degree of pitch, roll
+    float _lipschitz;           // Bound on the largest Hessian eigenvalue
+    float _predictedError;
+
+    void gradient(const float u[][2], float e0, float e1, float p1, float p2, float g[][2]) const;
+    void project(float u[][2], float p1, float p2) const;
+    float travelGradient(float p) const;
+};
+
+#endif // PREDICTIVE_CONTROLLER_H
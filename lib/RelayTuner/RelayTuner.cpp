@@ -0,0 +1,141 @@
+#include "RelayTuner.h"
+
+RelayTuner::RelayTuner()
+    : _state(State::IDLE)
+    , _failure(nullptr)
+    , _center(0)
+    , _relay(0)
+    , _hysteresis(0)
+    , _output(0)
+    , _startMs(0)
+    , _inCycle(false)
+    , _cycleStartMs(0)
+    , _cycleMax(0)
+    , _cycleMin(0)
+    , _cycles(0)
+    , _periodSum(0)
+    , _amplitudeSum(0)
+    , _ku(0)
+    , _tu(0)
+    , _amplitude(0)
+{
+}
+
+void RelayTuner::begin(unsigned long nowMs, float center, float relay, float hysteresis) {
+    _state = State::RUNNING;
+    _failure = nullptr;
+    _center = center;
+    _relay = relay;
+    _hysteresis = hysteresis;
+    _output = relay;    // Push down first; the first half-cycle is skipped anyway
+    _startMs = nowMs;
+    _inCycle = false;
+    _cycles = 0;
+    _periodSum = 0;
+    _amplitudeSum = 0;
+    _ku = 0;
+    _tu = 0;
+    _amplitude = 0;
+}
+
+float RelayTuner::update(unsigned long nowMs, float measurement) {
+    if (_state != State::RUNNING) return 0;
+
+    float deviation = measurement - _center;
+    if (fabsf(deviation) > AUTOTUNE_MAX_DEVIATION_DEG) {
+        fail("angle out of range");
+        return 0;
+    }
+    if (nowMs - _startMs > AUTOTUNE_TIMEOUT_MS) {
+        fail("no steady oscillation");
+        return 0;
+    }
+
+    _cycleMax = max(_cycleMax, measurement);
+    _cycleMin = min(_cycleMin, measurement);
+
+    if (_output < 0 && deviation > _hysteresis) {
+        // Switch to +d: one full cycle since the previous switch to +d
+        _output = _relay;
+        if (_inCycle) {
+            if (++_cycles > AUTOTUNE_SKIP_CYCLES) {
+                _periodSum += (nowMs - _cycleStartMs) / 1000.0f;
+                _amplitudeSum += (_cycleMax - _cycleMin) * 0.5f;
+            }
+            if (_cycles >= AUTOTUNE_SKIP_CYCLES + AUTOTUNE_CYCLES) {
+                finish();
+                return 0;
+            }
+        }
+        _inCycle = true;
+        _cycleStartMs = nowMs;
+        _cycleMax = _cycleMin = measurement;
+    } else if (_output > 0 && deviation < -_hysteresis) {
+        _output = -_relay;
+    }
+
+    return _output;
+}
+
+void RelayTuner::cancel() {
+    if (_state == State::RUNNING) fail("cancelled");
+}
+
+void RelayTuner::fail(const char* reason) {
+    _state = State::FAILED;
+    _failure = reason;
+}
+
+void RelayTuner::finish() {
+    _tu = _periodSum / AUTOTUNE_CYCLES;
+    _amplitude = _amplitudeSum / AUTOTUNE_CYCLES;
+
+    // Within the hysteresis band the describing function is undefined
+    // (and the oscillation is mostly noise)
+    if (_amplitude <= _hysteresis * 1.1f) {
+        fail("oscillation too small");
+        return;
+    }
+    _ku = 4.0f * _relay / ((float)M_PI * sqrtf(_amplitude * _amplitude - _hysteresis * _hysteresis));
+    _state = State::DONE;
+}
+
+void RelayTuner::computeGains(TuneRule rule, float ku, float tu, float& kp, float& ki) {
+    float ti;
+    switch (rule) {
+        case TuneRule::ZIEGLER_NICHOLS:
+            kp = 0.45f * ku;
+            ti = tu / 1.2f;
+            break;
+        case TuneRule::TYREUS_LUYBEN:
+            kp = ku / 3.2f;
+            ti = 2.2f * tu;
+            break;
+        case TuneRule::SIMC:
+        default:
+            // Integrating plant k e^(-theta s) / s: the relay gives
+            // Tu = 4 theta and Ku = pi / (2 k theta). With tau_c = theta,
+            // Kp = 1 / (2 k theta) and Ti = 8 theta.
+            kp = ku / (float)M_PI;
+            ti = 2.0f * tu;
+            break;
+    }
+    ki = kp * (LEVEL_CHECK_INTERVAL_MS / 1000.0f) / ti;
+}
+
+const char* RelayTuner::ruleName(TuneRule rule) {
+    switch (rule) {
+        case TuneRule::ZIEGLER_NICHOLS: return "zn";
+        case TuneRule::TYREUS_LUYBEN:   return "tl";
+        case TuneRule::SIMC:            return "simc";
+    }
+    return "?";
+}
+
+bool RelayTuner::parseRule(const char* name, TuneRule& rule) {
+    if (strcmp(name, "zn") == 0) rule = TuneRule::ZIEGLER_NICHOLS;
+    else if (strcmp(name, "tl") == 0) rule = TuneRule::TYREUS_LUYBEN;
+    else if (strcmp(name, "simc") == 0) rule = TuneRule::SIMC;
+    else return false;
+    return true;
+}
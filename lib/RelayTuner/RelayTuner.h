@@ -0,0 +1,132 @@
+#ifndef RELAY_TUNER_H
+#define RELAY_TUNER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * RelayTuner - Relay-feedback (Astrom-Hagglund) auto-tuning of one axis
+ *
+ * Instead of the PI controller, a relay drives the axis: a fixed correction
+ * of +d while the angle is above the centre, -d below, switching with a
+ * small hysteresis band so IMU noise does not chatter the relay. The loop
+ * settles into a limit cycle whose period is the ultimate period Tu, and
+ * whose amplitude a gives the ultimate gain from the describing function
+ * of a relay with hysteresis e:
+ *
+ *   Ku = 4 d / (pi sqrt(a^2 - e^2))
+ *
+ * d and Ku are in the controller's degree units: a relay of n steps is
+ * passed as d = n / stepsPerDegree, the same scaling LevelingController
+ * applies to its output, so Ku is directly a proportional gain for it.
+ * The first AUTOTUNE_SKIP_CYCLES cycles are ignored while the oscillation
+ * builds up; period and amplitude are averaged over the next
+ * AUTOTUNE_CYCLES.
+ *
+ * computeGains() turns Ku and Tu into PI gains with one of the rules in
+ * TuneRule. The platform is an integrating plant (steps change the tilt
+ * rate, not the tilt) with dead time, for which SIMC is the most
+ * conservative; Ziegler-Nichols is the most aggressive.
+ */
+
+enum class TuneRule : uint8_t {
+    ZIEGLER_NICHOLS,    // Kp = 0.45 Ku, Ti = Tu / 1.2
+    TYREUS_LUYBEN,      // Kp = Ku / 3.2, Ti = 2.2 Tu
+    SIMC,               // Kp = Ku / pi, Ti = 2 Tu (integrating plant, tau_c = dead time)
+};
+
+class RelayTuner {
+public:
+    enum class State : uint8_t {
+        IDLE,
+        RUNNING,
+        DONE,
+        FAILED
+    };
+
+    RelayTuner();
+
+    /**
+     * Start an experiment around the current angle
+     * @param nowMs Current time (millis())
+     * @param center Angle to oscillate around
+     * @param relay Relay output d (controller degrees: steps / stepsPerDegree)
+     * @param hysteresis Switching band e either side of the centre (degrees)
+     */
+    void begin(unsigned long nowMs, float center, float relay, float hysteresis);
+
+    /**
+     * Feed one measurement; call every control interval while running
+     * @return Relay output (+d or -d), 0 once the experiment has ended
+     */
+    float update(unsigned long nowMs, float measurement);
+
+    /**
+     * Abort the experiment (state FAILED, reason "cancelled")
+     */
+    void cancel();
+
+    State getState() const { return _state; }
+    bool isRunning() const { return _state == State::RUNNING; }
+
+    /**
+     * Why the experiment failed (string literal), nullptr otherwise
+     */
+    const char* getFailure() const { return _failure; }
+
+    /**
+     * Results, valid in state DONE
+     */
+    float getUltimateGain() const { return _ku; }
+    float getUltimatePeriod() const { return _tu; }     // Seconds
+    float getAmplitude() const { return _amplitude; }   // Degrees
+
+    /**
+     * Completed cycles so far (including skipped ones)
+     */
+    int getCycles() const { return _cycles; }
+
+    /**
+     * PI gains from Ku and Tu. Ki is per LEVEL_CHECK_INTERVAL_MS, as used
+     * by LevelingController.
+     */
+    static void computeGains(TuneRule rule, float ku, float tu, float& kp, float& ki);
+
+    /**
+     * Short rule name ("zn", "tl", "simc")
+     */
+    static const char* ruleName(TuneRule rule);
+
+    /**
+     * Parse a short rule name
+     * @return false if unknown
+     */
+    static bool parseRule(const char* name, TuneRule& rule);
+
+private:
+    State _state;
+    const char* _failure;
+
+    float _center;
+    float _relay;
+    float _hysteresis;
+    float _output;
+    unsigned long _startMs;
+
+    bool _inCycle;                  // Switched to +d at least once
+    unsigned long _cycleStartMs;    // Last switch to +d
+    float _cycleMax;
+    float _cycleMin;
+    int _cycles;
+    float _periodSum;
+    float _amplitudeSum;
+
+    float _ku;
+    float _tu;
+    float _amplitude;
+
+    void fail(const char* reason);
+    void finish();
+};
+
+#endif // RELAY_TUNER_H
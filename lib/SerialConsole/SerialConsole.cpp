@@ -0,0 +1,41 @@
+#include "SerialConsole.h"
+
+CommandArgs::CommandArgs(char* line)
+    : _argc(0)
+    , _tooMany(false)
+{
+    char* p = line;
+    while (*p) {
+        // Clearing the separator also terminates the previous token
+        while (*p == ' ' || *p == '\t') *p++ = '\0';
+        if (!*p) break;
+        if (_argc > CONSOLE_MAX_ARGS) {
+            _tooMany = true;
+            break;
+        }
+        _argv[_argc++] = p;
+        while (*p && *p != ' ' && *p != '\t') p++;
+    }
+}
+
+bool CommandArgs::is(uint8_t i, const char* word) const {
+    return has(i) && SerialConsole::compare(_argv[i + 1], word) == 0;
+}
+
+bool CommandArgs::getInt(uint8_t i, long& out) const {
+    if (!has(i)) return false;
+    char* end;
+    long value = strtol(_argv[i + 1], &end, 10);
+    if (end == _argv[i + 1] || *end != '\0') return false;
+    out = value;
+    return true;
+}
+
+bool CommandArgs::getFloat(uint8_t i, float& out) const {
+    if (!has(i)) return false;
+    char* end;
+    float value = strtof(_argv[i + 1], &end);
+    if (end == _argv[i + 1] || *end != '\0') return false;
+    out = value;
+    return true;
+}
@@ -0,0 +1,124 @@
+#ifndef SERIAL_CONSOLE_H
+#define SERIAL_CONSOLE_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+/**
+ * SerialConsole - Allocation-free command parsing and dispatch
+ *
+ * A console line is split in place into whitespace-separated tokens, and the
+ * first token is looked up by binary search in a table sorted by name
+ * (case-insensitive). Tables are constexpr, so their order is checked at
+ * compile time:
+ *
+ *   static constexpr ConsoleCommand COMMANDS[] = {{"help", cmdHelp}, ...};
+ *   static_assert(SerialConsole::isSorted(COMMANDS), "COMMANDS must be sorted");
+ */
+
+#define CONSOLE_MAX_ARGS 8
+
+class CommandArgs {
+public:
+    /**
+     * Tokenize line in place (the buffer must outlive this object)
+     */
+    explicit CommandArgs(char* line);
+
+    /**
+     * Command name, or nullptr for a blank line
+     */
+    const char* name() const { return _argc > 0 ? _argv[0] : nullptr; }
+
+    /**
+     * Number of arguments after the command name
+     */
+    uint8_t count() const { return _argc > 0 ? _argc - 1 : 0; }
+
+    bool has(uint8_t i) const { return i < count(); }
+
+    /**
+     * True if the line had more than CONSOLE_MAX_ARGS arguments (the rest
+     * are dropped; the command should not run)
+     */
+    bool tooMany() const { return _tooMany; }
+
+    /**
+     * Argument i as text, "" if missing
+     */
+    const char* str(uint8_t i) const { return has(i) ? _argv[i + 1] : ""; }
+
+    /**
+     * True if argument i equals word (case-insensitive)
+     */
+    bool is(uint8_t i, const char* word) const;
+
+    /**
+     * Parse argument i as an integer
+     * @return false if missing or not a whole number (out is unchanged)
+     */
+    bool getInt(uint8_t i, long& out) const;
+
+    /**
+     * Parse argument i as a float
+     * @return false if missing or not a number (out is unchanged)
+     */
+    bool getFloat(uint8_t i, float& out) const;
+
+private:
+    char* _argv[CONSOLE_MAX_ARGS + 1];
+    uint8_t _argc;
+    bool _tooMany;
+};
+
+struct ConsoleCommand {
+    const char* name;
+    void (*handler)(const CommandArgs& args);
+};
+
+namespace SerialConsole {
+
+constexpr char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+// Case-insensitive strcmp usable in constant expressions
+constexpr int compare(const char* a, const char* b) {
+    return (lower(*a) != lower(*b) || *a == '\0')
+        ? (int)(unsigned char)lower(*a) - (int)(unsigned char)lower(*b)
+        : compare(a + 1, b + 1);
+}
+
+/**
+ * True if table entries are in strictly increasing name order
+ * (any struct whose first member is `const char* name`)
+ */
+template <typename T, size_t N>
+constexpr bool isSorted(const T (&table)[N], size_t i = 1) {
+    return i >= N || (compare(table[i - 1].name, table[i].name) < 0 && isSorted(table, i + 1));
+}
+
+/**
+ * Binary search a sorted table by name
+ * @return Matching entry, or nullptr
+ */
+template <typename T, size_t N>
+const T* find(const T (&table)[N], const char* name) {
+    size_t lo = 0;
+    size_t hi = N;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        int c = compare(name, table[mid].name);
+        if (c == 0) return &table[mid];
+        if (c < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace SerialConsole
+
+#endif // SERIAL_CONSOLE_H
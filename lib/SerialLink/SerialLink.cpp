@@ -0,0 +1,101 @@
+#include "SerialLink.h"
+
+SerialLink::SerialLink()
+    : _port(nullptr)
+    , _lineLen(0)
+    , _lineOverflow(false)
+    , _rxLen(0)
+    , _inFrame(false)
+    , _rxOverflow(false)
+    , _badFrames(0)
+{
+}
+
+void SerialLink::begin(HardwareSerial& port) {
+    _port = &port;
+}
+
+void SerialLink::poll() {
+    if (!_port) return;
+
+    int available = _port->available();
+    while (available-- > 0) {
+        uint8_t c = _port->read();
+
+        if (c == 0) {
+            // A zero either opens a frame or closes one. Back-to-back
+            // delimiters (closing one frame, opening the next) leave an
+            // empty frame, which simply keeps us in frame mode.
+            if (_inFrame && _rxLen > 0) {
+                handleFrame();
+                _inFrame = false;
+            } else {
+                _inFrame = true;
+            }
+            _rxLen = 0;
+            _rxOverflow = false;
+            continue;
+        }
+
+        if (_inFrame) {
+            if (_rxLen < sizeof(_rx)) {
+                _rx[_rxLen++] = c;
+            } else {
+                _rxOverflow = true;
+            }
+        } else {
+            handleTextByte(c);
+        }
+    }
+}
+
+void SerialLink::handleTextByte(uint8_t c) {
+    if (c == '\r') return;
+    if (c != '\n') {
+        if (_lineLen < sizeof(_line) - 1) {
+            _line[_lineLen++] = (char)c;
+        } else {
+            _lineOverflow = true;
+        }
+        return;
+    }
+
+    _line[_lineLen] = '\0';
+    if (_lineOverflow) {
+        _port->printf("Line too long (max %d chars), ignored\n", SERIAL_LINE_MAX - 1);
+    } else if (_lineLen > 0 && _lineCb) {
+        _lineCb(_line);
+    }
+    _lineLen = 0;
+    _lineOverflow = false;
+}
+
+void SerialLink::handleFrame() {
+    size_t len = _rxOverflow ? 0 : SerialProtocol::cobsDecode(_rx, _rxLen);
+    if (len < LINK_HEADER_SIZE + LINK_CRC_SIZE) {
+        _badFrames++;
+        return;
+    }
+
+    len -= LINK_CRC_SIZE;
+    uint16_t crc = _rx[len] | (_rx[len + 1] << 8);
+    if (crc != SerialProtocol::crc16(_rx, len)) {
+        _badFrames++;
+        return;
+    }
+
+    if (_requestCb) {
+        _requestCb(_rx[0], _rx[1], _rx + LINK_HEADER_SIZE, len - LINK_HEADER_SIZE);
+    }
+}
+
+bool SerialLink::sendFrame(uint8_t type, uint8_t reqId, const void* body, size_t len, bool mayDrop) {
+    if (!_port || len > LINK_MAX_BODY) return false;
+
+    size_t encLen = SerialProtocol::encodeFrame(type, reqId, body, len, _txRaw, _txEnc);
+
+    if (mayDrop && (size_t)_port->availableForWrite() < encLen) return false;
+    // One write call so output from other tasks cannot land mid-frame
+    _port->write(_txEnc, encLen);
+    return true;
+}
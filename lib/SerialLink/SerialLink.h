@@ -0,0 +1,80 @@
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#include <Arduino.h>
+#include <functional>
+#include "config.h"
+#include "SerialProtocol.h"
+
+// The receive buffer holds a frame still COBS-encoded: a full console line,
+// the header, the CRC and the COBS code byte
+static_assert(LINK_MAX_REQUEST >= LINK_HEADER_SIZE + (SERIAL_LINE_MAX - 1) + LINK_CRC_SIZE + 1,
+              "A LINK_REQ_TEXT frame carrying a full console line must fit the receive buffer");
+
+/**
+ * SerialLink - Splits the serial port into text lines and binary frames
+ *
+ * poll() drains whatever the UART has buffered without waiting: bytes
+ * outside a frame are assembled into text lines for the console, frames
+ * (see SerialProtocol.h) are decoded, CRC-checked and passed to the
+ * request handler. Responses and events go out with sendFrame().
+ */
+class SerialLink {
+public:
+    using LineCallback = std::function<void(char* line)>;
+    using RequestCallback = std::function<void(uint8_t type, uint8_t reqId,
+                                               const uint8_t* body, size_t len)>;
+
+    SerialLink();
+
+    void begin(HardwareSerial& port);
+
+    /**
+     * Process all received bytes. Call from loop().
+     */
+    void poll();
+
+    /**
+     * Send one frame
+     * @param mayDrop Skip the frame instead of blocking when the UART
+     *                buffer cannot take it (telemetry)
+     * @return true if the frame was written
+     */
+    bool sendFrame(uint8_t type, uint8_t reqId, const void* body, size_t len, bool mayDrop = false);
+
+    bool sendAck(uint8_t reqId) { return sendFrame(LINK_RSP_ACK, reqId, nullptr, 0); }
+    bool sendError(uint8_t reqId, uint8_t code) { return sendFrame(LINK_RSP_ERROR, reqId, &code, 1); }
+
+    void onLine(LineCallback cb)       { _lineCb = cb; }
+    void onRequest(RequestCallback cb) { _requestCb = cb; }
+
+    /**
+     * Frames dropped for a bad CRC, bad encoding or overflow
+     */
+    uint32_t getBadFrames() const { return _badFrames; }
+
+private:
+    HardwareSerial* _port;
+
+    char _line[SERIAL_LINE_MAX];
+    size_t _lineLen;
+    bool _lineOverflow;
+
+    uint8_t _rx[LINK_MAX_REQUEST];
+    size_t _rxLen;
+    bool _inFrame;
+    bool _rxOverflow;
+
+    uint8_t _txRaw[LINK_MAX_PAYLOAD];
+    uint8_t _txEnc[LINK_MAX_ENCODED + 2];
+
+    uint32_t _badFrames;
+
+    LineCallback _lineCb;
+    RequestCallback _requestCb;
+
+    void handleTextByte(uint8_t c);
+    void handleFrame();
+};
+
+#endif // SERIAL_LINK_H
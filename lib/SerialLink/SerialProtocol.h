@@ -0,0 +1,165 @@
+#ifndef SERIAL_PROTOCOL_H
+#define SERIAL_PROTOCOL_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/**
+ * SerialProtocol - Binary request/response frames on the serial console
+ *
+ * Frames share the port with the text console. On the wire a frame is
+ *   0x00, COBS(payload + CRC16), 0x00
+ * COBS removes every zero byte from the encoded data, and the text console
+ * never sends one, so the delimiters alone separate frames from text.
+ *
+ * Payload: [uint8 type][uint8 request id][body...]
+ * CRC16-CCITT (poly 0x1021, init 0xFFFF) over the payload, little-endian.
+ * The device echoes the request id in its response so the host can match
+ * responses to requests; unsolicited events use id 0. Bodies are packed
+ * little-endian structs. tools/platform_link.py is the host side - keep the
+ * two in sync.
+ */
+
+// Requests (host -> device)
+#define LINK_REQ_PING       0x01  // -> LINK_RSP_PONG
+#define LINK_REQ_POSITIONS  0x02  // -> LINK_RSP_POSITIONS
+#define LINK_REQ_MOVE       0x03  // LinkMove -> LINK_RSP_POSITIONS once the move is done
+#define LINK_REQ_SET_POS    0x04  // LinkSetPosition -> LINK_RSP_POSITIONS
+#define LINK_REQ_LIMITS     0x05  // uint8 1 = default limits, 0 = unlocked -> LINK_RSP_POSITIONS
+#define LINK_REQ_STREAM     0x06  // uint16 hz (0 = off, max STREAM_SERIAL_MAX_HZ) -> LINK_RSP_ACK
+#define LINK_REQ_TEXT       0x07  // Text console command -> LINK_RSP_ACK after it ran
+
+// Responses (device -> host, request id echoed)
+#define LINK_RSP_ACK        0x80  // Empty body
+#define LINK_RSP_PONG       0x81  // LinkPong
+#define LINK_RSP_POSITIONS  0x82  // LinkPositions
+#define LINK_RSP_ERROR      0xFF  // uint8 LINK_ERR_*
+
+// Events (device -> host, request id 0)
+#define LINK_EVT_STREAM     0xA0  // TelemetryStream batch
+#define LINK_EVT_LOG        0xA1  // DeferredLog record (see DeferredLog.h)
+
+#define LINK_ERR_UNKNOWN    1     // Unknown request type
+#define LINK_ERR_LENGTH     2     // Body too short
+#define LINK_ERR_RANGE      3     // Argument out of range
+#define LINK_ERR_STATE      4     // MOVE / SET_POS / LIMITS outside IDLE and TEST_MODE
+
+#define LINK_HEADER_SIZE    2
+#define LINK_CRC_SIZE       2
+#define LINK_MAX_BODY       600   // Largest telemetry batch fits
+#define LINK_MAX_PAYLOAD    (LINK_HEADER_SIZE + LINK_MAX_BODY + LINK_CRC_SIZE)
+#define LINK_MAX_ENCODED    (LINK_MAX_PAYLOAD + LINK_MAX_PAYLOAD / 254 + 1)
+
+// Largest request: LINK_REQ_TEXT with a full console line (SERIAL_LINE_MAX - 1
+// chars); longer frames are dropped
+#define LINK_MAX_REQUEST_PAYLOAD (LINK_HEADER_SIZE + SERIAL_LINE_MAX - 1 + LINK_CRC_SIZE)
+#define LINK_MAX_REQUEST    (LINK_MAX_REQUEST_PAYLOAD + LINK_MAX_REQUEST_PAYLOAD / 254 + 1)
+
+struct __attribute__((packed)) LinkPong {
+    uint32_t uptime;       // ms
+    uint8_t state;         // SystemState enum value
+};
+
+struct __attribute__((packed)) LinkMove {
+    int32_t m1steps;
+    int32_t m2steps;
+};
+
+struct __attribute__((packed)) LinkSetPosition {
+    uint8_t motors;        // Bit 0 = motor 1, bit 1 = motor 2
+    int32_t value;
+};
+
+struct __attribute__((packed)) LinkPositions {
+    int32_t m1pos;
+    int32_t m2pos;
+    int32_t minPos;
+    int32_t maxPos;
+};
+
+namespace SerialProtocol {
+
+inline uint16_t crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/**
+ * COBS-encode len bytes of in into out (no delimiters)
+ * @param out Buffer of at least len + len / 254 + 1 bytes
+ * @return Encoded length
+ */
+inline size_t cobsEncode(const uint8_t* in, size_t len, uint8_t* out) {
+    size_t codeIdx = 0;
+    size_t outLen = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[codeIdx] = code;
+            codeIdx = outLen++;
+            code = 1;
+        } else {
+            out[outLen++] = in[i];
+            if (++code == 0xFF) {
+                out[codeIdx] = code;
+                codeIdx = outLen++;
+                code = 1;
+            }
+        }
+    }
+    out[codeIdx] = code;
+    return outLen;
+}
+
+/**
+ * Decode a COBS block in place
+ * @return Decoded length, or 0 if the block is malformed
+ */
+inline size_t cobsDecode(uint8_t* buf, size_t len) {
+    size_t in = 0;
+    size_t out = 0;
+    while (in < len) {
+        uint8_t code = buf[in++];
+        if (code == 0 || in + code - 1 > len) return 0;
+        for (uint8_t i = 1; i < code; i++) {
+            buf[out++] = buf[in++];
+        }
+        if (code != 0xFF && in < len) {
+            buf[out++] = 0;
+        }
+    }
+    return out;
+}
+
+/**
+ * Build a complete frame, delimiters included
+ * @param scratch Buffer of at least LINK_HEADER_SIZE + len + LINK_CRC_SIZE bytes
+ * @param out Buffer of at least n + n / 254 + 3 bytes for a scratch length
+ *            of n (LINK_MAX_ENCODED + 2 covers any frame)
+ * @return Frame length
+ */
+inline size_t encodeFrame(uint8_t type, uint8_t reqId, const void* body, size_t len,
+                          uint8_t* scratch, uint8_t* out) {
+    scratch[0] = type;
+    scratch[1] = reqId;
+    if (len > 0) memcpy(scratch + LINK_HEADER_SIZE, body, len);
+    len += LINK_HEADER_SIZE;
+    uint16_t crc = crc16(scratch, len);
+    scratch[len++] = crc & 0xFF;
+    scratch[len++] = crc >> 8;
+
+    size_t encLen = cobsEncode(scratch, len, out + 1);
+    out[0] = 0;
+    out[encLen + 1] = 0;
+    return encLen + 2;
+}
+
+} // namespace SerialProtocol
+
+#endif // SERIAL_PROTOCOL_H
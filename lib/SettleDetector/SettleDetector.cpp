@@ -0,0 +1,104 @@
+#include "SettleDetector.h"
+
+// Filter output change still to come, per change in the last sample
+static const float LAG_REMAINING = (1.0f - COMPLEMENTARY_ALPHA) / COMPLEMENTARY_ALPHA;
+
+SettleDetector::SettleDetector()
+    : _lastSampleMs(0)
+    , _samples(0)
+    , _samplesSinceMove(0)
+    , _waiting(false)
+    , _moveEndMs(0)
+    , _settleMs(0)
+{
+    resetAxis(_pitch, 0);
+    resetAxis(_roll, 0);
+}
+
+void SettleDetector::reset() {
+    _samples = 0;
+    _samplesSinceMove = 0;
+    _waiting = false;
+}
+
+void SettleDetector::resetAxis(Axis& a, float angle) {
+    a.last = angle;
+    a.delta = 0;
+    a.rate = 0;
+    a.mean = angle;
+    a.variance = 0;
+    a.lagBound = 0;
+}
+
+void SettleDetector::begin(unsigned long nowMs, const MotorCorrection& moved) {
+    float pitch = PLANT_M1_PITCH_PER_STEP * moved.motor1Steps + PLANT_M2_PITCH_PER_STEP * moved.motor2Steps;
+    float roll = PLANT_M1_ROLL_PER_STEP * moved.motor1Steps + PLANT_M2_ROLL_PER_STEP * moved.motor2Steps;
+    _pitch.lagBound = fabsf(_pitch.delta * LAG_REMAINING) + fabsf(pitch);
+    _roll.lagBound = fabsf(_roll.delta * LAG_REMAINING) + fabsf(roll);
+    _waiting = true;
+    _moveEndMs = nowMs;
+    _samplesSinceMove = 0;
+}
+
+void SettleDetector::update(unsigned long nowMs, float pitch, float roll) {
+    if (_samples == 0) {
+        resetAxis(_pitch, pitch);
+        resetAxis(_roll, roll);
+    } else {
+        // The sample after a move spans the blocked loop(); its change is
+        // the move itself, not the response, so it only sets the reference
+        bool spansMove = _waiting && _samplesSinceMove == 0;
+        float dt = (nowMs - _lastSampleMs) / 1000.0f;
+        if (spansMove || dt <= 0) {
+            _pitch.last = pitch;
+            _roll.last = roll;
+        } else {
+            updateAxis(_pitch, pitch, dt);
+            updateAxis(_roll, roll, dt);
+        }
+    }
+    _lastSampleMs = nowMs;
+    if (_samples < 0xFFFF) _samples++;
+    if (_waiting && _samplesSinceMove < 0xFFFF) _samplesSinceMove++;
+}
+
+void SettleDetector::updateAxis(Axis& a, float angle, float dt) {
+    a.delta = angle - a.last;
+    a.last = angle;
+    a.rate += SETTLE_FILTER * (a.delta / dt - a.rate);
+    float dev = angle - a.mean;
+    a.mean += SETTLE_FILTER * dev;
+    a.variance += SETTLE_FILTER * (dev * dev - a.variance);
+}
+
+bool SettleDetector::axisSettled(const Axis& a) const {
+    return fabsf(a.rate) < SETTLE_RATE_DPS && a.variance < SETTLE_STDDEV_DEG * SETTLE_STDDEV_DEG;
+}
+
+bool SettleDetector::isSettled() const {
+    return _samples >= SETTLE_MIN_SAMPLES && axisSettled(_pitch) && axisSettled(_roll);
+}
+
+bool SettleDetector::convergedOutside(const Axis& a, float error, float tolerance) const {
+    if (_samplesSinceMove < 2) return fabsf(error) - a.lagBound >= tolerance;
+    float settled = error + a.delta * LAG_REMAINING;
+    return fabsf(error) >= tolerance && fabsf(settled) >= tolerance && (error > 0) == (settled > 0);
+}
+
+bool SettleDetector::ready(unsigned long nowMs, float pitchError, float rollError, float tolerance) {
+    if (!_waiting) return true;
+
+    bool ready = false;
+    if (_samplesSinceMove >= 1) {
+        ready = convergedOutside(_pitch, pitchError, tolerance) ||
+                convergedOutside(_roll, rollError, tolerance) ||
+                (_samplesSinceMove >= SETTLE_MIN_SAMPLES && isSettled());
+    }
+    if (nowMs - _moveEndMs >= SETTLE_MAX_MS) ready = true;
+
+    if (ready) {
+        _waiting = false;
+        _settleMs = nowMs - _moveEndMs;
+    }
+    return ready;
+}
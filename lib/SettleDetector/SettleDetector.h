@@ -0,0 +1,98 @@
+#ifndef SETTLE_DETECTOR_H
+#define SETTLE_DETECTOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+/**
+ * SettleDetector - Gates leveling corrections on the response to the last move
+ *
+ * Fed every IMU sample, it keeps per axis a filtered angular rate and the
+ * variance of the angle around its running mean. The attitude is settled
+ * when, for both axes, the rate is below SETTLE_RATE_DPS and the standard
+ * deviation below SETTLE_STDDEV_DEG.
+ *
+ * After a move (begin()), the next correction is ready when
+ *   - the attitude has settled, or
+ *   - it has predictably converged outside the tolerance: the complementary
+ *     filter's output closes (1 - alpha) / alpha of its last change per
+ *     sample still to come, and the angle it will end at is still outside
+ *     the tolerance, so the next correction is needed whatever the rest of
+ *     the response does. On the first sample after the move, whose change
+ *     spans the move, the lag still to come is bounded by the lag before
+ *     the move plus the move's tilt (plant gains), or
+ *   - SETTLE_MAX_MS has passed (a platform that keeps vibrating)
+ *
+ * Far from level this fires on the first sample after the move; near the
+ * tolerance it waits for the response instead of chasing the filter lag.
+ * getSettleMs() is the time from the end of the last move to ready.
+ */
+class SettleDetector {
+public:
+    SettleDetector();
+
+    /**
+     * Forget the history (new leveling cycle, attitude disturbed)
+     */
+    void reset();
+
+    /**
+     * A move has just ended; wait for its response
+     * @param moved Steps actually made
+     */
+    void begin(unsigned long nowMs, const MotorCorrection& moved);
+
+    /**
+     * One IMU sample
+     */
+    void update(unsigned long nowMs, float pitch, float roll);
+
+    /**
+     * True while a move's response is being waited for
+     */
+    bool isWaiting() const { return _waiting; }
+
+    /**
+     * Rate and variance below their limits on both axes
+     */
+    bool isSettled() const;
+
+    /**
+     * The next correction may be made (see class comment); closes the wait
+     * and records the settle time when it returns true
+     * @param tolerance Level tolerance in degrees (angles are errors from the target)
+     */
+    bool ready(unsigned long nowMs, float pitchError, float rollError, float tolerance);
+
+    /**
+     * Time from the end of the last move to ready, in ms
+     */
+    unsigned long getSettleMs() const { return _settleMs; }
+
+private:
+    struct Axis {
+        float last;             // Previous sample
+        float delta;            // Last change per sample
+        float rate;             // Filtered rate, deg/s
+        float mean;             // Running mean
+        float variance;         // Running variance around the mean
+        float lagBound;         // Lag still to come after the move, at most
+    };
+
+    Axis _pitch;
+    Axis _roll;
+    unsigned long _lastSampleMs;
+    uint16_t _samples;          // Samples since reset
+    uint16_t _samplesSinceMove;
+    bool _waiting;
+    unsigned long _moveEndMs;
+    unsigned long _settleMs;
+
+    static void resetAxis(Axis& a, float angle);
+    void updateAxis(Axis& a, float angle, float dt);
+    bool axisSettled(const Axis& a) const;
+    bool convergedOutside(const Axis& a, float error, float tolerance) const;
+};
+
+#endif // SETTLE_DETECTOR_H
@@ -0,0 +1,111 @@
+#include "StallDetector.h"
+
+StallDetector::StallDetector()
+    : _open(false)
+    , _startPitch(0)
+    , _startRoll(0)
+    , _up1(0), _down1(0)
+    , _up2(0), _down2(0)
+{
+    memset(&_last, 0, sizeof(_last));
+}
+
+void StallDetector::begin(float pitch, float roll) {
+    _open = true;
+    _startPitch = pitch;
+    _startRoll = roll;
+    _up1 = _down1 = 0;
+    _up2 = _down2 = 0;
+}
+
+void StallDetector::addMove(const MotorCorrection& moved) {
+    if (!_open) return;
+    if (moved.motor1Steps > 0) _up1 += moved.motor1Steps;
+    else _down1 -= moved.motor1Steps;
+    if (moved.motor2Steps > 0) _up2 += moved.motor2Steps;
+    else _down2 -= moved.motor2Steps;
+}
+
+const StallCheck& StallDetector::close(float pitch, float roll) {
+    _open = false;
+    _last = evaluate(_up1 - _down1, _up2 - _down2, pitch - _startPitch, roll - _startRoll);
+    return _last;
+}
+
+StallCheck StallDetector::evaluate(long steps1, long steps2, float dPitch, float dRoll) {
+    StallCheck c;
+    c.steps1 = steps1;
+    c.steps2 = steps2;
+    c.efficiency1 = 1.0f;
+    c.efficiency2 = 1.0f;
+
+    // Expected tilt change from each motor
+    float up = PLANT_M1_PITCH_PER_STEP * steps1, ur = PLANT_M1_ROLL_PER_STEP * steps1;
+    float vp = PLANT_M2_PITCH_PER_STEP * steps2, vr = PLANT_M2_ROLL_PER_STEP * steps2;
+    float uu = up * up + ur * ur;
+    float vv = vp * vp + vr * vr;
+    float minSignal = STALL_MIN_SIGNAL_DEG * STALL_MIN_SIGNAL_DEG;
+    c.judged1 = uu >= minSignal;
+    c.judged2 = vv >= minSignal;
+
+    if (c.judged1 && c.judged2) {
+        // Solve measured = e1 * u + e2 * v
+        float det = up * vr - vp * ur;
+        c.efficiency1 = (dPitch * vr - vp * dRoll) / det;
+        c.efficiency2 = (up * dRoll - dPitch * ur) / det;
+    } else if (c.judged1) {
+        // Motor 2 (small or no move) assumed to have moved as commanded
+        c.efficiency1 = ((dPitch - vp) * up + (dRoll - vr) * ur) / uu;
+    } else if (c.judged2) {
+        c.efficiency2 = ((dPitch - up) * vp + (dRoll - ur) * vr) / vv;
+    }
+
+    c.efficiency1 = constrain(c.efficiency1, -1.0f, 2.0f);
+    c.efficiency2 = constrain(c.efficiency2, -1.0f, 2.0f);
+    c.missed1 = c.stalled1() ? lroundf((1.0f - min(c.efficiency1, 1.0f)) * labs(steps1)) : 0;
+    c.missed2 = c.stalled2() ? lroundf((1.0f - min(c.efficiency2, 1.0f)) * labs(steps2)) : 0;
+    return c;
+}
+
+StepRateTuner::StepRateTuner() {
+    reset();
+}
+
+void StepRateTuner::reset() {
+    for (int m = 0; m < 2; m++) {
+        for (int d = 0; d < 2; d++) {
+            _rates[m][d].delayUs = STEP_DELAY_US;
+            _rates[m][d].failUs = 0;
+            _rates[m][d].good = 0;
+        }
+    }
+}
+
+bool StepRateTuner::report(uint8_t motor, int direction, bool ok) {
+    Rate& r = rate(motor, direction);
+    uint16_t before = r.delayUs;
+
+    if (!ok) {
+        if (r.failUs == 0 || r.delayUs < r.failUs) r.failUs = r.delayUs;
+        r.delayUs = min((uint32_t)r.delayUs * 13 / 10, (uint32_t)STALL_MAX_DELAY_US);
+        r.good = 0;
+    } else if (++r.good >= STALL_SPEEDUP_AFTER) {
+        uint32_t faster = (uint32_t)r.delayUs * 9 / 10;
+        if (r.failUs) faster = max(faster, (uint32_t)r.failUs * 115 / 100);
+        r.delayUs = max(faster, (uint32_t)STALL_MIN_DELAY_US);
+        r.good = 0;
+    }
+
+    return r.delayUs != before;
+}
+
+unsigned long StepRateTuner::getDelay(uint8_t motor, int direction) const {
+    return rate(motor, direction).delayUs;
+}
+
+void StepRateTuner::setDelay(uint8_t motor, int direction, unsigned long us) {
+    Rate& r = rate(motor, direction);
+    r.delayUs = constrain(us, (unsigned long)STALL_MIN_DELAY_US, (unsigned long)STALL_MAX_DELAY_US);
+    r.failUs = 0;
+    r.good = 0;
+}
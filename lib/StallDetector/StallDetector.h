@@ -0,0 +1,151 @@
+#ifndef STALL_DETECTOR_H
+#define STALL_DETECTOR_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+/**
+ * StallDetector - Missed-step detection from the IMU and the plant gains
+ *
+ * Every commanded step should tilt the platform by the identified plant
+ * gains (PLANT_* in config.h). A window is opened at a settled attitude,
+ * the moves made during it are added up, and when the platform has settled
+ * again the measured tilt change is compared with the expected one. With
+ * both motors moving, the two measured axes (pitch, roll) are enough to
+ * solve for each motor's efficiency separately:
+ *
+ *   measured = e1 * J1 * steps1 + e2 * J2 * steps2
+ *
+ * An efficiency near 1 means every step landed; well below 1 means steps
+ * were missed, and the position counters are off by about (1 - e) * steps.
+ * A motor is only judged when its expected tilt change is large enough to
+ * stand out from IMU noise (STALL_MIN_SIGNAL_DEG).
+ *
+ * StepRateTuner uses these results to find the fastest reliable step delay
+ * for each motor and direction, which StepperController uses for leveling
+ * corrections.
+ */
+
+// Result of one window
+struct StallCheck {
+    long steps1;            // Net commanded steps
+    long steps2;
+    bool judged1;           // Enough expected signal to judge this motor
+    bool judged2;
+    float efficiency1;      // Measured / expected tilt change (1 = no missed steps)
+    float efficiency2;
+    long missed1;           // Estimated missed steps, 0 unless stalled
+    long missed2;
+
+    bool stalled1() const { return judged1 && efficiency1 < STALL_EFFICIENCY_MIN; }
+    bool stalled2() const { return judged2 && efficiency2 < STALL_EFFICIENCY_MIN; }
+    bool stalled() const { return stalled1() || stalled2(); }
+};
+
+class StallDetector {
+public:
+    StallDetector();
+
+    /**
+     * Open a window at a settled attitude (discards any open window)
+     */
+    void begin(float pitch, float roll);
+
+    /**
+     * Add steps actually made while the window is open
+     */
+    void addMove(const MotorCorrection& moved);
+
+    /**
+     * Close the window at a settled attitude and judge it
+     * @return The result, also kept as last()
+     */
+    const StallCheck& close(float pitch, float roll);
+
+    /**
+     * Drop the open window (platform disturbed, attitude not comparable)
+     */
+    void cancel() { _open = false; }
+
+    bool isOpen() const { return _open; }
+
+    /**
+     * Direction motor 1 or 2 moved in during the window: 1, -1, or 0 if it
+     * did not move or moved both ways
+     */
+    int direction1() const { return direction(_up1, _down1); }
+    int direction2() const { return direction(_up2, _down2); }
+
+    /**
+     * Result of the last closed window (all zero before the first)
+     */
+    const StallCheck& last() const { return _last; }
+
+    /**
+     * Judge a tilt change against the steps that should have caused it
+     */
+    static StallCheck evaluate(long steps1, long steps2, float dPitch, float dRoll);
+
+private:
+    bool _open;
+    float _startPitch;
+    float _startRoll;
+    long _up1, _down1;      // Steps in each direction during the window
+    long _up2, _down2;
+    StallCheck _last;
+
+    static int direction(long up, long down) {
+        if (up > 0 && down == 0) return 1;
+        if (down > 0 && up == 0) return -1;
+        return 0;
+    }
+};
+
+/**
+ * StepRateTuner - Fastest reliable step delay per motor and direction
+ *
+ * Each delay starts at STEP_DELAY_US. After STALL_SPEEDUP_AFTER clean
+ * checks in a row it is tried 10% shorter; a stall backs it off by 30% and
+ * remembers the failing delay, which is then never approached closer than
+ * 15%. Delays stay within STALL_MIN_DELAY_US..STALL_MAX_DELAY_US.
+ */
+class StepRateTuner {
+public:
+    StepRateTuner();
+
+    /**
+     * Report a judged move
+     * @param motor 1 or 2
+     * @param direction 1 or -1
+     * @param ok False if steps were missed
+     * @return True if the delay changed
+     */
+    bool report(uint8_t motor, int direction, bool ok);
+
+    unsigned long getDelay(uint8_t motor, int direction) const;
+
+    /**
+     * Set a delay directly (calibration, NVS restore); clears the history
+     */
+    void setDelay(uint8_t motor, int direction, unsigned long us);
+
+    /**
+     * Back to STEP_DELAY_US everywhere
+     */
+    void reset();
+
+private:
+    struct Rate {
+        uint16_t delayUs;
+        uint16_t failUs;    // Fastest delay seen to miss steps, 0 if none
+        uint8_t good;       // Clean checks since the last change
+    };
+
+    Rate _rates[2][2];      // [motor - 1][0 = forward, 1 = reverse]
+
+    Rate& rate(uint8_t motor, int direction) { return _rates[motor == 2][direction < 0]; }
+    const Rate& rate(uint8_t motor, int direction) const { return _rates[motor == 2][direction < 0]; }
+};
+
+#endif // STALL_DETECTOR_H
@@ -1,5 +1,22 @@
 #include "StepperController.h"
 
+// Microstep phases per 90 electrical degrees (two half-steps)
+#define QUARTER_PHASES (2 * MICROSTEPS_PER_HALFSTEP)
+#define MAX_DUTY ((1 << MICROSTEP_PWM_RESOLUTION) - 1)
+
+// Quarter sine wave in PWM duty, filled on first use of microstepping
+static uint16_t sineTable[QUARTER_PHASES + 1];
+
+// Signed sine of a phase, full wave = 4 * QUARTER_PHASES
+static int sineDuty(long phase) {
+    long i = phase % (4 * QUARTER_PHASES);
+    if (i < 0) i += 4 * QUARTER_PHASES;
+    if (i <= QUARTER_PHASES) return sineTable[i];
+    if (i <= 2 * QUARTER_PHASES) return sineTable[2 * QUARTER_PHASES - i];
+    if (i <= 3 * QUARTER_PHASES) return -sineTable[i - 2 * QUARTER_PHASES];
+    return -sineTable[4 * QUARTER_PHASES - i];
+}
+
 StepperController::StepperController()
     : _stepIndex1(0)
     , _stepIndex2(0)
@@ -8,7 +25,18 @@ StepperController::StepperController()
     , _minPosition(MOTOR_MIN_POSITION)
     , _maxPosition(MOTOR_MAX_POSITION)
     , _stepDelayUs(STEP_DELAY_US)
+    , _microstepping(false)
+    , _phase1(0), _phaseFrom1(0), _phaseTo1(0)
+    , _phase2(0), _phaseFrom2(0), _phaseTo2(0)
+    , _backlash1(0), _backlash2(0)
+    , _lastDir1(0), _lastDir2(0)
+    , _takeUp1(0), _takeUp2(0)
+    , _holding(false)
+    , _holdDutyPercent(HOLD_DUTY_PERCENT)
+    , _holdTimeoutMs(HOLD_TIMEOUT_MS)
+    , _holdStartMs(0)
 {
+    memset(_correctionDelayUs, 0, sizeof(_correctionDelayUs));
 }
 
 void StepperController::begin() {
@@ -27,45 +55,77 @@ void StepperController::begin() {
     Serial.println("StepperController: Initialized");
 }
 
-void StepperController::moveMotor1(int steps) {
-    if (steps == 0) return;
+MotorCorrection StepperController::moveTo(long pos1, long pos2) {
+    return moveBy(pos1 - _position1, pos2 - _position2);
+}
+
+MotorCorrection StepperController::moveBy(long steps1, long steps2) {
+    return moveBy(steps1, steps2, _stepDelayUs);
+}
 
-    int direction = (steps > 0) ? 1 : -1;
-    int absSteps = abs(steps);
+MotorCorrection StepperController::moveBy(long steps1, long steps2, unsigned long delayUs) {
+    MotorCorrection moved;
+    moved.motor1Steps = (int)clipSteps1(steps1);
+    moved.motor2Steps = (int)clipSteps2(steps2);
+    runSteps(moved.motor1Steps + takeUpFor(1, moved.motor1Steps),
+             moved.motor2Steps + takeUpFor(2, moved.motor2Steps), delayUs);
+    return moved;
+}
 
-    for (int i = 0; i < absSteps; i++) {
-        stepMotor1(direction);
-        delayMicroseconds(_stepDelayUs);
+void StepperController::setBacklash(uint8_t motor, uint16_t steps) {
+    steps = min(steps, (uint16_t)BACKLASH_MAX_STEPS);
+    if (motor == 2) {
+        _backlash2 = steps;
+        _takeUp2 = 0;
+    } else {
+        _backlash1 = steps;
+        _takeUp1 = 0;
     }
 }
 
-void StepperController::moveMotor2(int steps) {
-    if (steps == 0) return;
+long StepperController::takeUpFor(uint8_t motor, long steps) const {
+    if (steps == 0) return 0;
+    int dir = steps > 0 ? 1 : -1;
+    int lastDir = motor == 2 ? _lastDir2 : _lastDir1;
+    uint16_t backlash = motor == 2 ? _backlash2 : _backlash1;
+    uint16_t pending = motor == 2 ? _takeUp2 : _takeUp1;
+
+    // Same direction: finish a take-up a stopped move left pending.
+    // Reversal: cross the part of the dead band already taken up.
+    if (dir == lastDir) return dir * (long)pending;
+    if (lastDir != 0) return dir * (long)(backlash - pending);
+    return 0;
+}
 
-    int direction = (steps > 0) ? 1 : -1;
-    int absSteps = abs(steps);
+void StepperController::moveMotor1(int steps) {
+    moveBy(steps, 0);
+}
 
-    for (int i = 0; i < absSteps; i++) {
-        stepMotor2(direction);
-        delayMicroseconds(_stepDelayUs);
-    }
+void StepperController::moveMotor2(int steps) {
+    moveBy(0, steps);
 }
 
 void StepperController::moveBoth(int steps1, int steps2) {
+    moveBy(steps1, steps2);
+}
+
+void StepperController::runSteps(long steps1, long steps2, unsigned long delayUs) {
     // Move both motors in an interleaved fashion for smoother operation
     int dir1 = (steps1 > 0) ? 1 : -1;
     int dir2 = (steps2 > 0) ? 1 : -1;
-    int abs1 = abs(steps1);
-    int abs2 = abs(steps2);
+    long abs1 = labs(steps1);
+    long abs2 = labs(steps2);
 
-    int maxSteps = max(abs1, abs2);
+    long maxSteps = max(abs1, abs2);
     if (maxSteps == 0) return;
 
     // Bresenham-like algorithm to interleave steps
-    int err1 = maxSteps / 2;
-    int err2 = maxSteps / 2;
+    long err1 = maxSteps / 2;
+    long err2 = maxSteps / 2;
+
+    for (long i = 0; i < maxSteps; i++) {
+        startSweep();
 
-    for (int i = 0; i < maxSteps; i++) {
         err1 -= abs1;
         if (err1 < 0) {
             err1 += maxSteps;
@@ -78,11 +138,31 @@ void StepperController::moveBoth(int steps1, int steps2) {
             stepMotor2(dir2);
         }
 
-        delayMicroseconds(_stepDelayUs);
+        if (_microstepping) {
+            // Sweep the step through its microsteps over the step delay
+            for (int m = 1; m <= MICROSTEPS_PER_HALFSTEP; m++) {
+                interpolate((float)m / MICROSTEPS_PER_HALFSTEP);
+                delayMicroseconds(delayUs / MICROSTEPS_PER_HALFSTEP);
+            }
+        } else {
+            delayMicroseconds(delayUs);
+        }
     }
 }
 
-void StepperController::applyCorrection(const MotorCorrection& correction) {
+void StepperController::step(int dir1, int dir2) {
+    startSweep();
+    if (dir1 != 0) stepMotor1(dir1);
+    if (dir2 != 0) stepMotor2(dir2);
+}
+
+// Least-squares steps of one motor for a tilt change, given its gains
+static long solveSingle(float gainPitch, float gainRoll, float dPitch, float dRoll) {
+    float norm = gainPitch * gainPitch + gainRoll * gainRoll;
+    return lroundf((gainPitch * dPitch + gainRoll * dRoll) / norm);
+}
+
+MotorCorrection StepperController::applyCorrection(const MotorCorrection& correction) {
     int steps1 = correction.motor1Steps;
     int steps2 = correction.motor2Steps;
 
@@ -96,17 +176,175 @@ void StepperController::applyCorrection(const MotorCorrection& correction) {
         steps2 = (int)(steps2 * scale);
     }
 
-    moveBoth(steps1, steps2);
+    // A motor at a position limit can only do part of its share; give the
+    // rest of the tilt change to the other motor where it helps
+    long clip1 = clipSteps1(steps1);
+    long clip2 = clipSteps2(steps2);
+    if (clip1 != steps1 && clip2 == steps2) {
+        float dPitch = PLANT_M1_PITCH_PER_STEP * (steps1 - clip1);
+        float dRoll = PLANT_M1_ROLL_PER_STEP * (steps1 - clip1);
+        long extra = solveSingle(PLANT_M2_PITCH_PER_STEP, PLANT_M2_ROLL_PER_STEP, dPitch, dRoll);
+        clip2 = clipSteps2(constrain(steps2 + extra, -MAX_CORRECTION_STEPS, MAX_CORRECTION_STEPS));
+    } else if (clip2 != steps2 && clip1 == steps1) {
+        float dPitch = PLANT_M2_PITCH_PER_STEP * (steps2 - clip2);
+        float dRoll = PLANT_M2_ROLL_PER_STEP * (steps2 - clip2);
+        long extra = solveSingle(PLANT_M1_PITCH_PER_STEP, PLANT_M1_ROLL_PER_STEP, dPitch, dRoll);
+        clip1 = clipSteps1(constrain(steps1 + extra, -MAX_CORRECTION_STEPS, MAX_CORRECTION_STEPS));
+    }
+
+    // Each motor at its own tuned delay: the dominant motor steps every
+    // event, the other on a fraction of them
+    long events = max(labs(clip1), labs(clip2));
+    if (events == 0) return moveBy(0, 0);
+    unsigned long delay1 = clip1 ? getCorrectionDelay(1, clip1 > 0 ? 1 : -1) * labs(clip1) / events : 0;
+    unsigned long delay2 = clip2 ? getCorrectionDelay(2, clip2 > 0 ? 1 : -1) * labs(clip2) / events : 0;
+    return moveBy(clip1, clip2, max(delay1, delay2));
+}
+
+void StepperController::setCorrectionDelay(uint8_t motor, int direction, unsigned long us) {
+    _correctionDelayUs[motor == 2][direction < 0] = us;
+}
+
+unsigned long StepperController::getCorrectionDelay(uint8_t motor, int direction) const {
+    unsigned long us = _correctionDelayUs[motor == 2][direction < 0];
+    return us ? us : _stepDelayUs;
 }
 
 void StepperController::release() {
+    if (_holding && !_microstepping) detachPwm();
+    _holding = false;
+
     // Turn off all coils to save power
+    if (_microstepping) {
+        for (int i = 0; i < 8; i++) {
+            ledcWrite(MICROSTEP_LEDC_CHANNEL + i, 0);
+        }
+        return;
+    }
     for (int i = 0; i < 4; i++) {
         digitalWrite(_motor1Pins[i], LOW);
         digitalWrite(_motor2Pins[i], LOW);
     }
 }
 
+void StepperController::hold() {
+    if (_holdDutyPercent == 0) {
+        release();
+        return;
+    }
+
+    if (!_microstepping && !_holding) attachPwm();
+    _holding = true;
+    _holdStartMs = millis();
+
+    if (_microstepping) {
+        // writePhase() scales to the hold duty
+        writePhase(MICROSTEP_LEDC_CHANNEL, _phase1);
+        writePhase(MICROSTEP_LEDC_CHANNEL + 4, _phase2);
+        return;
+    }
+
+    uint32_t duty = (uint32_t)MAX_DUTY * _holdDutyPercent / 100;
+    uint8_t pattern1 = _halfStepSequence[_stepIndex1];
+    uint8_t pattern2 = _halfStepSequence[_stepIndex2];
+    for (int i = 0; i < 4; i++) {
+        ledcWrite(MICROSTEP_LEDC_CHANNEL + i, (pattern1 & (1 << i)) ? duty : 0);
+        ledcWrite(MICROSTEP_LEDC_CHANNEL + 4 + i, (pattern2 & (1 << i)) ? duty : 0);
+    }
+}
+
+void StepperController::update() {
+    if (_holding && _holdTimeoutMs > 0 && millis() - _holdStartMs >= _holdTimeoutMs) {
+        release();
+    }
+}
+
+void StepperController::setHold(uint8_t dutyPercent, unsigned long timeoutMs) {
+    _holdDutyPercent = min(dutyPercent, (uint8_t)100);
+    _holdTimeoutMs = timeoutMs;
+    if (_holding) hold();
+}
+
+void StepperController::endHold() {
+    _holding = false;
+    if (_microstepping) {
+        writePhase(MICROSTEP_LEDC_CHANNEL, _phase1);
+        writePhase(MICROSTEP_LEDC_CHANNEL + 4, _phase2);
+    } else {
+        detachPwm();
+        setCoils(_motor1Pins, _halfStepSequence[_stepIndex1]);
+        setCoils(_motor2Pins, _halfStepSequence[_stepIndex2]);
+    }
+}
+
+void StepperController::attachPwm() {
+    for (int i = 0; i < 4; i++) {
+        ledcSetup(MICROSTEP_LEDC_CHANNEL + i, MICROSTEP_PWM_FREQ, MICROSTEP_PWM_RESOLUTION);
+        ledcSetup(MICROSTEP_LEDC_CHANNEL + 4 + i, MICROSTEP_PWM_FREQ, MICROSTEP_PWM_RESOLUTION);
+        ledcAttachPin(_motor1Pins[i], MICROSTEP_LEDC_CHANNEL + i);
+        ledcAttachPin(_motor2Pins[i], MICROSTEP_LEDC_CHANNEL + 4 + i);
+        ledcWrite(MICROSTEP_LEDC_CHANNEL + i, 0);
+        ledcWrite(MICROSTEP_LEDC_CHANNEL + 4 + i, 0);
+    }
+}
+
+void StepperController::detachPwm() {
+    for (int i = 0; i < 4; i++) {
+        ledcDetachPin(_motor1Pins[i]);
+        ledcDetachPin(_motor2Pins[i]);
+        pinMode(_motor1Pins[i], OUTPUT);
+        pinMode(_motor2Pins[i], OUTPUT);
+        digitalWrite(_motor1Pins[i], LOW);
+        digitalWrite(_motor2Pins[i], LOW);
+    }
+}
+
+void StepperController::setMicrostepping(bool enabled) {
+    if (enabled == _microstepping) return;
+    release();
+
+    if (enabled) {
+        if (sineTable[QUARTER_PHASES] == 0) {
+            for (int i = 0; i <= QUARTER_PHASES; i++) {
+                sineTable[i] = (uint16_t)lroundf(MAX_DUTY * sinf(HALF_PI * i / QUARTER_PHASES));
+            }
+        }
+        attachPwm();
+
+        // Continue from the current half-step
+        _phase1 = _phaseFrom1 = _phaseTo1 = (long)_stepIndex1 * MICROSTEPS_PER_HALFSTEP;
+        _phase2 = _phaseFrom2 = _phaseTo2 = (long)_stepIndex2 * MICROSTEPS_PER_HALFSTEP;
+    } else {
+        detachPwm();
+    }
+
+    _microstepping = enabled;
+}
+
+void StepperController::interpolate(float fraction) {
+    if (!_microstepping) return;
+    fraction = constrain(fraction, 0.0f, 1.0f);
+
+    long phase1 = _phaseFrom1 + lroundf((_phaseTo1 - _phaseFrom1) * fraction);
+    if (phase1 != _phase1) {
+        _phase1 = phase1;
+        writePhase(MICROSTEP_LEDC_CHANNEL, phase1);
+    }
+
+    long phase2 = _phaseFrom2 + lroundf((_phaseTo2 - _phaseFrom2) * fraction);
+    if (phase2 != _phase2) {
+        _phase2 = phase2;
+        writePhase(MICROSTEP_LEDC_CHANNEL + 4, phase2);
+    }
+}
+
+void StepperController::startSweep() {
+    // Both motors sweep on from where they are: a motor that does not step
+    // on this event finishes (or holds) its last step instead of replaying it
+    _phaseFrom1 = _phase1;
+    _phaseFrom2 = _phase2;
+}
+
 void StepperController::setSpeed(float rpm) {
     // Calculate step delay based on RPM
     // 28BYJ-48 has 2048 steps per revolution (half-step mode)
@@ -141,6 +379,14 @@ void StepperController::stepMotor1(int direction) {
     if (direction > 0 && _position1 >= _maxPosition) return;
     if (direction < 0 && _position1 <= _minPosition) return;
 
+    if (_holding) endHold();
+
+    // Reversal: the screw has to cross its dead band before the leg moves
+    if (direction != _lastDir1) {
+        if (_lastDir1 != 0) _takeUp1 = _backlash1 - _takeUp1;
+        _lastDir1 = direction;
+    }
+
     // Update step index
     if (direction > 0) {
         _stepIndex1 = (_stepIndex1 + 1) % 8;
@@ -148,11 +394,16 @@ void StepperController::stepMotor1(int direction) {
         _stepIndex1 = (_stepIndex1 + 7) % 8;  // +7 is same as -1 for mod 8
     }
 
-    // Set coil pattern
-    setCoils(_motor1Pins, _halfStepSequence[_stepIndex1]);
+    // Set coil pattern, or sweep to the new phase in interpolate()
+    if (_microstepping) {
+        _phaseTo1 += direction * MICROSTEPS_PER_HALFSTEP;
+    } else {
+        setCoils(_motor1Pins, _halfStepSequence[_stepIndex1]);
+    }
 
-    // Update position counter
-    _position1 += direction;
+    // Update position counter (take-up steps do not move the leg)
+    if (_takeUp1 > 0) _takeUp1--;
+    else _position1 += direction;
 }
 
 void StepperController::stepMotor2(int direction) {
@@ -160,6 +411,13 @@ void StepperController::stepMotor2(int direction) {
     if (direction > 0 && _position2 >= _maxPosition) return;
     if (direction < 0 && _position2 <= _minPosition) return;
 
+    if (_holding) endHold();
+
+    if (direction != _lastDir2) {
+        if (_lastDir2 != 0) _takeUp2 = _backlash2 - _takeUp2;
+        _lastDir2 = direction;
+    }
+
     // Update step index
     if (direction > 0) {
         _stepIndex2 = (_stepIndex2 + 1) % 8;
@@ -167,11 +425,16 @@ void StepperController::stepMotor2(int direction) {
         _stepIndex2 = (_stepIndex2 + 7) % 8;
     }
 
-    // Set coil pattern
-    setCoils(_motor2Pins, _halfStepSequence[_stepIndex2]);
+    // Set coil pattern, or sweep to the new phase in interpolate()
+    if (_microstepping) {
+        _phaseTo2 += direction * MICROSTEPS_PER_HALFSTEP;
+    } else {
+        setCoils(_motor2Pins, _halfStepSequence[_stepIndex2]);
+    }
 
     // Update position counter
-    _position2 += direction;
+    if (_takeUp2 > 0) _takeUp2--;
+    else _position2 += direction;
 }
 
 void StepperController::setCoils(const uint8_t* pins, uint8_t pattern) {
@@ -181,3 +444,19 @@ void StepperController::setCoils(const uint8_t* pins, uint8_t pattern) {
     digitalWrite(pins[2], (pattern & 0b0100) ? HIGH : LOW);
     digitalWrite(pins[3], (pattern & 0b1000) ? HIGH : LOW);
 }
+
+void StepperController::writePhase(uint8_t channel, long phase) {
+    // Two-phase drive of the unipolar coils: IN1/IN3 carry +/-cos,
+    // IN2/IN4 carry +/-sin. Whole half-steps (phase = index * microsteps)
+    // energize the same coils as _halfStepSequence.
+    int a = sineDuty(phase + QUARTER_PHASES);
+    int b = sineDuty(phase);
+    if (_holding) {
+        a = a * _holdDutyPercent / 100;
+        b = b * _holdDutyPercent / 100;
+    }
+    ledcWrite(channel + 0, a > 0 ? a : 0);
+    ledcWrite(channel + 1, b > 0 ? b : 0);
+    ledcWrite(channel + 2, a < 0 ? -a : 0);
+    ledcWrite(channel + 3, b < 0 ? -b : 0);
+}
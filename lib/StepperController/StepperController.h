@@ -10,6 +10,23 @@
  *
  * Uses half-step sequence for smoother operation.
  * Motors can run simultaneously or independently.
+ *
+ * The legs' lead screws have backlash: after a direction reversal the
+ * first steps only cross the dead band. With a backlash set, a reversing
+ * move makes that many extra take-up steps first; they are not counted as
+ * position, so positions (and the controller) see only steps that move
+ * the leg.
+ *
+ * In microstepping mode the eight coil pins are driven by LEDC PWM with
+ * sine/cosine duty cycles instead of on/off, and each half-step is swept
+ * through MICROSTEPS_PER_HALFSTEP intermediate phases. This cuts vibration
+ * (fewer false motion detections during corrections); positions are still
+ * counted in half-steps, so everything above this class is unchanged.
+ *
+ * Moves are clipped against the position limits before any step is taken,
+ * so a move that runs into a limit ends early instead of spending step
+ * delays on steps that cannot happen, and the two motors stay interleaved
+ * in the ratio of the steps they can actually make.
  */
 class StepperController {
 public:
@@ -20,6 +37,24 @@ public:
      */
     void begin();
 
+    /**
+     * Move both motors to absolute positions, each clipped to the limits
+     * @return Steps actually moved
+     */
+    MotorCorrection moveTo(long pos1, long pos2);
+
+    /**
+     * Move both motors by relative steps, each clipped to the limits
+     * @return Steps actually moved
+     */
+    MotorCorrection moveBy(long steps1, long steps2);
+
+    /**
+     * moveBy() at a given step delay instead of the setSpeed() one
+     * (stall calibration; not limited to 1000 us)
+     */
+    MotorCorrection moveBy(long steps1, long steps2, unsigned long delayUs);
+
     /**
      * Move motor 1 (left back leg) by specified steps
      * @param steps Positive = raise leg, negative = lower leg
@@ -39,11 +74,26 @@ public:
      */
     void moveBoth(int steps1, int steps2);
 
+    /**
+     * Take one step on either or both motors without waiting
+     * Used by MotionPlanner, which does its own step timing.
+     * @param dir1 Motor 1 direction (1, -1, or 0 for no step)
+     * @param dir2 Motor 2 direction (1, -1, or 0 for no step)
+     */
+    void step(int dir1, int dir2);
+
     /**
      * Apply motor correction from leveling algorithm
+     *
+     * The correction is scaled down to MAX_CORRECTION_STEPS with its ratio
+     * kept. If a motor then runs into a position limit, the other motor is
+     * re-solved (least squares on the PLANT_* gains) for the tilt change
+     * the full correction asked for.
+     *
      * @param correction Motor steps calculated by PI controller
+     * @return Steps actually moved, for LevelingController::reportApplied()
      */
-    void applyCorrection(const MotorCorrection& correction);
+    MotorCorrection applyCorrection(const MotorCorrection& correction);
 
     /**
      * De-energize both motors to save power
@@ -51,12 +101,67 @@ public:
      */
     void release();
 
+    /**
+     * Keep the last coil pattern energized at reduced current
+     *
+     * The rotor stays in its detent, so the next move starts exactly where
+     * the last one ended, without the heat of full holding current. The next
+     * step returns to full drive; after the hold timeout the coils are
+     * released. A duty of 0 releases immediately.
+     */
+    void hold();
+
+    /**
+     * Release a hold once its timeout has passed; call every loop()
+     */
+    void update();
+
+    /**
+     * Configure hold()
+     * @param dutyPercent Coil duty while holding (0-100)
+     * @param timeoutMs Time before falling back to release (0 = never)
+     */
+    void setHold(uint8_t dutyPercent, unsigned long timeoutMs);
+    uint8_t getHoldDuty() const { return _holdDutyPercent; }
+    unsigned long getHoldTimeout() const { return _holdTimeoutMs; }
+    bool isHolding() const { return _holding; }
+
     /**
      * Set motor speed
      * @param rpm Revolutions per minute (1-15 recommended for 28BYJ-48)
      */
     void setSpeed(float rpm);
 
+    /**
+     * Switch between half-step (on/off) and sine microstepping drive.
+     * Coils are released on a change; the rotor phase is kept.
+     */
+    void setMicrostepping(bool enabled);
+    bool isMicrostepping() const { return _microstepping; }
+
+    /**
+     * Microstepping: move the coil phases part of the way from where they
+     * were at the last step() to where that step ends. Callers that step
+     * without waiting (MotionPlanner) call this between steps.
+     * @param fraction 0 = start of the step, 1 = step complete
+     */
+    void interpolate(float fraction);
+
+    /**
+     * Get delay between steps set by setSpeed()
+     */
+    unsigned long getStepDelayUs() const { return _stepDelayUs; }
+
+    /**
+     * Step delay applyCorrection() uses for one motor and direction
+     * (from StepRateTuner)
+     * @param motor 1 or 2
+     * @param direction 1 or -1
+     * @param us Delay, or 0 for the setSpeed() delay
+     */
+    void setCorrectionDelay(uint8_t motor, int direction, unsigned long us);
+    unsigned long getCorrectionDelay(uint8_t motor, int direction) const;
+
     /**
      * Get current step position for motor 1
      */
@@ -86,6 +191,31 @@ public:
      */
     bool isAtLimit2() const;
 
+    /**
+     * Clip a relative move of motor 1 or 2 so it ends inside the limits
+     */
+    long clipSteps1(long steps) const { return constrain(_position1 + steps, _minPosition, _maxPosition) - _position1; }
+    long clipSteps2(long steps) const { return constrain(_position2 + steps, _minPosition, _maxPosition) - _position2; }
+
+    /**
+     * Backlash take-up per motor
+     * @param motor 1 or 2
+     * @param steps Dead band crossed on a direction reversal (0 = off)
+     */
+    void setBacklash(uint8_t motor, uint16_t steps);
+    uint16_t getBacklash(uint8_t motor) const { return motor == 2 ? _backlash2 : _backlash1; }
+
+    /**
+     * Direction of the last step of a motor: 1, -1, or 0 before the first
+     */
+    int getLastDirection(uint8_t motor) const { return motor == 2 ? _lastDir2 : _lastDir1; }
+
+    /**
+     * Extra uncounted steps a move of a motor needs before it starts moving
+     * the leg (signed like steps)
+     */
+    long takeUpFor(uint8_t motor, long steps) const;
+
     /**
      * Get position limits
      */
@@ -121,6 +251,34 @@ private:
     long _minPosition;    // Minimum allowed position
     long _maxPosition;    // Maximum allowed position
     unsigned long _stepDelayUs;  // Delay between steps in microseconds
+    unsigned long _correctionDelayUs[2][2];  // [motor - 1][0 = forward, 1 = reverse], 0 = _stepDelayUs
+
+    // Microstepping: electrical phase in microsteps (unwrapped), where the
+    // coils are now and where the current step started and ends
+    bool _microstepping;
+    long _phase1, _phaseFrom1, _phaseTo1;
+    long _phase2, _phaseFrom2, _phaseTo2;
+
+    // Backlash: take-up steps still to make before steps count again
+    uint16_t _backlash1, _backlash2;
+    int8_t _lastDir1, _lastDir2;
+    uint16_t _takeUp1, _takeUp2;
+
+    // Reduced-current hold
+    bool _holding;
+    uint8_t _holdDutyPercent;
+    unsigned long _holdTimeoutMs;
+    unsigned long _holdStartMs;
+
+    /**
+     * Interleave already-clipped steps of both motors (Bresenham)
+     */
+    void runSteps(long steps1, long steps2, unsigned long delayUs);
+
+    /**
+     * Microstepping: start a step event's sweep at the current phases
+     */
+    void startSweep();
 
     /**
      * Execute one step on motor 1
@@ -140,6 +298,28 @@ private:
      * @param pattern 4-bit pattern for coil activation
      */
     void setCoils(const uint8_t* pins, uint8_t pattern);
+
+    /**
+     * Set the PWM duty of a motor's four LEDC channels for a phase
+     * @param channel First LEDC channel of the motor
+     * @param phase Electrical phase in microsteps
+     */
+    void writePhase(uint8_t channel, long phase);
+
+    /**
+     * Route the eight coil pins to their LEDC channels, duty 0
+     */
+    void attachPwm();
+
+    /**
+     * Return the coil pins to GPIO output, all off
+     */
+    void detachPwm();
+
+    /**
+     * Back to full drive before stepping out of a hold
+     */
+    void endHold();
 };
 
 #endif // STEPPER_CONTROLLER_H
@@ -0,0 +1,102 @@
+#include "TelemetryStream.h"
+
+// Scale and round to int16, saturating instead of wrapping
+static int16_t toSample16(float value, float scale) {
+    float scaled = value * scale;
+    if (scaled >= 32767.0f) return 32767;
+    if (scaled <= -32768.0f) return -32768;
+    return (int16_t)lroundf(scaled);
+}
+
+TelemetryStream::TelemetryStream()
+    : _head(0)
+    , _count(0)
+    , _headSeq(0)
+    , _dropped(0)
+    , _sinks(0)
+    , _rateHz(STREAM_DEFAULT_HZ)
+    , _sourceHz(0)
+    , _batchSize(1)
+    , _periodUs(1000000UL / STREAM_DEFAULT_HZ)
+    , _nextSampleUs(0)
+{
+}
+
+void TelemetryStream::start(uint8_t sinks, uint16_t rateHz) {
+    if (!isActive()) {
+        // Fresh stream: sequence numbers continue, so a client that stays
+        // connected across restarts still sees the samples it missed
+        _nextSampleUs = micros();
+    }
+    _sinks |= sinks;
+    _rateHz = constrain(rateHz, 1, STREAM_MAX_HZ);
+    _periodUs = 1000000UL / _rateHz;
+    _batchSize = constrain(_rateHz / STREAM_BATCHES_PER_SEC, 1, STREAM_MAX_BATCH);
+}
+
+void TelemetryStream::stop(uint8_t sinks) {
+    _sinks &= ~sinks;
+}
+
+uint16_t TelemetryStream::getSampleRate() const {
+    return (_sourceHz > 0 && _sourceHz < _rateHz) ? _sourceHz : _rateHz;
+}
+
+bool TelemetryStream::sampleDue(unsigned long nowUs) {
+    if ((long)(nowUs - _nextSampleUs) < 0) return false;
+    _nextSampleUs += _periodUs;
+    // Fell more than a period behind (blocking call elsewhere): restart the
+    // schedule instead of bursting to catch up
+    if ((long)(nowUs - _nextSampleUs) >= 0) {
+        _nextSampleUs = nowUs + _periodUs;
+    }
+    return true;
+}
+
+void TelemetryStream::record(const IMUData& data, long m1pos, long m2pos, unsigned long nowUs) {
+    if (_count == STREAM_RING_SAMPLES) {
+        // Sinks fell behind: drop the oldest, the sequence gap tells the client
+        _head = (_head + 1) % STREAM_RING_SAMPLES;
+        _headSeq++;
+        _count--;
+        _dropped++;
+    }
+
+    StreamSample& s = _ring[(_head + _count) % STREAM_RING_SAMPLES];
+    s.timeUs = nowUs;
+    s.pitch = toSample16(data.pitch, 1000.0f);
+    s.roll = toSample16(data.roll, 1000.0f);
+    s.accel[0] = toSample16(data.accelX, 10000.0f);
+    s.accel[1] = toSample16(data.accelY, 10000.0f);
+    s.accel[2] = toSample16(data.accelZ, 10000.0f);
+    s.gyro[0] = toSample16(data.gyroX, 100.0f);
+    s.gyro[1] = toSample16(data.gyroY, 100.0f);
+    s.gyro[2] = toSample16(data.gyroZ, 100.0f);
+    s.m1pos = m1pos;
+    s.m2pos = m2pos;
+    _count++;
+}
+
+size_t TelemetryStream::takeBatch(uint8_t* out, bool flush) {
+    if (_count == 0 || (_count < _batchSize && !flush)) return 0;
+    uint8_t n = _count < _batchSize ? _count : _batchSize;
+
+    StreamBatchHeader header;
+    header.type = STREAM_FRAME_BATCH;
+    header.version = STREAM_BATCH_VERSION;
+    header.count = n;
+    header.reserved = 0;
+    header.seq = _headSeq;
+    header.rateHz = getSampleRate();
+    memcpy(out, &header, sizeof(header));
+
+    size_t len = sizeof(header);
+    for (uint8_t i = 0; i < n; i++) {
+        memcpy(out + len, &_ring[_head], sizeof(StreamSample));
+        len += sizeof(StreamSample);
+        _head = (_head + 1) % STREAM_RING_SAMPLES;
+    }
+    _count -= n;
+    _headSeq += n;
+    return len;
+}
@@ -0,0 +1,125 @@
+#ifndef TELEMETRY_STREAM_H
+#define TELEMETRY_STREAM_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+/**
+ * TelemetryStream - High-rate IMU/motor sampling with batched binary output
+ *
+ * Samples are recorded once per control tick into a ring buffer and handed
+ * out in batches, so a 1 kHz stream costs tens of frames per second instead
+ * of one print per sample. Every sample has a sequence number; a batch
+ * carries the number of its first sample, so a client that sees the next
+ * batch start anywhere else knows how many samples were lost.
+ *
+ * Batch layout (little-endian, shared by the WebSocket and serial sinks):
+ *   StreamBatchHeader, then count x StreamSample
+ * On serial each batch is the body of a LINK_EVT_STREAM frame (SerialProtocol.h).
+ * data/app.js and tools/telemetry_stream.py hold the decoders.
+ */
+
+#define STREAM_FRAME_BATCH   0x10   // Frame type, distinct from DASH_FRAME_*
+#define STREAM_BATCH_VERSION 1
+
+// Output sinks (bitmask)
+#define STREAM_SINK_SERIAL 0x01
+#define STREAM_SINK_WEB    0x02
+
+struct __attribute__((packed)) StreamBatchHeader {
+    uint8_t type;          // STREAM_FRAME_BATCH
+    uint8_t version;       // STREAM_BATCH_VERSION
+    uint8_t count;         // Samples in this batch
+    uint8_t reserved;
+    uint32_t seq;          // Sequence number of the first sample
+    uint16_t rateHz;       // Rate the samples were taken at (getSampleRate())
+};
+
+struct __attribute__((packed)) StreamSample {
+    uint32_t timeUs;       // micros() when recorded
+    int16_t pitch;         // 0.001 deg
+    int16_t roll;          // 0.001 deg
+    int16_t accel[3];      // 0.0001 g
+    int16_t gyro[3];       // 0.01 deg/s
+    int32_t m1pos;
+    int32_t m2pos;
+};
+
+static_assert(sizeof(StreamBatchHeader) == 10, "StreamBatchHeader layout changed - update decoders");
+static_assert(sizeof(StreamSample) == 28, "StreamSample layout changed - update decoders");
+
+#define STREAM_BATCH_MAX_SIZE (sizeof(StreamBatchHeader) + STREAM_MAX_BATCH * sizeof(StreamSample))
+
+class TelemetryStream {
+public:
+    TelemetryStream();
+
+    /**
+     * Start streaming, or change the rate and sinks of a running stream
+     * @param sinks STREAM_SINK_* bits
+     * @param rateHz Sample rate, clamped to 1..STREAM_MAX_HZ
+     */
+    void start(uint8_t sinks, uint16_t rateHz);
+
+    /**
+     * Remove sinks; the stream stops when none are left
+     */
+    void stop(uint8_t sinks);
+
+    bool isActive() const { return _sinks != 0; }
+    uint8_t getSinks() const { return _sinks; }
+    uint16_t getRate() const { return _rateHz; }
+
+    /**
+     * Rate of whatever paces the IMU when the stream does not (the leveling
+     * states' control tick); 0 when the stream polls it at its own rate
+     */
+    void setSourceRate(uint16_t hz) { _sourceHz = hz; }
+
+    /**
+     * Rate samples are actually recorded at: the requested rate, capped by
+     * the source rate. Reported in each batch header.
+     */
+    uint16_t getSampleRate() const;
+
+    /**
+     * Check whether the next sample tick has arrived. Used where nothing
+     * else updates the IMU; advances the schedule when it returns true.
+     */
+    bool sampleDue(unsigned long nowUs);
+
+    /**
+     * Record one sample
+     */
+    void record(const IMUData& data, long m1pos, long m2pos, unsigned long nowUs);
+
+    /**
+     * Move the oldest full batch into out
+     * @param out Buffer of at least STREAM_BATCH_MAX_SIZE bytes
+     * @param flush Also return a partial batch
+     * @return Batch length in bytes, or 0 if no batch is ready
+     */
+    size_t takeBatch(uint8_t* out, bool flush = false);
+
+    /**
+     * Samples overwritten before they could be sent
+     */
+    uint32_t getDropped() const { return _dropped; }
+
+private:
+    StreamSample _ring[STREAM_RING_SAMPLES];
+    uint16_t _head;        // Oldest sample
+    uint16_t _count;
+    uint32_t _headSeq;     // Sequence number of _ring[_head]
+    uint32_t _dropped;
+
+    uint8_t _sinks;
+    uint16_t _rateHz;
+    uint16_t _sourceHz;
+    uint8_t _batchSize;
+    unsigned long _periodUs;
+    unsigned long _nextSampleUs;
+};
+
+#endif // TELEMETRY_STREAM_H
@@ -0,0 +1,518 @@
+#include "DashboardCommands.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// JsonFields
+// ============================================================================
+
+static char* skipSpace(char* p, char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    return p;
+}
+
+// p at the opening quote; returns the position after the closing quote
+static char* skipString(char* p, char* end) {
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            p++;
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return nullptr;
+}
+
+// Returns the position after the value starting at p, nullptr if malformed
+static char* skipValue(char* p, char* end) {
+    if (p >= end) return nullptr;
+    if (*p == '"') return skipString(p, end);
+
+    if (*p == '[' || *p == '{') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = skipString(p, end);
+                if (!p) return nullptr;
+                continue;
+            }
+            if (*p == '[' || *p == '{') depth++;
+            if (*p == ']' || *p == '}') {
+                if (--depth == 0) return p + 1;
+            }
+            p++;
+        }
+        return nullptr;
+    }
+
+    // Number, true, false, null
+    char* start = p;
+    while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+           *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+        p++;
+    }
+    return p > start ? p : nullptr;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Unescape the string whose opening quote is at p, writing over itself,
+// and NUL-terminate it. The output is never longer than the input, so the
+// terminator lands at or before the closing quote.
+static char* decodeString(char* p, char* end) {
+    char* out = p + 1;
+    char* start = out;
+    for (char* in = p + 1; in < end && *in != '"'; in++) {
+        if (*in != '\\' || in + 1 >= end) {
+            *out++ = *in;
+            continue;
+        }
+        in++;
+        switch (*in) {
+            case 'n': *out++ = '\n'; break;
+            case 't': *out++ = '\t'; break;
+            case 'r': *out++ = '\r'; break;
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                int i = 0;
+                for (; i < 4 && in + 1 < end; i++) {
+                    int d = hexDigit(in[1]);
+                    if (d < 0) break;
+                    cp = (cp << 4) | d;
+                    in++;
+                }
+                if (i < 4) {
+                    *out++ = '?';
+                } else if (cp < 0x80) {
+                    *out++ = (char)cp;
+                } else if (cp < 0x800) {
+                    *out++ = (char)(0xC0 | (cp >> 6));
+                    *out++ = (char)(0x80 | (cp & 0x3F));
+                } else {
+                    *out++ = (char)(0xE0 | (cp >> 12));
+                    *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    *out++ = (char)(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default:  // \" \\ \/
+                *out++ = *in;
+                break;
+        }
+    }
+    *out = '\0';
+    return start;
+}
+
+JsonFields::JsonFields(char* json, size_t len)
+    : _count(0)
+    , _valid(false)
+{
+    char* end = json + len;
+    char* p = skipSpace(json, end);
+    if (p == end || *p != '{') return;
+    p = skipSpace(p + 1, end);
+    if (p < end && *p == '}') {
+        _valid = true;
+        return;
+    }
+
+    while (p < end) {
+        if (*p != '"') return;
+        char* keyEnd = skipString(p, end);
+        if (!keyEnd) return;
+        char* key = p + 1;
+
+        p = skipSpace(keyEnd, end);
+        if (p == end || *p != ':') return;
+        p = skipSpace(p + 1, end);
+        char* value = p;
+        p = skipValue(p, end);
+        if (!p) return;
+
+        if (_count < JSON_MAX_FIELDS) {
+            Field& f = _fields[_count++];
+            f.key = key;
+            f.keyLen = (uint8_t)(keyEnd - 1 - key);
+            f.value = value;
+            f.valueLen = (uint16_t)(p - value);
+            f.decoded = false;
+        }
+
+        p = skipSpace(p, end);
+        if (p == end) return;
+        if (*p == '}') {
+            _valid = true;
+            return;
+        }
+        if (*p != ',') return;
+        p = skipSpace(p + 1, end);
+    }
+}
+
+JsonFields::Field* JsonFields::find(const char* key) {
+    size_t len = strlen(key);
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_fields[i].keyLen == len && memcmp(_fields[i].key, key, len) == 0) {
+            return &_fields[i];
+        }
+    }
+    return nullptr;
+}
+
+const JsonFields::Field* JsonFields::find(const char* key) const {
+    return const_cast<JsonFields*>(this)->find(key);
+}
+
+const char* JsonFields::getString(const char* key) {
+    Field* f = find(key);
+    if (!f) return nullptr;
+    if (!f->decoded) {
+        if (*f->value != '"') return nullptr;
+        f->value = decodeString(f->value, f->value + f->valueLen);
+        f->decoded = true;
+    }
+    return f->value;
+}
+
+bool JsonFields::getInt(const char* key, int32_t& out) const {
+    float value;
+    const Field* f = find(key);
+    if (!f || f->decoded) return false;
+
+    char* end;
+    long n = strtol(f->value, &end, 10);
+    if (end == f->value + f->valueLen) {
+        out = n;
+        return true;
+    }
+    if (!getFloat(key, value)) return false;
+    out = (int32_t)value;
+    return true;
+}
+
+bool JsonFields::getFloat(const char* key, float& out) const {
+    const Field* f = find(key);
+    if (!f || f->decoded) return false;
+
+    char* end;
+    float value = strtof(f->value, &end);
+    if (end == f->value || end != f->value + f->valueLen) return false;
+    out = value;
+    return true;
+}
+
+bool JsonFields::getArray(const char* key, Cursor& cursor) const {
+    const Field* f = find(key);
+    if (!f || f->decoded || *f->value != '[') return false;
+    cursor.p = f->value + 1;
+    cursor.end = f->value + f->valueLen - 1;  // Closing bracket
+    return true;
+}
+
+const char* JsonFields::nextString(Cursor& cursor) {
+    while (true) {
+        char* p = skipSpace(cursor.p, cursor.end);
+        if (p < cursor.end && *p == ',') p = skipSpace(p + 1, cursor.end);
+        if (p >= cursor.end) {
+            cursor.p = cursor.end;
+            return nullptr;
+        }
+        char* next = skipValue(p, cursor.end);
+        if (!next) {
+            cursor.p = cursor.end;
+            return nullptr;
+        }
+        cursor.p = next;
+        if (*p == '"') return decodeString(p, next);
+    }
+}
+
+bool JsonFields::nextFloat(Cursor& cursor, float& out) {
+    while (true) {
+        char* p = skipSpace(cursor.p, cursor.end);
+        if (p < cursor.end && *p == ',') p = skipSpace(p + 1, cursor.end);
+        if (p >= cursor.end) {
+            cursor.p = cursor.end;
+            return false;
+        }
+        char* next = skipValue(p, cursor.end);
+        if (!next) {
+            cursor.p = cursor.end;
+            return false;
+        }
+        cursor.p = next;
+        char* end;
+        float value = strtof(p, &end);
+        if (end == next) {
+            out = value;
+            return true;
+        }
+    }
+}
+
+// Up to n numbers of an array value; the rest of out is unchanged
+static int getFloats(const JsonFields& msg, const char* key, float* out, int n) {
+    JsonFields::Cursor values;
+    int count = 0;
+    if (!msg.getArray(key, values)) return 0;
+    while (count < n && JsonFields::nextFloat(values, out[count])) count++;
+    return count;
+}
+
+// ============================================================================
+// Command decoding
+// ============================================================================
+
+namespace DashboardCommands {
+
+// Hash collisions between command names are duplicate case labels
+#define DASH_CMD(str, id) \
+    case nameHash(str): \
+        return (len == sizeof(str) - 1 && memcmp(name, str, len) == 0) ? DashCmd::id : DashCmd::NONE
+
+DashCmd lookup(const char* name, size_t len) {
+    switch (fnv1a(name, len)) {
+        DASH_CMD("sub",         SUB);
+        DASH_CMD("hstream",     HSTREAM);
+        DASH_CMD("wsstats",     WSSTATS);
+        DASH_CMD("motor",       MOTOR);
+        DASH_CMD("both",        BOTH);
+        DASH_CMD("mstop",       MSTOP);
+        DASH_CMD("mspeed",      MSPEED);
+        DASH_CMD("mcont",       MCONT);
+        DASH_CMD("mreset",      MRESET);
+        DASH_CMD("mreset1",     MRESET1);
+        DASH_CMD("mreset2",     MRESET2);
+        DASH_CMD("mset",        MSET);
+        DASH_CMD("munlock",     MUNLOCK);
+        DASH_CMD("mlock",       MLOCK);
+        DASH_CMD("calibrate",   CALIBRATE);
+        DASH_CMD("scan",        SCAN);
+        DASH_CMD("stream",      STREAM);
+        DASH_CMD("state",       STATE);
+        DASH_CMD("gains",       GAINS);
+        DASH_CMD("tolerance",   TOLERANCE);
+        DASH_CMD("stabTimeout", STAB_TIMEOUT);
+        DASH_CMD("led",         LED);
+        DASH_CMD("release",     RELEASE);
+        DASH_CMD("serial",      SERIAL_TEXT);
+        DASH_CMD("perf",        PERF);
+        DASH_CMD("timing",      TIMING);
+        DASH_CMD("sched",       SCHEDULE);
+        DASH_CMD("tune",        TUNE);
+        default:
+            return DashCmd::NONE;
+    }
+}
+
+#undef DASH_CMD
+
+bool parseJson(char* json, size_t len, DashCommand& out, FieldBitFn fieldBit) {
+    memset(&out, 0, sizeof(out));
+    JsonFields msg(json, len);
+    if (!msg.valid()) return false;
+
+    const char* name = msg.getString("cmd");
+    if (!name) return true;
+    out.cmd = lookup(name, strlen(name));
+
+    switch (out.cmd) {
+        // {"cmd":"sub","fields":["pitch","roll","state"],"hz":50}
+        case DashCmd::SUB: {
+            JsonFields::Cursor fields;
+            if (msg.getArray("fields", fields)) {
+                const char* field;
+                while ((field = JsonFields::nextString(fields)) != nullptr) {
+                    out.mask |= fieldBit(field);
+                }
+            } else {
+                out.mask = DASH_SUB_ALL;
+            }
+            msg.getInt("hz", out.arg[0]);
+            break;
+        }
+        // {"cmd":"hstream","hz":500}
+        case DashCmd::HSTREAM:
+            msg.getInt("hz", out.arg[0]);
+            break;
+        // {"cmd":"motor","id":1,"steps":100}
+        case DashCmd::MOTOR:
+            msg.getInt("id", out.arg[0]);
+            msg.getInt("steps", out.arg[1]);
+            break;
+        // {"cmd":"both","m1":100,"m2":-100}
+        case DashCmd::BOTH:
+            msg.getInt("m1", out.arg[0]);
+            msg.getInt("m2", out.arg[1]);
+            break;
+        // {"cmd":"mspeed","value":10}
+        case DashCmd::MSPEED:
+            out.arg[0] = 10;
+            msg.getInt("value", out.arg[0]);
+            break;
+        // {"cmd":"mcont","id":1}
+        case DashCmd::MCONT:
+            msg.getInt("id", out.arg[0]);
+            break;
+        // {"cmd":"mset","value":0}
+        case DashCmd::MSET:
+            msg.getInt("value", out.arg[0]);
+            break;
+        // {"cmd":"state","to":"IDLE"}
+        case DashCmd::STATE:
+            out.text = msg.getString("to");
+            break;
+        // {"cmd":"gains","kpP":1.0,"kiP":0.05,"kpR":0.5,"kiR":0.03}
+        case DashCmd::GAINS:
+            out.value[0] = 1.0f;
+            out.value[1] = 0.05f;
+            out.value[2] = 0.5f;
+            out.value[3] = 0.03f;
+            msg.getFloat("kpP", out.value[0]);
+            msg.getFloat("kiP", out.value[1]);
+            msg.getFloat("kpR", out.value[2]);
+            msg.getFloat("kiR", out.value[3]);
+            break;
+        // {"cmd":"tolerance","deg":0.5}
+        case DashCmd::TOLERANCE:
+            out.value[0] = 0.5f;
+            msg.getFloat("deg", out.value[0]);
+            break;
+        // {"cmd":"stabTimeout","sec":3.0}
+        case DashCmd::STAB_TIMEOUT:
+            out.value[0] = 3.0f;
+            msg.getFloat("sec", out.value[0]);
+            break;
+        // {"cmd":"led","mode":"red"}
+        case DashCmd::LED:
+            out.text = msg.getString("mode");
+            break;
+        // {"cmd":"serial","text":"mpos"}
+        case DashCmd::SERIAL_TEXT:
+            out.text = msg.getString("text");
+            break;
+        // {"cmd":"perf","reset":1} / {"cmd":"timing","reset":1}
+        case DashCmd::PERF:
+        case DashCmd::TIMING:
+            msg.getInt("reset", out.arg[0]);
+            break;
+        // {"cmd":"sched","table":0,"keys":[0.5,1,2,4],"scales":[0.6,1,1.5,2]}
+        // {"cmd":"sched"} reports only; a table needs all of its points
+        case DashCmd::SCHEDULE:
+            out.arg[0] = DASH_SCHEDULE_REPORT;
+            if (msg.getInt("table", out.arg[0]) &&
+                (getFloats(msg, "keys", out.value, DASH_SCHEDULE_POINTS) < DASH_SCHEDULE_POINTS ||
+                 getFloats(msg, "scales", out.value + DASH_SCHEDULE_POINTS, DASH_SCHEDULE_POINTS) < DASH_SCHEDULE_POINTS)) {
+                out.arg[0] = DASH_SCHEDULE_REPORT;
+            }
+            break;
+        // {"cmd":"tune","rule":"simc"} - zn, tl, simc or stop
+        case DashCmd::TUNE:
+            out.text = msg.getString("rule");
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+// Little-endian reads from a bounds-checked position
+struct BinaryReader {
+    const uint8_t* p;
+    size_t left;
+    bool ok;
+
+    void read(void* out, size_t n) {
+        if (left < n) {
+            ok = false;
+            return;
+        }
+        memcpy(out, p, n);
+        p += n;
+        left -= n;
+    }
+    uint8_t u8() { uint8_t v = 0; read(&v, 1); return v; }
+    uint16_t u16() { uint16_t v = 0; read(&v, 2); return v; }
+    int32_t i32() { int32_t v = 0; read(&v, 4); return v; }
+    uint32_t u32() { uint32_t v = 0; read(&v, 4); return v; }
+    float f32() { float v = 0; read(&v, 4); return v; }
+
+    // Remaining bytes as a NUL-terminated string
+    const char* text() {
+        if (left == 0 || p[left - 1] != '\0') {
+            ok = false;
+            return nullptr;
+        }
+        const char* s = (const char*)p;
+        p += left;
+        left = 0;
+        return s;
+    }
+};
+
+bool parseBinary(const uint8_t* data, size_t len, DashCommand& out) {
+    memset(&out, 0, sizeof(out));
+    if (len == 0 || data[0] == 0 || data[0] > (uint8_t)DASH_CMD_LAST) return false;
+    out.cmd = (DashCmd)data[0];
+
+    BinaryReader in = {data + 1, len - 1, true};
+    switch (out.cmd) {
+        case DashCmd::SUB:
+            out.mask = in.u32();
+            out.arg[0] = in.u16();
+            break;
+        case DashCmd::HSTREAM:
+        case DashCmd::MSPEED:
+            out.arg[0] = in.u16();
+            break;
+        case DashCmd::MOTOR:
+            out.arg[0] = in.u8();
+            out.arg[1] = in.i32();
+            break;
+        case DashCmd::BOTH:
+            out.arg[0] = in.i32();
+            out.arg[1] = in.i32();
+            break;
+        case DashCmd::MCONT:
+        case DashCmd::PERF:
+        case DashCmd::TIMING:
+            out.arg[0] = in.u8();
+            break;
+        case DashCmd::MSET:
+            out.arg[0] = in.i32();
+            break;
+        case DashCmd::GAINS:
+            for (int i = 0; i < 4; i++) out.value[i] = in.f32();
+            break;
+        case DashCmd::TOLERANCE:
+        case DashCmd::STAB_TIMEOUT:
+            out.value[0] = in.f32();
+            break;
+        case DashCmd::SCHEDULE:
+            out.arg[0] = in.u8();
+            if (out.arg[0] != DASH_SCHEDULE_REPORT) {
+                for (int i = 0; i < 2 * DASH_SCHEDULE_POINTS; i++) out.value[i] = in.f32();
+            }
+            break;
+        case DashCmd::STATE:
+        case DashCmd::LED:
+        case DashCmd::SERIAL_TEXT:
+        case DashCmd::TUNE:
+            out.text = in.text();
+            break;
+        default:
+            break;
+    }
+    if (!in.ok) out.cmd = DashCmd::NONE;
+    return in.ok;
+}
+
+} // namespace DashboardCommands
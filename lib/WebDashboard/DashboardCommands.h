@@ -0,0 +1,200 @@
+#ifndef DASHBOARD_COMMANDS_H
+#define DASHBOARD_COMMANDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * DashboardCommands - Commands sent by dashboard clients
+ *
+ * A command arrives either as a flat JSON text frame
+ *   {"cmd":"motor","id":1,"steps":100}
+ * or as a binary frame
+ *   [opcode = DashCmd value][arguments, little-endian]
+ * and both decode into the same DashCommand, which WebDashboard executes.
+ *
+ * Neither path allocates. JSON is scanned in place by JsonFields (strings
+ * are unescaped and terminated inside the receive buffer), and command
+ * names are resolved by a switch on their FNV-1a hash. The case labels are
+ * computed at compile time, so two names that collide are a duplicate case
+ * and fail the build.
+ *
+ * Binary arguments per opcode (text is NUL-terminated and runs to the end
+ * of the frame):
+ *   SUB          uint32 field mask (0xFFFFFFFF = all), uint16 hz (0 = default)
+ *   HSTREAM      uint16 hz (0 = off)
+ *   MOTOR        uint8 motor, int32 steps
+ *   BOTH         int32 m1 steps, int32 m2 steps
+ *   MSPEED       uint16 rpm
+ *   MCONT        uint8 motor
+ *   MSET         int32 position
+ *   GAINS        float kpP, kiP, kpR, kiR
+ *   TOLERANCE    float degrees
+ *   STAB_TIMEOUT float seconds
+ *   PERF, TIMING uint8 reset (1 = clear after reporting)
+ *   SCHEDULE     uint8 table (0 = error, 1 = position, 0xFF = report only),
+ *                then unless 0xFF float keys[4], float scales[4]
+ *   STATE, LED, SERIAL_TEXT, TUNE  text
+ *   others       no arguments
+ * data/app.js holds the matching encoder.
+ *
+ * No Arduino dependencies, so bench/ can build this on the host.
+ */
+
+// Opcode values are the binary wire format - append only, never reorder
+enum class DashCmd : uint8_t {
+    NONE         = 0x00,
+    SUB          = 0x01,
+    HSTREAM      = 0x02,
+    WSSTATS      = 0x03,
+    MOTOR        = 0x04,
+    BOTH         = 0x05,
+    MSTOP        = 0x06,
+    MSPEED       = 0x07,
+    MCONT        = 0x08,
+    MRESET       = 0x09,
+    MRESET1      = 0x0A,
+    MRESET2      = 0x0B,
+    MSET         = 0x0C,
+    MUNLOCK      = 0x0D,
+    MLOCK        = 0x0E,
+    CALIBRATE    = 0x0F,
+    SCAN         = 0x10,
+    STREAM       = 0x11,
+    STATE        = 0x12,
+    GAINS        = 0x13,
+    TOLERANCE    = 0x14,
+    STAB_TIMEOUT = 0x15,
+    LED          = 0x16,
+    RELEASE      = 0x17,
+    SERIAL_TEXT  = 0x18,
+    PERF         = 0x19,
+    TIMING       = 0x1A,
+    SCHEDULE     = 0x1B,
+    TUNE         = 0x1C,
+};
+
+#define DASH_CMD_LAST DashCmd::TUNE
+
+#define DASH_SCHEDULE_POINTS 4        // Matches GAIN_SCHEDULE_POINTS
+#define DASH_SCHEDULE_REPORT 0xFF
+
+#define DASH_SUB_ALL 0xFFFFFFFFUL
+
+// Decoded command. Unused members are zero / nullptr.
+struct DashCommand {
+    DashCmd cmd;
+    int32_t arg[2];       // motor + steps, m1 + m2, hz, rpm, position, reset flag, schedule table
+    uint32_t mask;        // SUB field mask
+    float value[2 * DASH_SCHEDULE_POINTS];  // GAINS kpP kiP kpR kiR; TOLERANCE / STAB_TIMEOUT in
+                                            // value[0]; SCHEDULE keys then scales
+    const char* text;     // STATE, LED, SERIAL_TEXT, TUNE (points into the frame)
+};
+
+#define JSON_MAX_FIELDS 8
+
+/**
+ * JsonFields - Zero-copy scanner for one flat JSON object
+ *
+ * Records where each top-level value starts without converting anything;
+ * values are parsed on request. Nested objects and arrays are skipped as
+ * a whole (arrays of strings can be walked with getArray / nextString).
+ * Keys must not contain escapes. Fields past JSON_MAX_FIELDS are ignored.
+ */
+class JsonFields {
+public:
+    struct Cursor {
+        char* p;
+        char* end;
+    };
+
+    /**
+     * Scan json[0..len); the buffer is modified by getString / nextString
+     */
+    JsonFields(char* json, size_t len);
+
+    bool valid() const { return _valid; }
+
+    /**
+     * String value, unescaped and NUL-terminated in place
+     * @return nullptr if missing or not a string
+     */
+    const char* getString(const char* key);
+
+    /**
+     * Numeric value (a fractional number is truncated for getInt)
+     * @return false if missing or not a number (out is unchanged)
+     */
+    bool getInt(const char* key, int32_t& out) const;
+    bool getFloat(const char* key, float& out) const;
+
+    /**
+     * Position a cursor on the elements of an array value
+     * @return false if missing or not an array
+     */
+    bool getArray(const char* key, Cursor& cursor) const;
+
+    /**
+     * Next string element of an array (non-strings are skipped)
+     * @return Unescaped, NUL-terminated string, or nullptr at the end
+     */
+    static const char* nextString(Cursor& cursor);
+
+    /**
+     * Next numeric element of an array (non-numbers are skipped)
+     * @return false at the end
+     */
+    static bool nextFloat(Cursor& cursor, float& out);
+
+private:
+    struct Field {
+        const char* key;
+        char* value;
+        uint16_t valueLen;
+        uint8_t keyLen;
+        bool decoded;         // String already unescaped, value points at it
+    };
+
+    Field _fields[JSON_MAX_FIELDS];
+    uint8_t _count;
+    bool _valid;
+
+    Field* find(const char* key);
+    const Field* find(const char* key) const;
+};
+
+namespace DashboardCommands {
+
+constexpr uint32_t fnv1a(const char* s, size_t len, uint32_t h = 2166136261UL) {
+    return len == 0 ? h : fnv1a(s + 1, len - 1, (h ^ (uint8_t)*s) * 16777619UL);
+}
+
+template <size_t N>
+constexpr uint32_t nameHash(const char (&name)[N]) {
+    return fnv1a(name, N - 1);
+}
+
+/**
+ * Resolve a JSON command name
+ * @return Command, or DashCmd::NONE if unknown
+ */
+DashCmd lookup(const char* name, size_t len);
+
+// Maps a subscribe field name to its mask bit (0 if unknown)
+typedef uint32_t (*FieldBitFn)(const char* name);
+
+/**
+ * Decode a JSON text frame. out.cmd is NONE for a missing or unknown "cmd".
+ * @return false if the frame is not a well-formed flat JSON object
+ */
+bool parseJson(char* json, size_t len, DashCommand& out, FieldBitFn fieldBit);
+
+/**
+ * Decode a binary frame
+ * @return false for an unknown opcode or a short frame
+ */
+bool parseBinary(const uint8_t* data, size_t len, DashCommand& out);
+
+} // namespace DashboardCommands
+
+#endif // DASHBOARD_COMMANDS_H
@@ -0,0 +1,283 @@
+#ifndef DASHBOARD_PROTOCOL_H
+#define DASHBOARD_PROTOCOL_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include "types.h"
+
+/**
+ * DashboardProtocol - Binary WebSocket frames sent to the dashboard
+ *
+ * Every binary frame starts with a 1-byte frame type and a 1-byte version.
+ * All multi-byte fields are little-endian (native on the ESP32), so frames
+ * are built by filling a packed struct and sent as-is with WS_BINARY.
+ * data/app.js holds the matching decoder - keep the two in sync and bump
+ * the version whenever a layout changes.
+ *
+ * Status is sent as a keyframe on connect and every WEB_KEYFRAME_INTERVAL_MS,
+ * and as delta frames in between:
+ *   [type=DASH_FRAME_DELTA][version][uint32 field mask][changed fields...]
+ * Bit i of the mask refers to STATUS_FIELDS[i]; the changed fields follow
+ * in table order using the same encoding as in the keyframe.
+ *
+ * Clients subscribed to every field get a full StatusFrame as keyframe.
+ * Clients subscribed to a subset ({"cmd":"sub","fields":[...],"hz":N})
+ * get a DASH_FRAME_SNAPSHOT instead: same layout as a delta, but carrying
+ * every subscribed field, and the client discards its previous state.
+ *
+ * Frame types 0x10 and up belong to other streams sharing the socket
+ * (STREAM_FRAME_BATCH, see TelemetryStream.h).
+ */
+
+#define DASH_FRAME_STATUS   0x01
+#define DASH_FRAME_DELTA    0x02
+#define DASH_FRAME_SNAPSHOT 0x03
+#define DASH_STATUS_VERSION 2
+#define DASH_DELTA_VERSION 2
+
+// Status flag bits
+#define DASH_FLAG_CALIBRATED 0x01
+#define DASH_FLAG_LEVEL      0x02
+#define DASH_FLAG_M1_LIMIT   0x04
+#define DASH_FLAG_M2_LIMIT   0x08
+
+// Values gathered by main.cpp for one status broadcast
+struct DashboardStatus {
+    float pitch;
+    float roll;
+    float accelX;
+    float accelY;
+    float accelZ;
+    float gyroX;
+    float gyroY;
+    float gyroZ;
+    float temperature;
+    long m1pos;
+    long m2pos;
+    long minPos;
+    long maxPos;
+    bool m1limit;
+    bool m2limit;
+    SystemState state;
+    bool isCalibrated;
+    bool isLevel;
+    float tolerance;
+    unsigned long stabilityTimeoutMs;
+    float kpPitch;
+    float kiPitch;
+    float kpRoll;
+    float kiRoll;
+    unsigned long uptime;
+    unsigned long settleMs;    // Last move's settle time (SettleDetector)
+};
+
+// Fixed-point scales keep the same resolution the JSON status used
+// (pitch/roll 0.01 deg, accel 0.001 g, gyro 0.1 deg/s, temp 0.1 C)
+struct __attribute__((packed)) StatusFrame {
+    uint8_t type;          // DASH_FRAME_STATUS
+    uint8_t version;       // DASH_STATUS_VERSION
+    uint8_t state;         // SystemState enum value
+    uint8_t flags;         // DASH_FLAG_* bits
+    int16_t pitch;         // 0.01 deg
+    int16_t roll;          // 0.01 deg
+    int16_t accel[3];      // 0.001 g
+    int16_t gyro[3];       // 0.1 deg/s
+    int16_t temperature;   // 0.1 C
+    int32_t m1pos;
+    int32_t m2pos;
+    int32_t minPos;
+    int32_t maxPos;
+    uint32_t stabilityTimeoutMs;
+    uint32_t uptime;       // ms
+    float tolerance;       // deg
+    float kpPitch;
+    float kiPitch;
+    float kpRoll;
+    float kiRoll;
+    int16_t settleMs;      // ms
+};
+
+static_assert(sizeof(StatusFrame) == 68, "StatusFrame layout changed - update data/app.js");
+
+// Delta frame header: type, version, field mask
+#define DASH_DELTA_HEADER_SIZE 6
+#define DASH_DELTA_MAX_SIZE (DASH_DELTA_HEADER_SIZE + sizeof(StatusFrame) - 2)
+
+enum class FieldKind : uint8_t { U8, I16, I32, U32, F32 };
+
+// One status field as it appears in StatusFrame. A field is included in a
+// delta when it differs from the last value sent by more than deadband
+// (in encoded units; floats are compared bit-for-bit). name is what
+// clients use in subscribe requests.
+struct StatusField {
+    const char* name;
+    uint8_t offset;
+    FieldKind kind;
+    uint16_t deadband;
+};
+
+// Order defines the delta mask bits - append only, never reorder
+static const StatusField STATUS_FIELDS[] = {
+    {"state", offsetof(StatusFrame, state),              FieldKind::U8,  0},
+    {"flags", offsetof(StatusFrame, flags),              FieldKind::U8,  0},
+    {"pitch", offsetof(StatusFrame, pitch),              FieldKind::I16, 0},    // any 0.01 deg step
+    {"roll",  offsetof(StatusFrame, roll),               FieldKind::I16, 0},
+    {"ax",    offsetof(StatusFrame, accel) + 0,          FieldKind::I16, 2},    // 0.002 g
+    {"ay",    offsetof(StatusFrame, accel) + 2,          FieldKind::I16, 2},
+    {"az",    offsetof(StatusFrame, accel) + 4,          FieldKind::I16, 2},
+    {"gx",    offsetof(StatusFrame, gyro) + 0,           FieldKind::I16, 1},    // 0.1 deg/s
+    {"gy",    offsetof(StatusFrame, gyro) + 2,           FieldKind::I16, 1},
+    {"gz",    offsetof(StatusFrame, gyro) + 4,           FieldKind::I16, 1},
+    {"temp",  offsetof(StatusFrame, temperature),        FieldKind::I16, 1},    // 0.1 C
+    {"m1",    offsetof(StatusFrame, m1pos),              FieldKind::I32, 0},
+    {"m2",    offsetof(StatusFrame, m2pos),              FieldKind::I32, 0},
+    {"mMin",  offsetof(StatusFrame, minPos),             FieldKind::I32, 0},
+    {"mMax",  offsetof(StatusFrame, maxPos),             FieldKind::I32, 0},
+    {"stMs",  offsetof(StatusFrame, stabilityTimeoutMs), FieldKind::U32, 0},
+    {"up",    offsetof(StatusFrame, uptime),             FieldKind::U32, 999},  // once per second
+    {"tol",   offsetof(StatusFrame, tolerance),          FieldKind::F32, 0},
+    {"kpP",   offsetof(StatusFrame, kpPitch),            FieldKind::F32, 0},
+    {"kiP",   offsetof(StatusFrame, kiPitch),            FieldKind::F32, 0},
+    {"kpR",   offsetof(StatusFrame, kpRoll),             FieldKind::F32, 0},
+    {"kiR",   offsetof(StatusFrame, kiRoll),             FieldKind::F32, 0},
+    {"settle", offsetof(StatusFrame, settleMs),          FieldKind::I16, 0},
+};
+
+#define STATUS_FIELD_COUNT (sizeof(STATUS_FIELDS) / sizeof(STATUS_FIELDS[0]))
+static_assert(STATUS_FIELD_COUNT <= 32, "Delta mask is 32 bits");
+
+#define DASH_FIELDS_ALL ((uint32_t)((1ULL << STATUS_FIELD_COUNT) - 1))
+
+namespace DashboardProtocol {
+
+// Scale and round to int16, saturating instead of wrapping
+inline int16_t toFixed16(float value, float scale) {
+    float scaled = value * scale;
+    if (scaled >= 32767.0f) return 32767;
+    if (scaled <= -32768.0f) return -32768;
+    return (int16_t)lroundf(scaled);
+}
+
+inline void encodeStatus(const DashboardStatus& s, StatusFrame& f) {
+    f.type = DASH_FRAME_STATUS;
+    f.version = DASH_STATUS_VERSION;
+    f.state = (uint8_t)s.state;
+    f.flags = (s.isCalibrated ? DASH_FLAG_CALIBRATED : 0) |
+              (s.isLevel      ? DASH_FLAG_LEVEL      : 0) |
+              (s.m1limit      ? DASH_FLAG_M1_LIMIT   : 0) |
+              (s.m2limit      ? DASH_FLAG_M2_LIMIT   : 0);
+    f.pitch = toFixed16(s.pitch, 100.0f);
+    f.roll = toFixed16(s.roll, 100.0f);
+    f.accel[0] = toFixed16(s.accelX, 1000.0f);
+    f.accel[1] = toFixed16(s.accelY, 1000.0f);
+    f.accel[2] = toFixed16(s.accelZ, 1000.0f);
+    f.gyro[0] = toFixed16(s.gyroX, 10.0f);
+    f.gyro[1] = toFixed16(s.gyroY, 10.0f);
+    f.gyro[2] = toFixed16(s.gyroZ, 10.0f);
+    f.temperature = toFixed16(s.temperature, 10.0f);
+    f.m1pos = s.m1pos;
+    f.m2pos = s.m2pos;
+    f.minPos = s.minPos;
+    f.maxPos = s.maxPos;
+    f.stabilityTimeoutMs = s.stabilityTimeoutMs;
+    f.uptime = s.uptime;
+    f.tolerance = s.tolerance;
+    f.kpPitch = s.kpPitch;
+    f.kiPitch = s.kiPitch;
+    f.kpRoll = s.kpRoll;
+    f.kiRoll = s.kiRoll;
+    f.settleMs = toFixed16((float)s.settleMs, 1.0f);
+}
+
+inline uint8_t fieldSize(FieldKind kind) {
+    switch (kind) {
+        case FieldKind::U8:  return 1;
+        case FieldKind::I16: return 2;
+        default:             return 4;
+    }
+}
+
+// True if the field moved past its deadband since the baseline
+inline bool fieldChanged(const StatusField& field, const uint8_t* cur, const uint8_t* base) {
+    cur += field.offset;
+    base += field.offset;
+    int64_t diff;
+    switch (field.kind) {
+        case FieldKind::U8:
+            diff = (int64_t)*cur - (int64_t)*base;
+            break;
+        case FieldKind::I16: {
+            int16_t a, b;
+            memcpy(&a, cur, 2);
+            memcpy(&b, base, 2);
+            diff = (int64_t)a - (int64_t)b;
+            break;
+        }
+        case FieldKind::I32: {
+            int32_t a, b;
+            memcpy(&a, cur, 4);
+            memcpy(&b, base, 4);
+            diff = (int64_t)a - (int64_t)b;
+            break;
+        }
+        case FieldKind::U32: {
+            uint32_t a, b;
+            memcpy(&a, cur, 4);
+            memcpy(&b, base, 4);
+            diff = (int64_t)a - (int64_t)b;
+            break;
+        }
+        case FieldKind::F32:
+        default:
+            return memcmp(cur, base, 4) != 0;
+    }
+    if (diff < 0) diff = -diff;
+    return diff > field.deadband;
+}
+
+// Field mask bit for a subscribe name, 0 if unknown
+inline uint32_t fieldBit(const char* name) {
+    for (size_t i = 0; i < STATUS_FIELD_COUNT; i++) {
+        if (strcmp(STATUS_FIELDS[i].name, name) == 0) return 1UL << i;
+    }
+    return 0;
+}
+
+/**
+ * Build a delta frame from the subscribed fields of cur that moved past
+ * their deadband relative to baseline, and copy those fields into baseline
+ * (so deadbands are measured against what the client last received, never
+ * drifting).
+ * @param fields Subscribed field mask
+ * @param snapshot Include every subscribed field and mark the frame as a snapshot
+ * @param out Buffer of at least DASH_DELTA_MAX_SIZE bytes
+ * @return Frame length, or 0 if nothing changed
+ */
+inline size_t encodeDelta(const StatusFrame& cur, StatusFrame& baseline,
+                          uint32_t fields, bool snapshot, uint8_t* out) {
+    const uint8_t* c = (const uint8_t*)&cur;
+    uint8_t* b = (uint8_t*)&baseline;
+    uint32_t mask = 0;
+    size_t len = DASH_DELTA_HEADER_SIZE;
+
+    for (size_t i = 0; i < STATUS_FIELD_COUNT; i++) {
+        const StatusField& field = STATUS_FIELDS[i];
+        if (!(fields & (1UL << i))) continue;
+        if (!snapshot && !fieldChanged(field, c, b)) continue;
+        uint8_t size = fieldSize(field.kind);
+        memcpy(out + len, c + field.offset, size);
+        memcpy(b + field.offset, c + field.offset, size);
+        len += size;
+        mask |= (1UL << i);
+    }
+
+    if (mask == 0) return 0;
+    out[0] = snapshot ? DASH_FRAME_SNAPSHOT : DASH_FRAME_DELTA;
+    out[1] = DASH_DELTA_VERSION;
+    memcpy(out + 2, &mask, 4);
+    return len;
+}
+
+} // namespace DashboardProtocol
+
+#endif // DASHBOARD_PROTOCOL_H
@@ -0,0 +1,19 @@
+#ifndef WEB_ASSET_H
+#define WEB_ASSET_H
+
+#include <Arduino.h>
+
+/**
+ * One dashboard file embedded in flash by scripts/embed_assets.py
+ * (the generated table is web_assets.h in the build directory)
+ */
+struct WebAsset {
+    const char* path;          // URL path
+    const char* contentType;
+    const char* etag;          // Quoted strong ETag (content hash)
+    bool immutable;            // Path contains the hash: cache forever
+    const uint8_t* gzip;       // Gzip-compressed body
+    size_t len;
+};
+
+#endif // WEB_ASSET_H
@@ -1,6 +1,60 @@
 #include "WebDashboard.h"
+#include "web_assets.h"
 
-WebDashboard::WebDashboard() : _server(80), _ws("/ws") {}
+// Serves the dashboard files embedded by scripts/embed_assets.py directly
+// from flash. Bodies are pre-compressed, so clients must accept gzip (every
+// browser does). Hashed file names are cached as immutable; index.html is
+// revalidated and answered with 304 while its ETag still matches.
+class WebAssetHandler : public AsyncWebHandler {
+public:
+    bool canHandle(AsyncWebServerRequest* request) override {
+        if (request->method() != HTTP_GET || !findAsset(request->url().c_str())) return false;
+        request->addInterestingHeader("If-None-Match");
+        return true;
+    }
+
+    void handleRequest(AsyncWebServerRequest* request) override {
+        const WebAsset* asset = findAsset(request->url().c_str());
+        if (!asset) {
+            request->send(404);
+            return;
+        }
+
+        AsyncWebServerResponse* response;
+        AsyncWebHeader* match = request->getHeader("If-None-Match");
+        if (match && match->value() == asset->etag) {
+            response = request->beginResponse(304);
+        } else {
+            response = request->beginResponse_P(200, asset->contentType, asset->gzip, asset->len);
+            response->addHeader("Content-Encoding", "gzip");
+        }
+        response->addHeader("ETag", asset->etag);
+        response->addHeader("Cache-Control", asset->immutable
+                            ? "public, max-age=31536000, immutable"
+                            : "no-cache");
+        request->send(response);
+    }
+
+private:
+    static const WebAsset* findAsset(const char* path) {
+        for (size_t i = 0; i < WEB_ASSET_COUNT; i++) {
+            if (strcmp(WEB_ASSETS[i].path, path) == 0) return &WEB_ASSETS[i];
+        }
+        return nullptr;
+    }
+};
+
+WebDashboard::WebDashboard()
+    : _server(80)
+    , _ws("/ws")
+    , _clientMux(portMUX_INITIALIZER_UNLOCKED)
+{
+    memset(_clients, 0, sizeof(_clients));
+    memset(_groups, 0, sizeof(_groups));
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        _clients[i].group = -1;
+    }
+}
 
 bool WebDashboard::begin() {
     // Start WiFi AP
@@ -9,13 +63,6 @@ bool WebDashboard::begin() {
     Serial.printf("[WEB] AP started: SSID=%s IP=%s\n",
                   WIFI_AP_SSID, WiFi.softAPIP().toString().c_str());
 
-    // Mount LittleFS
-    if (!LittleFS.begin(true)) {
-        Serial.println("[WEB] ERROR: LittleFS mount failed!");
-        return false;
-    }
-    Serial.println("[WEB] LittleFS mounted");
-
     // WebSocket event handler
     _ws.onEvent([this](AsyncWebSocket* s, AsyncWebSocketClient* c,
                        AwsEventType t, void* a, uint8_t* d, size_t l) {
@@ -23,69 +70,346 @@ bool WebDashboard::begin() {
     });
     _server.addHandler(&_ws);
 
-    // Serve static files from LittleFS
-    _server.serveStatic("/", LittleFS, "/").setDefaultFile("index.html");
+    // Dashboard files embedded in flash
+    _server.addHandler(new WebAssetHandler());
+    _server.onNotFound([](AsyncWebServerRequest* request) {
+        request->send(404);
+    });
 
     _server.begin();
     Serial.println("[WEB] HTTP server started on port 80");
     return true;
 }
 
-void WebDashboard::broadcastStatus(
-    float pitch, float roll,
-    float accelX, float accelY, float accelZ,
-    float gyroX, float gyroY, float gyroZ,
-    float temperature,
-    long m1pos, long m2pos,
-    long minPos, long maxPos,
-    bool m1limit, bool m2limit,
-    const char* state,
-    bool isCalibrated, bool isLevel,
-    float tolerance,
-    unsigned long stabilityTimeoutMs,
-    float kpPitch, float kiPitch, float kpRoll, float kiRoll,
-    unsigned long uptime
-) {
-    JsonDocument doc;
-    doc["t"] = "status";
-    doc["pitch"] = serialized(String(pitch, 2));
-    doc["roll"] = serialized(String(roll, 2));
-    doc["ax"] = serialized(String(accelX, 3));
-    doc["ay"] = serialized(String(accelY, 3));
-    doc["az"] = serialized(String(accelZ, 3));
-    doc["gx"] = serialized(String(gyroX, 1));
-    doc["gy"] = serialized(String(gyroY, 1));
-    doc["gz"] = serialized(String(gyroZ, 1));
-    doc["temp"] = serialized(String(temperature, 1));
-    doc["m1"] = m1pos;
-    doc["m2"] = m2pos;
-    doc["mMin"] = minPos;
-    doc["mMax"] = maxPos;
-    doc["m1Lim"] = m1limit;
-    doc["m2Lim"] = m2limit;
-    doc["state"] = state;
-    doc["cal"] = isCalibrated;
-    doc["level"] = isLevel;
-    doc["tol"] = serialized(String(tolerance, 2));
-    doc["stMs"] = stabilityTimeoutMs;
-    doc["kpP"] = serialized(String(kpPitch, 2));
-    doc["kiP"] = serialized(String(kiPitch, 3));
-    doc["kpR"] = serialized(String(kpRoll, 2));
-    doc["kiR"] = serialized(String(kiRoll, 3));
-    doc["up"] = uptime;
-
-    char buf[512];
-    size_t len = serializeJson(doc, buf, sizeof(buf));
-    _ws.textAll(buf, len);
+void WebDashboard::update() {
+    applySubscriptions();
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (_clients[i].active) flushClient(i);
+    }
+}
+
+bool WebDashboard::statusDue(unsigned long now) const {
+    for (int g = 0; g < WS_MAX_CLIENTS; g++) {
+        if (_groups[g].members > 0 && now - _groups[g].lastSendTime >= _groups[g].intervalMs) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WebDashboard::broadcastStatus(const DashboardStatus& status) {
+    // Fixed-layout binary frame: no JsonDocument, no String temporaries
+    StatusFrame frame;
+    DashboardProtocol::encodeStatus(status, frame);
+
+    unsigned long now = millis();
+    for (int g = 0; g < WS_MAX_CLIENTS; g++) {
+        SubscriptionGroup& grp = _groups[g];
+        if (grp.members == 0 || now - grp.lastSendTime < grp.intervalMs) continue;
+        grp.lastSendTime = now;
+        sendGroup(g, frame, now);
+    }
+}
+
+void WebDashboard::sendGroup(uint8_t g, const StatusFrame& frame, unsigned long now) {
+    SubscriptionGroup& grp = _groups[g];
+    const uint8_t* data;
+    size_t len;
+
+    // Keyframe when a client joined or periodically to resync the group,
+    // otherwise only the fields that moved past their deadband
+    if (grp.keyframePending || now - grp.lastKeyframeTime >= WEB_KEYFRAME_INTERVAL_MS) {
+        grp.keyframePending = false;
+        grp.lastKeyframeTime = now;
+        grp.baseline = frame;
+        if (grp.mask == DASH_FIELDS_ALL) {
+            data = (const uint8_t*)&frame;
+            len = sizeof(frame);
+        } else {
+            data = _frameBuf;
+            len = DashboardProtocol::encodeDelta(frame, grp.baseline, grp.mask, true, _frameBuf);
+        }
+    } else {
+        data = _frameBuf;
+        len = DashboardProtocol::encodeDelta(frame, grp.baseline, grp.mask, false, _frameBuf);
+    }
+    if (len == 0) return;  // Nothing changed
+
+    AsyncWebSocketMessageBuffer* shared = nullptr;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        ClientSlot& slot = _clients[i];
+        if (!slot.active || slot.group != g) continue;
+        AsyncWebSocketClient* client = _ws.client(slot.clientId);
+        if (!client) continue;
+
+        // A client that missed a frame has a stale baseline until its
+        // snapshot goes out - deltas would be wrong, so keep coalescing
+        if (!slot.resyncPending && clientWritable(client, len)) {
+            if (!shared) shared = makeShared(data, len);
+            if (shared) client->binary(shared);
+            else client->binary((const char*)data, len);
+            slot.statusSent++;
+        } else {
+            slot.resyncPending = true;
+            slot.statusCoalesced++;
+        }
+    }
+    releaseShared(shared);
+}
+
+void WebDashboard::sendStream(const uint8_t* batch, size_t len) {
+    AsyncWebSocketMessageBuffer* shared = nullptr;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        ClientSlot& slot = _clients[i];
+        if (!slot.active || slot.streamHz == 0) continue;
+        AsyncWebSocketClient* client = _ws.client(slot.clientId);
+        if (client && clientWritable(client, len)) {
+            if (!shared) shared = makeShared(batch, len);
+            if (shared) client->binary(shared);
+            else client->binary((const char*)batch, len);
+        }
+    }
+    releaseShared(shared);
+}
+
+AsyncWebSocketMessageBuffer* WebDashboard::makeShared(const uint8_t* data, size_t len) {
+    // client->binary(data, len) copies the frame into a new buffer for each
+    // client; a MessageBuffer is copied once and referenced by every queued
+    // message. Null (send per client) if the heap cannot hold it.
+    AsyncWebSocketMessageBuffer* buffer = _ws.makeBuffer(len);
+    if (!buffer || !buffer->get()) return nullptr;
+    memcpy(buffer->get(), data, len);
+    buffer->lock();  // Not freed while clients are still being added
+    return buffer;
+}
+
+void WebDashboard::releaseShared(AsyncWebSocketMessageBuffer* buffer) {
+    if (!buffer) return;
+    buffer->unlock();
+    // Frees the buffers whose messages have all gone out, this one once
+    // its last client has sent it
+    _ws._cleanBuffers();
+}
+
+uint16_t WebDashboard::getStreamRate() const {
+    uint16_t hz = 0;
+    portENTER_CRITICAL(&_clientMux);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (_clients[i].active && _clients[i].streamHz > hz) hz = _clients[i].streamHz;
+    }
+    portEXIT_CRITICAL(&_clientMux);
+    return hz;
+}
+
+bool WebDashboard::clientWritable(AsyncWebSocketClient* client, size_t len) const {
+    // AsyncWebSocket only pushes queued messages into TCP when there is
+    // send space, so free space for the whole frame means its queue has
+    // drained. Header overhead for a server frame is at most 4 bytes here.
+    if (client->status() != WS_CONNECTED || client->queueIsFull()) return false;
+    AsyncClient* tcp = client->client();
+    return tcp && tcp->canSend() && tcp->space() >= len + 4;
+}
+
+void WebDashboard::flushClient(uint8_t i) {
+    ClientSlot& slot = _clients[i];
+    AsyncWebSocketClient* client = _ws.client(slot.clientId);
+    if (!client) return;
+
+    // Latest status first: one snapshot of the group's current values
+    if (slot.resyncPending && slot.group >= 0) {
+        SubscriptionGroup& grp = _groups[slot.group];
+        const uint8_t* data;
+        size_t len;
+        if (grp.mask == DASH_FIELDS_ALL) {
+            data = (const uint8_t*)&grp.baseline;
+            len = sizeof(grp.baseline);
+        } else {
+            StatusFrame scratch = grp.baseline;
+            data = _frameBuf;
+            len = DashboardProtocol::encodeDelta(grp.baseline, scratch, grp.mask, true, _frameBuf);
+        }
+        if (!clientWritable(client, len)) return;
+        client->binary((const char*)data, len);
+        slot.resyncPending = false;
+        slot.statusSent++;
+    }
+
+    // Then queued text messages, as far as the connection allows
+    char buf[WS_MSG_MAX_LEN];
+    while (true) {
+        portENTER_CRITICAL(&_clientMux);
+        size_t len = 0;
+        if (slot.msgCount > 0) {
+            len = slot.msgLen[slot.msgHead];
+            memcpy(buf, slot.msgQueue[slot.msgHead], len);
+        }
+        portEXIT_CRITICAL(&_clientMux);
+        if (len == 0 || !clientWritable(client, len)) return;
+
+        client->text(buf, len);
+
+        portENTER_CRITICAL(&_clientMux);
+        slot.msgHead = (slot.msgHead + 1) % WS_MSG_QUEUE_DEPTH;
+        slot.msgCount--;
+        portEXIT_CRITICAL(&_clientMux);
+    }
+}
+
+void WebDashboard::enqueueText(uint8_t i, const char* json, size_t len) {
+    if (len == 0 || len > WS_MSG_MAX_LEN) return;
+    portENTER_CRITICAL(&_clientMux);
+    ClientSlot& slot = _clients[i];
+    if (slot.msgCount == WS_MSG_QUEUE_DEPTH) {
+        // Full: drop the oldest so the newest log line survives
+        slot.msgHead = (slot.msgHead + 1) % WS_MSG_QUEUE_DEPTH;
+        slot.msgCount--;
+        slot.msgDropped++;
+    }
+    uint8_t tail = (slot.msgHead + slot.msgCount) % WS_MSG_QUEUE_DEPTH;
+    memcpy(slot.msgQueue[tail], json, len);
+    slot.msgLen[tail] = len;
+    slot.msgCount++;
+    portEXIT_CRITICAL(&_clientMux);
+}
+
+void WebDashboard::sendText(uint32_t clientId, const char* json, size_t len) {
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (_clients[i].active && _clients[i].clientId == clientId) {
+            enqueueText(i, json, len);
+            return;
+        }
+    }
+}
+
+void WebDashboard::sendStats(uint32_t clientId) {
+    // {"t":"wsstats","heap":N,"clients":[{"id":N,"sent":N,"coal":N,"depth":N,"drop":N},...]}
+    char buf[WS_MSG_MAX_LEN];
+    int len = snprintf(buf, sizeof(buf), "{\"t\":\"wsstats\",\"heap\":%u,\"clients\":[",
+                       (unsigned)ESP.getFreeHeap());
+    bool first = true;
+    for (int i = 0; i < WS_MAX_CLIENTS && len < (int)sizeof(buf); i++) {
+        const ClientSlot& slot = _clients[i];
+        if (!slot.active) continue;
+        len += snprintf(buf + len, sizeof(buf) - len,
+                        "%s{\"id\":%u,\"sent\":%u,\"coal\":%u,\"depth\":%u,\"drop\":%u}",
+                        first ? "" : ",", (unsigned)slot.clientId, (unsigned)slot.statusSent,
+                        (unsigned)slot.statusCoalesced, (unsigned)slot.msgCount,
+                        (unsigned)slot.msgDropped);
+        first = false;
+    }
+    if (len < (int)sizeof(buf)) {
+        len += snprintf(buf + len, sizeof(buf) - len, "]}");
+    }
+    if (len < (int)sizeof(buf)) {
+        sendText(clientId, buf, len);
+    }
+}
+
+void WebDashboard::requestSubscription(uint32_t clientId, uint32_t mask, uint16_t intervalMs) {
+    portENTER_CRITICAL(&_clientMux);
+    int slot = -1;
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (_clients[i].active && _clients[i].clientId == clientId) { slot = i; break; }
+    }
+    if (slot < 0) {
+        for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+            if (!_clients[i].active && !_clients[i].requestPending) { slot = i; break; }
+        }
+    }
+    if (slot >= 0) {
+        if (!_clients[slot].active) {
+            // Fresh slot: clear counters and queue left by a previous client
+            int8_t group = _clients[slot].group;
+            memset(&_clients[slot], 0, sizeof(ClientSlot));
+            _clients[slot].group = group;
+        }
+        _clients[slot].clientId = clientId;
+        _clients[slot].active = true;
+        _clients[slot].requestMask = mask;
+        _clients[slot].requestIntervalMs = intervalMs;
+        _clients[slot].requestPending = true;
+    }
+    portEXIT_CRITICAL(&_clientMux);
+}
+
+void WebDashboard::releaseClient(uint32_t clientId) {
+    portENTER_CRITICAL(&_clientMux);
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (_clients[i].active && _clients[i].clientId == clientId) {
+            _clients[i].active = false;
+            _clients[i].requestPending = true;
+        }
+    }
+    portEXIT_CRITICAL(&_clientMux);
+}
+
+void WebDashboard::applySubscriptions() {
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        portENTER_CRITICAL(&_clientMux);
+        bool pending = _clients[i].requestPending;
+        bool active = _clients[i].active;
+        uint32_t mask = _clients[i].requestMask;
+        uint16_t intervalMs = _clients[i].requestIntervalMs;
+        _clients[i].requestPending = false;
+        portEXIT_CRITICAL(&_clientMux);
+        if (!pending) continue;
+
+        int8_t old = _clients[i].group;
+        if (old >= 0 && _groups[old].members > 0) {
+            _groups[old].members--;
+        }
+        _clients[i].group = active ? joinGroup(mask, intervalMs) : -1;
+    }
+}
+
+int8_t WebDashboard::joinGroup(uint32_t mask, uint16_t intervalMs) {
+    int8_t freeGroup = -1;
+    for (int g = 0; g < WS_MAX_CLIENTS; g++) {
+        SubscriptionGroup& grp = _groups[g];
+        if (grp.members > 0 && grp.mask == mask && grp.intervalMs == intervalMs) {
+            grp.members++;
+            grp.keyframePending = true;  // New member has no baseline yet
+            return g;
+        }
+        if (grp.members == 0 && freeGroup < 0) freeGroup = g;
+    }
+    if (freeGroup < 0) return -1;
+
+    SubscriptionGroup& grp = _groups[freeGroup];
+    grp.mask = mask;
+    grp.intervalMs = intervalMs;
+    grp.members = 1;
+    grp.keyframePending = true;
+    grp.lastSendTime = millis() - intervalMs;  // Due immediately
+    grp.lastKeyframeTime = 0;
+    return freeGroup;
 }
 
 void WebDashboard::sendLog(const char* msg) {
-    JsonDocument doc;
-    doc["t"] = "log";
-    doc["msg"] = msg;
-    char buf[256];
-    size_t len = serializeJson(doc, buf, sizeof(buf));
-    _ws.textAll(buf, len);
+    // {"t":"log","msg":"..."} built by hand with JSON escaping - no heap
+    char buf[WS_MSG_MAX_LEN];
+    size_t len = strlcpy(buf, "{\"t\":\"log\",\"msg\":\"", sizeof(buf));
+    const size_t tailLen = 2;  // "}
+    for (const char* p = msg; *p && len + tailLen + 6 < sizeof(buf); p++) {
+        char c = *p;
+        if (c == '"' || c == '\\') {
+            buf[len++] = '\\';
+            buf[len++] = c;
+        } else if (c == '\n') {
+            buf[len++] = '\\';
+            buf[len++] = 'n';
+        } else if ((uint8_t)c < 0x20) {
+            len += snprintf(buf + len, sizeof(buf) - len, "\\u%04x", c);
+        } else {
+            buf[len++] = c;
+        }
+    }
+    buf[len++] = '"';
+    buf[len++] = '}';
+
+    for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+        if (_clients[i].active) enqueueText(i, buf, len);
+    }
 }
 
 void WebDashboard::cleanupClients() {
@@ -102,14 +426,21 @@ void WebDashboard::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient
         case WS_EVT_CONNECT:
             Serial.printf("[WEB] Client #%u connected from %s\n",
                           client->id(), client->remoteIP().toString().c_str());
+            // Everything at the default rate until the client subscribes
+            requestSubscription(client->id(), DASH_FIELDS_ALL, WEB_STATUS_INTERVAL_MS);
             break;
         case WS_EVT_DISCONNECT:
             Serial.printf("[WEB] Client #%u disconnected\n", client->id());
+            releaseClient(client->id());
             break;
         case WS_EVT_DATA: {
             AwsFrameInfo* info = (AwsFrameInfo*)arg;
-            if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
-                handleMessage(client, data, len);
+            if (info->final && info->index == 0 && info->len == len) {
+                if (info->opcode == WS_TEXT) {
+                    handleMessage(client, data, len, false);
+                } else if (info->opcode == WS_BINARY) {
+                    handleMessage(client, data, len, true);
+                }
             }
             break;
         }
@@ -119,117 +450,127 @@ void WebDashboard::onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient
     }
 }
 
-void WebDashboard::handleMessage(AsyncWebSocketClient* client, uint8_t* data, size_t len) {
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, data, len);
-    if (err) {
-        Serial.printf("[WEB] JSON parse error: %s\n", err.c_str());
+void WebDashboard::handleMessage(AsyncWebSocketClient* client, uint8_t* data, size_t len, bool binary) {
+    DashCommand cmd;
+    if (binary) {
+        if (!DashboardCommands::parseBinary(data, len, cmd)) {
+            Serial.printf("[WEB] Bad binary command (opcode 0x%02X, %u bytes)\n",
+                          len ? data[0] : 0, (unsigned)len);
+            return;
+        }
+    } else if (!DashboardCommands::parseJson((char*)data, len, cmd, DashboardProtocol::fieldBit)) {
+        Serial.println("[WEB] JSON parse error");
         return;
     }
+    executeCommand(client, cmd);
+}
 
-    const char* cmd = doc["cmd"];
-    if (!cmd) return;
-
-    // Motor move: {"cmd":"motor","id":1,"steps":100}
-    if (strcmp(cmd, "motor") == 0 && _motorMoveCb) {
-        int id = doc["id"] | 0;
-        int steps = doc["steps"] | 0;
-        if (id == 1 || id == 2) {
-            _motorMoveCb(id, steps);
-        }
-    }
-    // Both motors: {"cmd":"both","m1":100,"m2":-100}
-    else if (strcmp(cmd, "both") == 0 && _bothMotorsCb) {
-        int s1 = doc["m1"] | 0;
-        int s2 = doc["m2"] | 0;
-        _bothMotorsCb(s1, s2);
-    }
-    // Motor stop: {"cmd":"mstop"}
-    else if (strcmp(cmd, "mstop") == 0 && _motorStopCb) {
-        _motorStopCb();
-    }
-    // Motor speed: {"cmd":"mspeed","value":10}
-    else if (strcmp(cmd, "mspeed") == 0 && _motorSpeedCb) {
-        int rpm = doc["value"] | 10;
-        _motorSpeedCb(rpm);
-    }
-    // Motor continuous: {"cmd":"mcont","id":1}
-    else if (strcmp(cmd, "mcont") == 0 && _motorContCb) {
-        int id = doc["id"] | 0;
-        _motorContCb(id);
-    }
-    // Reset both positions: {"cmd":"mreset"}
-    else if (strcmp(cmd, "mreset") == 0 && _resetPosCb) {
-        _resetPosCb();
-    }
-    // Reset motor 1: {"cmd":"mreset1"}
-    else if (strcmp(cmd, "mreset1") == 0 && _resetPos1Cb) {
-        _resetPos1Cb();
-    }
-    // Reset motor 2: {"cmd":"mreset2"}
-    else if (strcmp(cmd, "mreset2") == 0 && _resetPos2Cb) {
-        _resetPos2Cb();
-    }
-    // Set both positions: {"cmd":"mset","value":0}
-    else if (strcmp(cmd, "mset") == 0 && _setPosCb) {
-        long val = doc["value"] | 0L;
-        _setPosCb(val);
-    }
-    // Unlock motor limits: {"cmd":"munlock"}
-    else if (strcmp(cmd, "munlock") == 0 && _unlockCb) {
-        _unlockCb();
-    }
-    // Lock motor limits: {"cmd":"mlock"}
-    else if (strcmp(cmd, "mlock") == 0 && _lockCb) {
-        _lockCb();
-    }
-    // Calibrate IMU: {"cmd":"calibrate"}
-    else if (strcmp(cmd, "calibrate") == 0 && _calibrateCb) {
-        _calibrateCb();
-    }
-    // I2C scan: {"cmd":"scan"}
-    else if (strcmp(cmd, "scan") == 0 && _scanCb) {
-        _scanCb();
-    }
-    // Stream toggle: {"cmd":"stream"}
-    else if (strcmp(cmd, "stream") == 0 && _streamCb) {
-        _streamCb();
-    }
-    // State change: {"cmd":"state","to":"IDLE"}
-    else if (strcmp(cmd, "state") == 0 && _stateChangeCb) {
-        const char* to = doc["to"];
-        if (to) _stateChangeCb(to);
-    }
-    // Set PI gains: {"cmd":"gains","kpP":1.0,"kiP":0.05,"kpR":0.5,"kiR":0.03}
-    else if (strcmp(cmd, "gains") == 0 && _gainCb) {
-        float kpP = doc["kpP"] | 1.0f;
-        float kiP = doc["kiP"] | 0.05f;
-        float kpR = doc["kpR"] | 0.5f;
-        float kiR = doc["kiR"] | 0.03f;
-        _gainCb(kpP, kiP, kpR, kiR);
-    }
-    // Set tolerance: {"cmd":"tolerance","deg":0.5}
-    else if (strcmp(cmd, "tolerance") == 0 && _toleranceCb) {
-        float deg = doc["deg"] | 0.5f;
-        _toleranceCb(deg);
-    }
-    // Set stability timeout: {"cmd":"stabTimeout","sec":3.0}
-    else if (strcmp(cmd, "stabTimeout") == 0 && _stabTimeoutCb) {
-        float sec = doc["sec"] | 3.0f;
-        _stabTimeoutCb(sec);
-    }
-    // LED control: {"cmd":"led","mode":"red"}
-    else if (strcmp(cmd, "led") == 0 && _ledCb) {
-        const char* mode = doc["mode"];
-        if (mode) _ledCb(mode);
-    }
-    // Release motors: {"cmd":"release"}
-    else if (strcmp(cmd, "release") == 0 && _releaseCb) {
-        _releaseCb();
-    }
-    // Raw serial passthrough: {"cmd":"serial","text":"mpos"}
-    else if (strcmp(cmd, "serial") == 0 && _serialCb) {
-        const char* text = doc["text"];
-        if (text) _serialCb(text);
+void WebDashboard::executeCommand(AsyncWebSocketClient* client, const DashCommand& cmd) {
+    switch (cmd.cmd) {
+        // Status subscription: hz is capped at the control-loop rate;
+        // a mask matching no known field is ignored
+        case DashCmd::SUB: {
+            uint32_t mask = cmd.mask & DASH_FIELDS_ALL;
+            int hz = cmd.arg[0] > 0 ? cmd.arg[0] : 1000 / WEB_STATUS_INTERVAL_MS;
+            hz = constrain(hz, 1, WEB_MAX_STATUS_HZ);
+            if (mask != 0) {
+                requestSubscription(client->id(), mask, 1000 / hz);
+            }
+            break;
+        }
+        // High-rate telemetry stream, hz 0 stops it
+        case DashCmd::HSTREAM: {
+            int hz = constrain(cmd.arg[0], 0, STREAM_MAX_HZ);
+            portENTER_CRITICAL(&_clientMux);
+            for (int i = 0; i < WS_MAX_CLIENTS; i++) {
+                if (_clients[i].active && _clients[i].clientId == client->id()) {
+                    _clients[i].streamHz = hz;
+                }
+            }
+            portEXIT_CRITICAL(&_clientMux);
+            break;
+        }
+        case DashCmd::WSSTATS:
+            sendStats(client->id());
+            break;
+        case DashCmd::MOTOR:
+            if (_motorMoveCb && (cmd.arg[0] == 1 || cmd.arg[0] == 2)) {
+                _motorMoveCb(cmd.arg[0], cmd.arg[1]);
+            }
+            break;
+        case DashCmd::BOTH:
+            if (_bothMotorsCb) _bothMotorsCb(cmd.arg[0], cmd.arg[1]);
+            break;
+        case DashCmd::MSTOP:
+            if (_motorStopCb) _motorStopCb();
+            break;
+        case DashCmd::MSPEED:
+            if (_motorSpeedCb) _motorSpeedCb(cmd.arg[0]);
+            break;
+        case DashCmd::MCONT:
+            if (_motorContCb) _motorContCb(cmd.arg[0]);
+            break;
+        case DashCmd::MRESET:
+            if (_resetPosCb) _resetPosCb();
+            break;
+        case DashCmd::MRESET1:
+            if (_resetPos1Cb) _resetPos1Cb();
+            break;
+        case DashCmd::MRESET2:
+            if (_resetPos2Cb) _resetPos2Cb();
+            break;
+        case DashCmd::MSET:
+            if (_setPosCb) _setPosCb(cmd.arg[0]);
+            break;
+        case DashCmd::MUNLOCK:
+            if (_unlockCb) _unlockCb();
+            break;
+        case DashCmd::MLOCK:
+            if (_lockCb) _lockCb();
+            break;
+        case DashCmd::CALIBRATE:
+            if (_calibrateCb) _calibrateCb();
+            break;
+        case DashCmd::SCAN:
+            if (_scanCb) _scanCb();
+            break;
+        case DashCmd::STREAM:
+            if (_streamCb) _streamCb();
+            break;
+        case DashCmd::STATE:
+            if (_stateChangeCb && cmd.text) _stateChangeCb(cmd.text);
+            break;
+        case DashCmd::GAINS:
+            if (_gainCb) _gainCb(cmd.value[0], cmd.value[1], cmd.value[2], cmd.value[3]);
+            break;
+        case DashCmd::TOLERANCE:
+            if (_toleranceCb) _toleranceCb(cmd.value[0]);
+            break;
+        case DashCmd::STAB_TIMEOUT:
+            if (_stabTimeoutCb) _stabTimeoutCb(cmd.value[0]);
+            break;
+        case DashCmd::LED:
+            if (_ledCb && cmd.text) _ledCb(cmd.text);
+            break;
+        case DashCmd::RELEASE:
+            if (_releaseCb) _releaseCb();
+            break;
+        case DashCmd::SERIAL_TEXT:
+            if (_serialCb && cmd.text) _serialCb(cmd.text);
+            break;
+        case DashCmd::PERF:
+            if (_perfCb) _perfCb(client->id(), cmd.arg[0] != 0);
+            break;
+        case DashCmd::TIMING:
+            if (_timingCb) _timingCb(client->id(), cmd.arg[0] != 0);
+            break;
+        case DashCmd::SCHEDULE:
+            if (_scheduleCb) _scheduleCb(client->id(), cmd.arg[0], cmd.value, cmd.value + DASH_SCHEDULE_POINTS);
+            break;
+        case DashCmd::TUNE:
+            if (_tuneCb && cmd.text) _tuneCb(client->id(), cmd.text);
+            break;
+        case DashCmd::NONE:
+            break;
     }
 }
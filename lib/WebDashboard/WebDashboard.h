@@ -5,9 +5,9 @@
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
-#include <LittleFS.h>
-#include <ArduinoJson.h>
 #include "config.h"
+#include "DashboardProtocol.h"
+#include "DashboardCommands.h"
 
 class WebDashboard {
 public:
@@ -15,25 +15,37 @@ public:
 
     bool begin();
 
-    void broadcastStatus(
-        float pitch, float roll,
-        float accelX, float accelY, float accelZ,
-        float gyroX, float gyroY, float gyroZ,
-        float temperature,
-        long m1pos, long m2pos,
-        long minPos, long maxPos,
-        bool m1limit, bool m2limit,
-        const char* state,
-        bool isCalibrated, bool isLevel,
-        float tolerance,
-        unsigned long stabilityTimeoutMs,
-        float kpPitch, float kiPitch, float kpRoll, float kiRoll,
-        unsigned long uptime
-    );
-
-    // Send a log message to the serial terminal tab on all clients
+    /**
+     * Apply pending subscription changes and flush per-client outbound
+     * queues to clients whose connection can take more data.
+     * Call from loop() at the control-loop rate.
+     */
+    void update();
+
+    /**
+     * Check whether any client's status schedule is due. Only build a
+     * DashboardStatus and call broadcastStatus() when this returns true.
+     */
+    bool statusDue(unsigned long now) const;
+
+    // Send status to every subscription group that is due. Each distinct
+    // subscription is encoded once and the frame shared by its clients.
+    void broadcastStatus(const DashboardStatus& status);
+
+    // Send a telemetry batch to clients that enabled the high-rate stream.
+    // Batches are never queued: a client that cannot take one skips it and
+    // sees the gap in the sequence numbers.
+    void sendStream(const uint8_t* batch, size_t len);
+
+    // Highest stream rate requested by a connected client, 0 if none
+    uint16_t getStreamRate() const;
+
+    // Queue a log message for the serial terminal tab on all clients
     void sendLog(const char* msg);
 
+    // Queue a pre-built JSON text message for one client
+    void sendText(uint32_t clientId, const char* json, size_t len);
+
     void cleanupClients();
     uint8_t getClientCount() const;
 
@@ -50,6 +62,9 @@ public:
     using LedCallback = std::function<void(const char* mode)>;
     using MotorToggleCallback = std::function<void(int motor)>;
     using LimitsCallback = std::function<void(long min, long max)>;
+    using ReportCallback = std::function<void(uint32_t clientId, bool reset)>;
+    using ScheduleCallback = std::function<void(uint32_t clientId, int table, const float* keys, const float* scales)>;
+    using TuneCallback = std::function<void(uint32_t clientId, const char* rule)>;
 
     void onMotorMove(MotorMoveCallback cb)       { _motorMoveCb = cb; }
     void onBothMotors(BothMotorsCallback cb)     { _bothMotorsCb = cb; }
@@ -72,11 +87,57 @@ public:
     void onSerial(StringCallback cb)             { _serialCb = cb; }
     void onUnlockLimits(VoidCallback cb)         { _unlockCb = cb; }
     void onLockLimits(VoidCallback cb)           { _lockCb = cb; }
+    void onPerf(ReportCallback cb)               { _perfCb = cb; }
+    void onTiming(ReportCallback cb)             { _timingCb = cb; }
+    void onSchedule(ScheduleCallback cb)         { _scheduleCb = cb; }
+    void onTune(TuneCallback cb)                 { _tuneCb = cb; }
 
 private:
     AsyncWebServer _server;
     AsyncWebSocket _ws;
 
+    // Per-client subscription slot. Written by WebSocket events on the
+    // async_tcp task (under _clientMux); group is only touched by loop().
+    struct ClientSlot {
+        uint32_t clientId;
+        bool active;
+        bool requestPending;       // Subscription change not yet applied
+        uint32_t requestMask;      // Requested STATUS_FIELDS mask
+        uint16_t requestIntervalMs;
+        int8_t group;              // Index into _groups, -1 if none
+        uint16_t streamHz;         // High-rate stream request, 0 = off
+
+        // Outbound state. Status is never queued: if the client cannot take
+        // a frame it is skipped and one snapshot of the latest values is sent
+        // once it drains. Text messages (logs, command responses) go through
+        // a small ring that drops the oldest entry when full.
+        bool resyncPending;
+        uint32_t statusSent;
+        uint32_t statusCoalesced;  // Status frames replaced by a newer value
+        uint32_t msgDropped;
+        uint8_t msgHead;
+        uint8_t msgCount;
+        uint16_t msgLen[WS_MSG_QUEUE_DEPTH];
+        char msgQueue[WS_MSG_QUEUE_DEPTH][WS_MSG_MAX_LEN];
+    };
+
+    // Clients with the same field mask and rate share one group, which
+    // owns the delta baseline and the send schedule
+    struct SubscriptionGroup {
+        uint32_t mask;
+        uint16_t intervalMs;
+        uint8_t members;
+        bool keyframePending;
+        unsigned long lastSendTime;
+        unsigned long lastKeyframeTime;
+        StatusFrame baseline;      // Last values sent to this group
+    };
+
+    ClientSlot _clients[WS_MAX_CLIENTS];
+    SubscriptionGroup _groups[WS_MAX_CLIENTS];
+    mutable portMUX_TYPE _clientMux;
+    uint8_t _frameBuf[DASH_DELTA_MAX_SIZE];
+
     MotorMoveCallback _motorMoveCb;
     BothMotorsCallback _bothMotorsCb;
     VoidCallback _calibrateCb;
@@ -98,10 +159,28 @@ private:
     StringCallback _serialCb;
     VoidCallback _unlockCb;
     VoidCallback _lockCb;
+    ReportCallback _perfCb;
+    ReportCallback _timingCb;
+    ScheduleCallback _scheduleCb;
+    TuneCallback _tuneCb;
 
     void onWebSocketEvent(AsyncWebSocket* server, AsyncWebSocketClient* client,
                           AwsEventType type, void* arg, uint8_t* data, size_t len);
-    void handleMessage(AsyncWebSocketClient* client, uint8_t* data, size_t len);
+    // Decode a JSON or binary command frame (see DashboardCommands.h)
+    void handleMessage(AsyncWebSocketClient* client, uint8_t* data, size_t len, bool binary);
+    void executeCommand(AsyncWebSocketClient* client, const DashCommand& cmd);
+
+    void requestSubscription(uint32_t clientId, uint32_t mask, uint16_t intervalMs);
+    void releaseClient(uint32_t clientId);
+    void applySubscriptions();
+    int8_t joinGroup(uint32_t mask, uint16_t intervalMs);
+    void sendGroup(uint8_t g, const StatusFrame& frame, unsigned long now);
+    void flushClient(uint8_t i);
+    AsyncWebSocketMessageBuffer* makeShared(const uint8_t* data, size_t len);
+    void releaseShared(AsyncWebSocketMessageBuffer* buffer);
+    bool clientWritable(AsyncWebSocketClient* client, size_t len) const;
+    void enqueueText(uint8_t i, const char* json, size_t len);
+    void sendStats(uint32_t clientId);
 };
 
 #endif
@@ -0,0 +1,155 @@
+"""
+Self-Leveling Platform - Embed the web dashboard in the firmware image
+
+PlatformIO pre-build script (extra_scripts in platformio.ini). Minifies
+and gzips data/index.html, app.js and style.css and writes them as PROGMEM
+arrays to <build dir>/generated/web_assets.h, which WebDashboard serves
+straight from flash (no filesystem, no uploadfs step).
+
+Each asset gets a content hash used as its strong ETag. app.js and
+style.css are renamed to app.<hash>.js / style.<hash>.css in index.html,
+so they can be cached as immutable; index.html itself is revalidated.
+
+Standalone: python scripts/embed_assets.py [output dir]
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+ASSETS = [
+    # (file, content type)
+    ("style.css", "text/css"),
+    ("app.js", "application/javascript"),
+    ("index.html", "text/html"),
+]
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = " ".join(line.strip() for line in text.splitlines() if line.strip())
+    return re.sub(r"\s*([{};,>])\s*", r"\1", text)
+
+
+def minify_js(text):
+    # Line-based only: whole-line comments and indentation go, line breaks
+    # stay so automatic semicolon insertion is unaffected
+    lines = []
+    for line in text.splitlines():
+        line = line.strip()
+        if line and not line.startswith("//"):
+            lines.append(line)
+    return "\n".join(lines)
+
+
+def minify_html(text):
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    return "\n".join(line.strip() for line in text.splitlines() if line.strip())
+
+
+MINIFIERS = {".css": minify_css, ".js": minify_js, ".html": minify_html}
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:8]
+
+
+def c_array(name, data):
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+    return f"static const uint8_t {name}[] PROGMEM = {{\n" + "\n".join(rows) + "\n};\n"
+
+
+def build_header(data_dir):
+    renames = {}
+    arrays = []
+    entries = []
+    total_raw = total_gz = 0
+
+    for filename, content_type in ASSETS:
+        with open(os.path.join(data_dir, filename), encoding="utf-8") as f:
+            text = f.read()
+        total_raw += len(text.encode("utf-8"))
+
+        base, ext = os.path.splitext(filename)
+        if ext == ".html":
+            for old, new in renames.items():
+                text = re.sub(r'(src|href)="%s"' % re.escape(old), r'\1="%s"' % new, text)
+        body = MINIFIERS[ext](text).encode("utf-8")
+        digest = content_hash(body)
+        # mtime=0 keeps the output identical between builds
+        packed = gzip.compress(body, compresslevel=9, mtime=0)
+        total_gz += len(packed)
+
+        symbol = "WEB_ASSET_" + re.sub(r"\W", "_", filename).upper()
+        arrays.append(c_array(symbol, packed))
+        etag = f'\\"{digest}\\"'
+
+        if ext == ".html":
+            paths = [("/" + filename, False), ("/", False)]
+        else:
+            hashed = f"{base}.{digest}{ext}"
+            renames[filename] = hashed
+            paths = [("/" + hashed, True)]
+        for path, immutable in paths:
+            entries.append(f'    {{"{path}", "{content_type}", "{etag}", '
+                           f'{"true" if immutable else "false"}, {symbol}, sizeof({symbol})}},')
+
+    header = [
+        "// Generated by scripts/embed_assets.py from data/ - do not edit",
+        f"// {total_raw} bytes of source, {total_gz} bytes embedded",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        '#include "WebAsset.h"',
+        "",
+    ]
+    header += arrays
+    header += [
+        "static const WebAsset WEB_ASSETS[] = {",
+        *entries,
+        "};",
+        "",
+        "#define WEB_ASSET_COUNT (sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]))",
+        "",
+        "#endif // WEB_ASSETS_H",
+        "",
+    ]
+    return "\n".join(header), total_raw, total_gz
+
+
+def write_if_changed(path, text):
+    """Leave the file (and its timestamp) alone when nothing changed."""
+    if os.path.exists(path):
+        with open(path, encoding="utf-8") as f:
+            if f.read() == text:
+                return False
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(text)
+    return True
+
+
+def generate(project_dir, out_dir):
+    text, raw, packed = build_header(os.path.join(project_dir, "data"))
+    path = os.path.join(out_dir, "web_assets.h")
+    changed = write_if_changed(path, text)
+    print(f"Web assets: {raw} -> {packed} bytes{'' if changed else ' (unchanged)'}")
+    return out_dir
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+except NameError:
+    env = None
+
+if env is not None:
+    out = os.path.join(env.subst("$BUILD_DIR"), "generated")
+    generate(env.subst("$PROJECT_DIR"), out)
+    env.Append(CPPPATH=[out])
+elif __name__ == "__main__":
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    generate(root, sys.argv[1] if len(sys.argv) > 1 else os.path.join(root, ".pio", "generated"))
@@ -19,10 +19,22 @@
 #include "types.h"
 #include "MPU6050Handler.h"
 #include "StepperController.h"
+#include "MotionPlanner.h"
 #include "LevelingController.h"
+#include "PredictiveController.h"
 #include "ButtonHandler.h"
 #include "StatusLED.h"
 #include "WebDashboard.h"
+#include "TelemetryStream.h"
+#include "SerialLink.h"
+#include "SerialConsole.h"
+#include "DeferredLog.h"
+#include "LoopProfiler.h"
+#include "ControlTiming.h"
+#include "StallDetector.h"
+#include "RelayTuner.h"
+#include "AttitudePredictor.h"
+#include "SettleDetector.h"
 
 // ============================================================================
 // Global Objects
@@ -30,11 +42,26 @@
 
 MPU6050Handler imu;
 StepperController motors;
+MotionPlanner planner(motors);
 LevelingController leveling;
+PredictiveController mpc;
+AttitudePredictor predictor;
+SettleDetector settle;
 ButtonHandler button(PIN_BUTTON, true);  // Active low with pull-up
 StatusLED statusLED(PIN_LED_RED, PIN_LED_GREEN, PIN_LED_BLUE);  // RGB LED in push button
 Preferences prefs;
 WebDashboard dashboard;
+TelemetryStream telemetry;
+SerialLink serialLink;
+DeferredLog deferredLog;
+#if LOOP_PROFILER_ENABLED
+LoopProfiler loopProfiler;
+#endif
+IntervalMonitor imuTiming("imu", IMU_DEADLINE_US);
+IntervalMonitor controlTiming("ctrl", CONTROL_DEADLINE_US);
+StallDetector stallDetector;
+StepRateTuner stepRates;
+RelayTuner relayTuner;
 
 // ============================================================================
 // State Machine
@@ -69,6 +96,7 @@ int testModeLEDCycleIndex = 0;
 // ============================================================================
 
 void changeState(SystemState newState);
+bool levelingOwnsMotors();
 void handleIdleState();
 void handleInitializingState();
 void handleWaitForStableState();
@@ -76,22 +104,55 @@ void handleLevelingState();
 void handleLevelOkState();
 void handleErrorState();
 void handleTestModeState();
-void handleSerialCommands();
-void handleTestModeCommands(String& input);
+void handleSerialCommands(char* line);
+void handleLinkRequest(uint8_t type, uint8_t reqId, const uint8_t* body, size_t len);
+void handleTestModeCommands(const CommandArgs& args);
 void printHelp();
 void printStatus();
 void printIMUData();
 void printTestModeMenu();
 void scanI2CBus();
 void printPinInfo();
+void handleStreamCommand(const CommandArgs& args);
+void handlePerfCommand(const CommandArgs& args);
+void sendPerfStats(uint32_t clientId, bool reset);
+void handleTimingCommand(const CommandArgs& args);
+void sendTimingStats(uint32_t clientId, bool reset);
+void updateIMU();
+const char* applyLedMode(const char* name);
+void setSerialStream(uint16_t hz);
+void updateIMURate();
+void serviceTelemetry();
 void saveMotorPositions();
 void loadMotorPositions();
+void requestStateChange(SystemState state);
+void requestScheduleTable(uint32_t clientId, int table, const float* keys, const float* scales);
+void serviceDashboardRequests();
+void checkStall(float pitch, float roll);
+void loadStepRates();
+void handleStallCommand(const CommandArgs& args);
+void loadBacklash();
+void handleBacklashCommand(const CommandArgs& args);
+void loadSchedule();
+void sendSchedule(uint32_t clientId, bool ok);
+void setScheduleTable(uint32_t clientId, int table, const float* keys, const float* scales);
+void handleScheduleCommand(const CommandArgs& args);
+void saveGains();
+void loadGains();
+void requestSaveGains();
+void startAutoTune(TuneRule rule, bool fromDashboard, uint32_t clientId);
+void stopAutoTune();
+void requestAutoTune(TuneRule rule, uint32_t clientId);
+void requestStopAutoTune();
+void serviceAutoTune(unsigned long now);
+void handleTuneCommand(const CommandArgs& args);
 
 // ============================================================================
 // Motor Position Persistence
 // ============================================================================
 
 void saveMotorPositions() {
+    TIMING_SITE("nvs save");
     prefs.begin("motors", false);  // read-write
     prefs.putLong("m1pos", motors.getPosition1());
     prefs.putLong("m2pos", motors.getPosition2());
@@ -115,7 +176,12 @@ void loadMotorPositions() {
 // ============================================================================
 
 void setup() {
+    Serial.setTxBufferSize(SERIAL_TX_BUFFER_SIZE);
     Serial.begin(SERIAL_BAUD_RATE);
+    deferredLog.begin(Serial);
+    serialLink.begin(Serial);
+    serialLink.onLine(handleSerialCommands);
+    serialLink.onRequest(handleLinkRequest);
     delay(1000);  // Wait for serial monitor
 
     Serial.println();
@@ -132,12 +198,19 @@ void setup() {
     config.levelTolerance = LEVEL_TOLERANCE_DEG;
     config.continuousLogging = false;
     config.stabilityTimeoutMs = STABILITY_TIMEOUT_MS;
+    config.predictive = DEFAULT_CONTROLLER_MPC;
+    config.attitudePredictor = DEFAULT_ATTITUDE_PREDICTOR;
+    config.settleGate = DEFAULT_SETTLE_GATE;
+    loadGains();
 
     // Initialize components
     button.begin();
     statusLED.begin();
     motors.begin();
     loadMotorPositions();
+    loadStepRates();
+    loadBacklash();
+    loadSchedule();
 
     // Start in IDLE state
     changeState(SystemState::IDLE);
@@ -145,11 +218,17 @@ void setup() {
     // Initialize web dashboard
     dashboard.begin();
     dashboard.onMotorMove([](int motor, int steps) {
-        if (motor == 1) motors.moveMotor1(steps);
-        else if (motor == 2) motors.moveMotor2(steps);
+        if (levelingOwnsMotors()) return;
+        if (motor == 1) planner.queueMove(steps, 0);
+        else if (motor == 2) planner.queueMove(0, steps);
     });
     dashboard.onBothMotors([](int s1, int s2) {
-        motors.moveBoth(s1, s2);
+        if (levelingOwnsMotors()) return;
+        planner.queueMove(s1, s2);
+    });
+    dashboard.onMotorContinuous([](int motor) {
+        if (motor == 1) testModeMotor1Continuous = !testModeMotor1Continuous;
+        else if (motor == 2) testModeMotor2Continuous = !testModeMotor2Continuous;
     });
     dashboard.onCalibrate([]() {
         if (imu.begin()) imu.calibrate();
@@ -169,15 +248,17 @@ void setup() {
         saveMotorPositions();
     });
     dashboard.onStateChange([](const char* state) {
-        if (strcmp(state, "IDLE") == 0) changeState(SystemState::IDLE);
-        else if (strcmp(state, "INITIALIZING") == 0) changeState(SystemState::INITIALIZING);
-        else if (strcmp(state, "TEST_MODE") == 0) changeState(SystemState::TEST_MODE);
+        // Changed (and logged) from loop()
+        if (strcmp(state, "IDLE") == 0) requestStateChange(SystemState::IDLE);
+        else if (strcmp(state, "INITIALIZING") == 0) requestStateChange(SystemState::INITIALIZING);
+        else if (strcmp(state, "TEST_MODE") == 0) requestStateChange(SystemState::TEST_MODE);
     });
     dashboard.onSetGains([](float kpP, float kiP, float kpR, float kiR) {
         config.kpPitch = kpP; config.kiPitch = kiP;
         config.kpRoll = kpR; config.kiRoll = kiR;
         leveling.setPitchGains(kpP, kiP);
         leveling.setRollGains(kpR, kiR);
+        requestSaveGains();  // NVS is written from loop()
     });
     dashboard.onSetTolerance([](float tol) {
         if (tol > 0 && tol < 10) config.levelTolerance = tol;
@@ -192,25 +273,17 @@ void setup() {
     });
     dashboard.onMotorStop([]() {
         // Stop continuous rotation flags and release
+        testModeMotor1Continuous = false;
+        testModeMotor2Continuous = false;
+        requestStopAutoTune();
+        planner.stop();
         motors.release();
     });
     dashboard.onMotorSpeed([](int rpm) {
         if (rpm >= 1 && rpm <= 15) motors.setSpeed(rpm);
     });
     dashboard.onLed([](const char* mode) {
-        if (strcmp(mode, "on") == 0) { statusLED.setPattern(LEDPattern::SOLID); }
-        else if (strcmp(mode, "off") == 0) { statusLED.setPattern(LEDPattern::OFF); }
-        else if (strcmp(mode, "slow") == 0) { statusLED.setPattern(LEDPattern::SLOW_BLINK); }
-        else if (strcmp(mode, "fast") == 0) { statusLED.setPattern(LEDPattern::FAST_BLINK); }
-        else if (strcmp(mode, "pulse") == 0) { statusLED.setPattern(LEDPattern::DOUBLE_PULSE); }
-        else if (strcmp(mode, "error") == 0) { statusLED.setPattern(LEDPattern::ERROR_BLINK); }
-        else if (strcmp(mode, "red") == 0) { statusLED.setColor(LEDColors::RED); statusLED.setPattern(LEDPattern::SOLID); }
-        else if (strcmp(mode, "green") == 0) { statusLED.setColor(LEDColors::GREEN); statusLED.setPattern(LEDPattern::SOLID); }
-        else if (strcmp(mode, "blue") == 0) { statusLED.setColor(LEDColors::BLUE); statusLED.setPattern(LEDPattern::SOLID); }
-        else if (strcmp(mode, "yellow") == 0) { statusLED.setColor(LEDColors::YELLOW); statusLED.setPattern(LEDPattern::SOLID); }
-        else if (strcmp(mode, "cyan") == 0) { statusLED.setColor(LEDColors::CYAN); statusLED.setPattern(LEDPattern::SOLID); }
-        else if (strcmp(mode, "purple") == 0) { statusLED.setColor(LEDColors::PURPLE); statusLED.setPattern(LEDPattern::SOLID); }
-        else if (strcmp(mode, "white") == 0) { statusLED.setColor(LEDColors::WHITE); statusLED.setPattern(LEDPattern::SOLID); }
+        applyLedMode(mode);
     });
     dashboard.onUnlockLimits([]() {
         motors.setLimits(-99999, 99999);
@@ -218,6 +291,27 @@ void setup() {
     dashboard.onLockLimits([]() {
         motors.setLimits(MOTOR_MIN_POSITION, MOTOR_MAX_POSITION);
     });
+    dashboard.onPerf([](uint32_t clientId, bool reset) {
+        sendPerfStats(clientId, reset);
+    });
+    dashboard.onTiming([](uint32_t clientId, bool reset) {
+        sendTimingStats(clientId, reset);
+    });
+    dashboard.onSchedule([](uint32_t clientId, int table, const float* keys, const float* scales) {
+        requestScheduleTable(clientId, table, keys, scales);  // Applied in loop()
+    });
+    dashboard.onTune([](uint32_t clientId, const char* rule) {
+        TuneRule r;
+        if (strcmp(rule, "stop") == 0) {
+            requestStopAutoTune();
+        } else if (currentState != SystemState::TEST_MODE) {
+            dashboard.sendLog("[TUNE] Auto-tune runs in test mode only");
+        } else if (!RelayTuner::parseRule(rule, r)) {
+            dashboard.sendLog("[TUNE] Unknown rule (zn, tl, simc)");
+        } else {
+            requestAutoTune(r, clientId);  // Started by serviceAutoTune() in loop()
+        }
+    });
 
     Serial.println("System ready. Press button to start leveling.");
     Serial.println("Type 'h' for serial command help.");
@@ -229,14 +323,38 @@ void setup() {
 // ============================================================================
 
 void loop() {
+    PROFILE_STAGE(STAGE_LOOP);
     unsigned long currentTime = millis();
 
     // Always update button and LED
-    ButtonEvent buttonEvent = button.update();
-    statusLED.update();
+    ButtonEvent buttonEvent;
+    {
+        PROFILE_STAGE(STAGE_BUTTON);
+        buttonEvent = button.update();
+    }
+    {
+        PROFILE_STAGE(STAGE_LED);
+        statusLED.update();
+    }
+
+    // Handle serial commands and binary requests
+    {
+        PROFILE_STAGE(STAGE_SERIAL);
+        serialLink.poll();
+    }
 
-    // Handle serial commands
-    handleSerialCommands();
+    // Work posted by dashboard callbacks (async_tcp task)
+    serviceDashboardRequests();
+
+    // Queued moves step in the background of every state but leveling,
+    // whose corrections own the motors (a dashboard move can still be
+    // queued while leveling starts; drop it)
+    {
+        PROFILE_STAGE(STAGE_MOTION);
+        if (levelingOwnsMotors()) planner.stop();
+        else planner.run();
+        motors.update();
+    }
 
     // Handle button events globally
     if (buttonEvent == ButtonEvent::LONG_PRESS) {
@@ -248,48 +366,51 @@ void loop() {
     }
 
     // State-specific handling
-    switch (currentState) {
-        case SystemState::IDLE:
-            handleIdleState();
-            if (buttonEvent == ButtonEvent::SHORT_PRESS) {
-                changeState(SystemState::INITIALIZING);
-            }
-            break;
+    {
+        PROFILE_STAGE(STAGE_STATE);
+        switch (currentState) {
+            case SystemState::IDLE:
+                handleIdleState();
+                if (buttonEvent == ButtonEvent::SHORT_PRESS) {
+                    changeState(SystemState::INITIALIZING);
+                }
+                break;
 
-        case SystemState::INITIALIZING:
-            handleInitializingState();
-            break;
+            case SystemState::INITIALIZING:
+                handleInitializingState();
+                break;
 
-        case SystemState::WAIT_FOR_STABLE:
-            handleWaitForStableState();
-            break;
+            case SystemState::WAIT_FOR_STABLE:
+                handleWaitForStableState();
+                break;
 
-        case SystemState::LEVELING:
-            handleLevelingState();
-            break;
+            case SystemState::LEVELING:
+                handleLevelingState();
+                break;
 
-        case SystemState::LEVEL_OK:
-            handleLevelOkState();
-            break;
+            case SystemState::LEVEL_OK:
+                handleLevelOkState();
+                break;
 
-        case SystemState::ERROR:
-            handleErrorState();
-            if (buttonEvent == ButtonEvent::SHORT_PRESS) {
-                changeState(SystemState::INITIALIZING);
-            }
-            break;
+            case SystemState::ERROR:
+                handleErrorState();
+                if (buttonEvent == ButtonEvent::SHORT_PRESS) {
+                    changeState(SystemState::INITIALIZING);
+                }
+                break;
 
-        case SystemState::TEST_MODE:
-            handleTestModeState();
-            break;
+            case SystemState::TEST_MODE:
+                handleTestModeState();
+                break;
 
-        case SystemState::SAFE_SHUTDOWN:
-            // Halted — short press wakes back to IDLE
-            if (buttonEvent == ButtonEvent::SHORT_PRESS) {
-                Serial.println("Short press detected - waking from shutdown");
-                changeState(SystemState::IDLE);
-            }
-            break;
+            case SystemState::SAFE_SHUTDOWN:
+                // Halted — short press wakes back to IDLE
+                if (buttonEvent == ButtonEvent::SHORT_PRESS) {
+                    Serial.println("Short press detected - waking from shutdown");
+                    changeState(SystemState::IDLE);
+                }
+                break;
+        }
     }
 
     // Continuous logging if enabled
@@ -297,40 +418,71 @@ void loop() {
         static unsigned long lastLogTime = 0;
         if (currentTime - lastLogTime >= 100) {  // 10 Hz logging
             lastLogTime = currentTime;
-            Serial.printf("P:%.2f R:%.2f M:%d M1:%ld M2:%ld\n",
-                          imu.getPitch(), imu.getRoll(), imu.isMoving() ? 1 : 0,
-                          motors.getPosition1(), motors.getPosition2());
+            LOG(LOG_CONTINUOUS, imu.getPitch(), imu.getRoll(), imu.isMoving() ? 1 : 0,
+                motors.getPosition1(), motors.getPosition2());
+        }
+    }
+
+    // High-rate telemetry: dashboard clients request a rate, serial uses hstream
+    static uint16_t lastWebStreamHz = 0;
+    uint16_t webStreamHz = dashboard.getStreamRate();
+    if (webStreamHz != lastWebStreamHz) {
+        lastWebStreamHz = webStreamHz;
+        if (webStreamHz > 0) {
+            telemetry.start(STREAM_SINK_WEB, webStreamHz);
+        } else {
+            telemetry.stop(STREAM_SINK_WEB);
         }
+        updateIMURate();
+    }
+    if (telemetry.isActive()) {
+        PROFILE_STAGE(STAGE_TELEMETRY);
+        serviceTelemetry();
     }
 
-    // Web dashboard: broadcast status at 10 Hz
-    static unsigned long lastWsBroadcast = 0;
-    if (currentTime - lastWsBroadcast >= WEB_STATUS_INTERVAL_MS) {
-        lastWsBroadcast = currentTime;
-        if (dashboard.getClientCount() > 0) {
+    // Web dashboard: flush per-client queues and run status schedules at the control-loop rate
+    static unsigned long lastWsCheck = 0;
+    if (currentTime - lastWsCheck >= IMU_UPDATE_INTERVAL_MS) {
+        PROFILE_STAGE(STAGE_BROADCAST);
+        lastWsCheck = currentTime;
+        dashboard.update();
+        if (dashboard.statusDue(currentTime)) {
             const IMUData& d = imu.getData();
-            dashboard.broadcastStatus(
-                imu.getPitch(), imu.getRoll(),
-                d.accelX, d.accelY, d.accelZ,
-                d.gyroX, d.gyroY, d.gyroZ,
-                d.temperature,
-                motors.getPosition1(), motors.getPosition2(),
-                motors.getMinPosition(), motors.getMaxPosition(),
-                motors.isAtLimit1(), motors.isAtLimit2(),
-                stateToString(currentState),
-                imu.getCalibration().isCalibrated,
-                imu.isLevel(config.levelTolerance),
-                config.levelTolerance,
-                config.stabilityTimeoutMs,
-                config.kpPitch, config.kiPitch, config.kpRoll, config.kiRoll,
-                millis()
-            );
+            DashboardStatus status;
+            status.pitch = imu.getPitch();
+            status.roll = imu.getRoll();
+            status.accelX = d.accelX;
+            status.accelY = d.accelY;
+            status.accelZ = d.accelZ;
+            status.gyroX = d.gyroX;
+            status.gyroY = d.gyroY;
+            status.gyroZ = d.gyroZ;
+            status.temperature = d.temperature;
+            status.m1pos = motors.getPosition1();
+            status.m2pos = motors.getPosition2();
+            status.minPos = motors.getMinPosition();
+            status.maxPos = motors.getMaxPosition();
+            status.m1limit = motors.isAtLimit1();
+            status.m2limit = motors.isAtLimit2();
+            status.state = currentState;
+            status.isCalibrated = imu.getCalibration().isCalibrated;
+            status.isLevel = imu.isLevel(config.levelTolerance);
+            status.tolerance = config.levelTolerance;
+            status.stabilityTimeoutMs = config.stabilityTimeoutMs;
+            status.kpPitch = config.kpPitch;
+            status.kiPitch = config.kiPitch;
+            status.kpRoll = config.kpRoll;
+            status.kiRoll = config.kiRoll;
+            status.uptime = millis();
+            status.settleMs = settle.getSettleMs();
+            dashboard.broadcastStatus(status);
         }
     }
 
     // WebSocket client cleanup every 2 seconds
     static unsigned long lastWsCleanup = 0;
     if (currentTime - lastWsCleanup >= 2000) {
+        PROFILE_STAGE(STAGE_CLEANUP);
         lastWsCleanup = currentTime;
         dashboard.cleanupClients();
     }
@@ -340,20 +492,41 @@ void loop() {
 // State Change Handler
 // ============================================================================
 
+// Leveling moves the legs itself; a manual move would interleave with
+// corrections, and the controller would never see its steps
+bool levelingOwnsMotors() {
+    return currentState == SystemState::WAIT_FOR_STABLE ||
+           currentState == SystemState::LEVELING ||
+           currentState == SystemState::LEVEL_OK;
+}
+
 void changeState(SystemState newState) {
     if (newState == currentState) return;
 
-    Serial.printf("State: %s -> %s\n", stateToString(currentState), stateToString(newState));
+    LOG(LOG_STATE_CHANGE, currentState, newState);
 
     currentState = newState;
     stateEnteredTime = millis();
 
+    // Queued moves do not carry over into another state
+    planner.stop();
+
+    // A stall window only survives into LEVEL_OK, where it is judged
+    if (newState != SystemState::LEVEL_OK) stallDetector.cancel();
+
+    // The relay experiment drives the motors from test mode only
+    if (newState != SystemState::TEST_MODE) stopAutoTune();
+
+    // The periodic jobs pause across state changes; that is not jitter
+    imuTiming.restart();
+    controlTiming.restart();
+
     // Set LED color + pattern for new state
     switch (newState) {
         case SystemState::IDLE:
             statusLED.setColor(LEDColors::OFF);
             statusLED.setPattern(LEDPattern::OFF);
-            motors.release();
+            motors.hold();
             saveMotorPositions();
             break;
 
@@ -372,13 +545,16 @@ void changeState(SystemState newState) {
             statusLED.setColor(LEDColors::CYAN);
             statusLED.setPattern(LEDPattern::FAST_BLINK);
             leveling.reset();  // Reset PI integrators
+            mpc.reset();       // and the predictive plan
+            predictor.reset(imu.getPitch(), imu.getRoll());  // Settled (WAIT_FOR_STABLE / LEVEL_OK)
+            settle.reset();
             withinTolerance = false;  // Reset level confirmation
             break;
 
         case SystemState::LEVEL_OK:
             statusLED.setColor(LEDColors::GREEN);
             statusLED.setPattern(LEDPattern::DOUBLE_PULSE);
-            motors.release();  // Save power when level
+            motors.hold();  // Reduced current when level; released after HOLD_TIMEOUT_MS
             saveMotorPositions();
             break;
 
@@ -420,6 +596,7 @@ void handleIdleState() {
 }
 
 void handleInitializingState() {
+    TIMING_SITE("imu init");
     Serial.println("Initializing IMU...");
 
     if (!imu.begin()) {
@@ -445,7 +622,8 @@ void handleWaitForStableState() {
     // Update IMU at regular intervals
     if (currentTime - lastIMUUpdateTime >= IMU_UPDATE_INTERVAL_MS) {
         lastIMUUpdateTime = currentTime;
-        imu.update();
+        imuTiming.tick(micros());
+        updateIMU();
 
         // Check for motion
         if (imu.isMoving()) {
@@ -455,7 +633,7 @@ void handleWaitForStableState() {
 
     // Check if stable long enough
     if (currentTime - lastStableTime >= config.stabilityTimeoutMs) {
-        Serial.println("Platform stable. Starting leveling...");
+        LOG(LOG_STABLE);
         changeState(SystemState::LEVELING);
     }
 }
@@ -464,35 +642,56 @@ void handleLevelingState() {
     unsigned long currentTime = millis();
 
     // Update IMU at regular intervals
+    bool sampled = false;
     if (currentTime - lastIMUUpdateTime >= IMU_UPDATE_INTERVAL_MS) {
         lastIMUUpdateTime = currentTime;
-        imu.update();
+        imuTiming.tick(micros());
+        updateIMU();
+        predictor.update(imu.getPitch(), imu.getRoll());
+        sampled = true;
 
         // Check for motion - if moving, wait for stability
         if (imu.isMoving()) {
-            Serial.println("Motion detected - waiting for stability...");
+            LOG(LOG_MOTION_WAIT);
             changeState(SystemState::WAIT_FOR_STABLE);
             return;
         }
     }
 
-    // Perform leveling correction at regular intervals
-    if (currentTime - lastLevelCheckTime >= LEVEL_CHECK_INTERVAL_MS) {
+    // Control on the dead-reckoned attitude: the IMU angle still lags
+    // the last move (the stall check keeps using the measured one)
+    float pitch = imu.getPitch();
+    float roll = imu.getRoll();
+    float ctrlPitch = config.attitudePredictor ? predictor.getPitch() : pitch;
+    float ctrlRoll = config.attitudePredictor ? predictor.getRoll() : roll;
+    if (sampled) settle.update(currentTime, ctrlPitch, ctrlRoll);
+
+    // Perform leveling correction at regular intervals or, with the settle
+    // gate, as soon as the last move's response allows (checked per sample)
+    bool due;
+    if (config.settleGate && settle.isWaiting()) {
+        due = sampled && settle.ready(currentTime, ctrlPitch, ctrlRoll, config.levelTolerance);
+        // Waiting for the response is deliberate, not a late tick; the
+        // correction move before it still counts against the deadline
+        if (due) controlTiming.exclude(settle.getSettleMs() * 1000UL);
+    } else {
+        due = currentTime - lastLevelCheckTime >= LEVEL_CHECK_INTERVAL_MS;
+    }
+    if (due) {
+        float dt = (currentTime - lastLevelCheckTime) / 1000.0f;  // Includes the last correction's move
         lastLevelCheckTime = currentTime;
-
-        float pitch = imu.getPitch();
-        float roll = imu.getRoll();
+        controlTiming.tick(micros());
 
         // Check if within tolerance
-        if (imu.isLevel(config.levelTolerance)) {
+        if (fabsf(ctrlPitch) < config.levelTolerance && fabsf(ctrlRoll) < config.levelTolerance) {
             if (!withinTolerance) {
                 // Just entered tolerance - start timing
                 withinTolerance = true;
                 levelSinceTime = currentTime;
             } else if (currentTime - levelSinceTime >= LEVEL_CONFIRM_MS) {
                 // Sustained level for required duration - confirm level
-                Serial.printf("Level achieved! Pitch=%.2f, Roll=%.2f (stable for %dms)\n",
-                              pitch, roll, LEVEL_CONFIRM_MS);
+                LOG(LOG_LEVEL_ACHIEVED, pitch, roll, LEVEL_CONFIRM_MS);
+                checkStall(pitch, roll);  // Settled for LEVEL_CONFIRM_MS
                 changeState(SystemState::LEVEL_OK);
                 return;
             }
@@ -502,11 +701,33 @@ void handleLevelingState() {
             withinTolerance = false;
 
             // Calculate and apply correction
-            MotorCorrection correction = leveling.calculate(pitch, roll);
+            MotorCorrection correction;
+            {
+                PROFILE_STAGE(STAGE_CONTROL);
+                if (config.predictive) {
+                    mpc.setLimits(motors.getMinPosition(), motors.getMaxPosition());
+                    correction = mpc.calculate(ctrlPitch, ctrlRoll, motors.getPosition1(), motors.getPosition2());
+                } else {
+                    leveling.setMotorPositions(motors.getPosition1(), motors.getPosition2());
+                    correction = leveling.calculate(ctrlPitch, ctrlRoll, dt);
+                }
+            }
 
             // Only move motors if correction is significant
             if (abs(correction.motor1Steps) > 0 || abs(correction.motor2Steps) > 0) {
-                motors.applyCorrection(correction);
+                PROFILE_STAGE(STAGE_CORRECTION);
+                TIMING_SITE("correction");
+                if (!stallDetector.isOpen()) stallDetector.begin(pitch, roll);
+                MotorCorrection applied = motors.applyCorrection(correction);
+                stallDetector.addMove(applied);
+                predictor.addMove(applied);
+                if (config.settleGate) settle.begin(millis(), applied);
+                if (!config.predictive) leveling.reportApplied(correction, applied);
+                if (applied.motor1Steps != correction.motor1Steps ||
+                    applied.motor2Steps != correction.motor2Steps) {
+                    LOG(LOG_CORRECTION_CLIP, correction.motor1Steps, applied.motor1Steps,
+                        correction.motor2Steps, applied.motor2Steps);
+                }
             }
         }
     }
@@ -518,18 +739,19 @@ void handleLevelOkState() {
     // Continue monitoring IMU
     if (currentTime - lastIMUUpdateTime >= IMU_UPDATE_INTERVAL_MS) {
         lastIMUUpdateTime = currentTime;
-        imu.update();
+        imuTiming.tick(micros());
+        updateIMU();
 
         // Check if motion detected
         if (imu.isMoving()) {
-            Serial.println("Motion detected - re-leveling...");
+            LOG(LOG_MOTION_RELEVEL);
             changeState(SystemState::WAIT_FOR_STABLE);
             return;
         }
 
         // Check if still level (use 1.5x tolerance for hysteresis to avoid oscillation)
         if (!imu.isLevel(config.levelTolerance * 1.5f)) {
-            Serial.println("Platform no longer level - adjusting...");
+            LOG(LOG_NOT_LEVEL);
             changeState(SystemState::LEVELING);
         }
     }
@@ -543,168 +765,253 @@ void handleErrorState() {
 // Serial Command Handler
 // ============================================================================
 
-void handleSerialCommands() {
-    if (!Serial.available()) return;
+// Normal-mode commands. Handlers take the tokenized line; argument 0 is the
+// first word after the command name.
+
+static void cmdEnterTestMode(const CommandArgs&) {
+    changeState(SystemState::TEST_MODE);
+}
+
+static void cmdHelp(const CommandArgs&) {
+    printHelp();
+}
 
-    String input = Serial.readStringUntil('\n');
-    input.trim();
+static void cmdStatus(const CommandArgs&) {
+    printStatus();
+}
 
-    if (input.length() == 0) return;
+static void cmdIMU(const CommandArgs&) {
+    printIMUData();
+}
 
-    // Check for test mode entry commands
-    if (input.equalsIgnoreCase("admin") || input.equalsIgnoreCase("test")) {
-        changeState(SystemState::TEST_MODE);
+static void cmdCalibrate(const CommandArgs&) {
+    if (currentState != SystemState::IDLE) {
+        Serial.println("Calibration only available in IDLE state.");
         return;
     }
+    Serial.println("Starting IMU...");
+    if (imu.begin()) {
+        imu.calibrate();
+    }
+}
 
-    // If in test mode, use the test mode command handler
-    if (currentState == SystemState::TEST_MODE) {
-        handleTestModeCommands(input);
-        return;
+static void cmdReset(const CommandArgs&) {
+    Serial.println("Resetting to IDLE state...");
+    changeState(SystemState::IDLE);
+}
+
+static void cmdLogging(const CommandArgs&) {
+    config.continuousLogging = !config.continuousLogging;
+    Serial.printf("Continuous logging: %s\n", config.continuousLogging ? "ON" : "OFF");
+}
+
+// level - start leveling from IDLE (like button press)
+static void cmdLevel(const CommandArgs&) {
+    if (currentState == SystemState::IDLE) {
+        Serial.println("Starting leveling via serial command...");
+        changeState(SystemState::INITIALIZING);
+    } else {
+        Serial.printf("Cannot start leveling from %s state. Reset first.\n",
+                      stateToString(currentState));
     }
+}
 
-    // Multi-char commands that would conflict with single-char switch
-    if (input.startsWith("st") || input.startsWith("ST") || input.startsWith("St")) {
-        // Set stability timeout: st <seconds>
-        if (input.length() < 4) {
-            Serial.printf("Stability timeout: %lu ms (%.1f sec)\n",
-                          config.stabilityTimeoutMs, config.stabilityTimeoutMs / 1000.0f);
-            Serial.println("Usage: st <seconds>  (0.5 - 30)");
-        } else {
-            float seconds = input.substring(3).toFloat();
-            if (seconds >= 0.5f && seconds <= 30.0f) {
-                config.stabilityTimeoutMs = (unsigned long)(seconds * 1000);
-                Serial.printf("Stability timeout set to %lu ms (%.1f sec)\n",
-                              config.stabilityTimeoutMs, seconds);
-            } else {
-                Serial.println("Invalid timeout (must be between 0.5 and 30 seconds)");
-            }
-        }
+// m1 <steps> / m2 <steps> (both modes)
+static void cmdMoveMotor1(const CommandArgs& args) {
+    long steps;
+    if (!args.getInt(0, steps)) {
+        Serial.println("Usage: m1 <steps>");
         return;
     }
+    if (levelingOwnsMotors()) {
+        Serial.printf("Cannot move motors while %s. Reset first.\n", stateToString(currentState));
+        return;
+    }
+    if (planner.queueMove(steps, 0)) {
+        Serial.printf("Moving motor 1 by %ld steps\n", steps);
+    } else {
+        Serial.println("Motion queue full");
+    }
+}
 
-    char cmd = input.charAt(0);
-
-    switch (cmd) {
-        case 'h':
-        case 'H':
-        case '?':
-            printHelp();
-            break;
+static void cmdMoveMotor2(const CommandArgs& args) {
+    long steps;
+    if (!args.getInt(0, steps)) {
+        Serial.println("Usage: m2 <steps>");
+        return;
+    }
+    if (levelingOwnsMotors()) {
+        Serial.printf("Cannot move motors while %s. Reset first.\n", stateToString(currentState));
+        return;
+    }
+    if (planner.queueMove(0, steps)) {
+        Serial.printf("Moving motor 2 by %ld steps\n", steps);
+    } else {
+        Serial.println("Motion queue full");
+    }
+}
 
-        case 's':
-        case 'S':
-            printStatus();
-            break;
+// p <kp> <ki> [kd] - set PI(D) gains for both axes
+static void cmdGains(const CommandArgs& args) {
+    float kp, ki, kd;
+    if (!args.getFloat(0, kp) || !args.getFloat(1, ki)) {
+        float kdRoll;
+        leveling.getPitchGains(kp, ki);
+        leveling.getDerivativeGains(kd, kdRoll);
+        Serial.printf("Current gains - Kp: %.2f, Ki: %.2f, Kd: %.2f\n", kp, ki, kd);
+        Serial.println("Usage: p <kp> <ki> [kd]");
+        return;
+    }
+    if (args.getFloat(2, kd)) {
+        leveling.setDerivativeGains(kd, kd);
+    }
+    config.kpPitch = kp;
+    config.kiPitch = ki;
+    config.kpRoll = kp;
+    config.kiRoll = ki;
+    leveling.setPitchGains(kp, ki);
+    leveling.setRollGains(kp, ki);
+    saveGains();
+}
 
-        case 'i':
-        case 'I':
-            printIMUData();
-            break;
+// mpc [on|off] - predictive controller instead of PI
+static void cmdPredictive(const CommandArgs& args) {
+    if (args.is(0, "on") || args.is(0, "off")) {
+        config.predictive = args.is(0, "on");
+        mpc.reset();
+        leveling.reset();
+    } else if (args.has(0)) {
+        Serial.println("Usage: mpc [on|off]");
+        return;
+    }
+    Serial.printf("Controller: %s\n", config.predictive ? "predictive (MPC)" : "PI");
+}
 
-        case 'c':
-        case 'C':
-            if (currentState != SystemState::IDLE) {
-                Serial.println("Calibration only available in IDLE state.");
-            } else {
-                Serial.println("Starting IMU...");
-                if (imu.begin()) {
-                    imu.calibrate();
-                }
-            }
-            break;
+// predict [on|off] - control on the dead-reckoned attitude
+static void cmdPredictor(const CommandArgs& args) {
+    if (args.is(0, "on") || args.is(0, "off")) {
+        config.attitudePredictor = args.is(0, "on");
+        predictor.reset(imu.getPitch(), imu.getRoll());
+    } else if (args.has(0)) {
+        Serial.println("Usage: predict [on|off]");
+        return;
+    }
+    Serial.printf("Attitude predictor: %s\n", config.attitudePredictor ? "ON" : "OFF");
+}
 
-        case 'r':
-        case 'R':
-            Serial.println("Resetting to IDLE state...");
-            changeState(SystemState::IDLE);
-            break;
+// settle [on|off] - wait for each move's response instead of the fixed tick
+static void cmdSettle(const CommandArgs& args) {
+    if (args.is(0, "on") || args.is(0, "off")) {
+        config.settleGate = args.is(0, "on");
+        settle.reset();
+    } else if (args.has(0)) {
+        Serial.println("Usage: settle [on|off]");
+        return;
+    }
+    Serial.printf("Settle gate: %s, last settle %lu ms\n", config.settleGate ? "ON" : "OFF", settle.getSettleMs());
+}
 
-        case 'l':
-        case 'L':
-            // "level" command: start leveling from IDLE (like button press)
-            if (input.equalsIgnoreCase("level")) {
-                if (currentState == SystemState::IDLE) {
-                    Serial.println("Starting leveling via serial command...");
-                    changeState(SystemState::INITIALIZING);
-                } else {
-                    Serial.printf("Cannot start leveling from %s state. Reset first.\n",
-                                  stateToString(currentState));
-                }
-            } else {
-                config.continuousLogging = !config.continuousLogging;
-                Serial.printf("Continuous logging: %s\n", config.continuousLogging ? "ON" : "OFF");
-            }
-            break;
+// t <degrees> - set level tolerance
+static void cmdTolerance(const CommandArgs& args) {
+    float tol;
+    if (!args.getFloat(0, tol)) {
+        Serial.printf("Current level tolerance: %.2f degrees\n", config.levelTolerance);
+        Serial.println("Usage: t <degrees>");
+        return;
+    }
+    if (tol > 0 && tol < 10) {
+        config.levelTolerance = tol;
+        Serial.printf("Level tolerance set to %.2f degrees\n", tol);
+    } else {
+        Serial.println("Invalid tolerance (must be between 0 and 10)");
+    }
+}
 
-        case 'm':
-        case 'M': {
-            // Motor command: m1 <steps> or m2 <steps>
-            if (input.length() < 3) {
-                Serial.println("Usage: m1 <steps> or m2 <steps>");
-                break;
-            }
+// st <seconds> - set stability timeout
+static void cmdStabilityTimeout(const CommandArgs& args) {
+    float seconds;
+    if (!args.getFloat(0, seconds)) {
+        Serial.printf("Stability timeout: %lu ms (%.1f sec)\n",
+                      config.stabilityTimeoutMs, config.stabilityTimeoutMs / 1000.0f);
+        Serial.println("Usage: st <seconds>  (0.5 - 30)");
+        return;
+    }
+    if (seconds >= 0.5f && seconds <= 30.0f) {
+        config.stabilityTimeoutMs = (unsigned long)(seconds * 1000);
+        Serial.printf("Stability timeout set to %lu ms (%.1f sec)\n",
+                      config.stabilityTimeoutMs, seconds);
+    } else {
+        Serial.println("Invalid timeout (must be between 0.5 and 30 seconds)");
+    }
+}
 
-            char motorNum = input.charAt(1);
-            int steps = input.substring(2).toInt();
-
-            if (motorNum == '1') {
-                Serial.printf("Moving motor 1 by %d steps...\n", steps);
-                motors.moveMotor1(steps);
-                Serial.println("Done.");
-            } else if (motorNum == '2') {
-                Serial.printf("Moving motor 2 by %d steps...\n", steps);
-                motors.moveMotor2(steps);
-                Serial.println("Done.");
-            } else {
-                Serial.println("Invalid motor number. Use m1 or m2.");
-            }
-            break;
-        }
+// log [text|bin] - deferred log output format (both modes)
+static void cmdLog(const CommandArgs& args) {
+    if (args.is(0, "bin")) {
+        deferredLog.setBinary(true);
+    } else if (args.is(0, "text")) {
+        deferredLog.setBinary(false);
+    } else if (args.has(0)) {
+        Serial.println("Usage: log [text|bin]");
+        return;
+    }
+    Serial.printf("[LOG] %s, %lu pending, %lu dropped\n",
+                  deferredLog.isBinary() ? "binary" : "text",
+                  (unsigned long)deferredLog.getPending(), (unsigned long)deferredLog.getDropped());
+}
 
-        case 'p':
-        case 'P': {
-            // Set PI gains: p <kp> <ki>
-            int spaceIdx = input.indexOf(' ', 2);
-            if (spaceIdx == -1) {
-                float kp, ki;
-                leveling.getPitchGains(kp, ki);
-                Serial.printf("Current gains - Kp: %.2f, Ki: %.2f\n", kp, ki);
-                Serial.println("Usage: p <kp> <ki>");
-            } else {
-                float kp = input.substring(2, spaceIdx).toFloat();
-                float ki = input.substring(spaceIdx + 1).toFloat();
-                config.kpPitch = kp;
-                config.kiPitch = ki;
-                config.kpRoll = kp;
-                config.kiRoll = ki;
-                leveling.setPitchGains(kp, ki);
-                leveling.setRollGains(kp, ki);
-            }
-            break;
-        }
+// Sorted by name (case-insensitive) for binary search; checked at compile time
+static constexpr ConsoleCommand NORMAL_COMMANDS[] = {
+    {"?",       cmdHelp},
+    {"admin",   cmdEnterTestMode},
+    {"c",       cmdCalibrate},
+    {"h",       cmdHelp},
+    {"help",    cmdHelp},
+    {"hstream", handleStreamCommand},
+    {"i",       cmdIMU},
+    {"l",       cmdLogging},
+    {"level",   cmdLevel},
+    {"log",     cmdLog},
+    {"m1",      cmdMoveMotor1},
+    {"m2",      cmdMoveMotor2},
+    {"mpc",     cmdPredictive},
+    {"p",       cmdGains},
+    {"perf",    handlePerfCommand},
+    {"predict", cmdPredictor},
+    {"r",       cmdReset},
+    {"s",       cmdStatus},
+    {"sched",   handleScheduleCommand},
+    {"settle",  cmdSettle},
+    {"st",      cmdStabilityTimeout},
+    {"stall",   handleStallCommand},
+    {"t",       cmdTolerance},
+    {"test",    cmdEnterTestMode},
+    {"timing",  handleTimingCommand},
+};
+static_assert(SerialConsole::isSorted(NORMAL_COMMANDS), "NORMAL_COMMANDS must be sorted by name");
+
+// Called by SerialLink with each complete text line (also for REQ_TEXT).
+// The line is tokenized in place; nothing here allocates or blocks on input.
+void handleSerialCommands(char* line) {
+    CommandArgs args(line);
+    if (!args.name()) return;
+    if (args.tooMany()) {
+        Serial.printf("Too many arguments for '%s' (max %d).\n", args.name(), CONSOLE_MAX_ARGS);
+        return;
+    }
 
-        case 't':
-        case 'T': {
-            // Set tolerance: t <degrees>
-            if (input.length() < 3) {
-                Serial.printf("Current level tolerance: %.2f degrees\n", config.levelTolerance);
-                Serial.println("Usage: t <degrees>");
-            } else {
-                float tol = input.substring(2).toFloat();
-                if (tol > 0 && tol < 10) {
-                    config.levelTolerance = tol;
-                    Serial.printf("Level tolerance set to %.2f degrees\n", tol);
-                } else {
-                    Serial.println("Invalid tolerance (must be between 0 and 10)");
-                }
-            }
-            break;
-        }
+    // If in test mode, use the test mode command table
+    if (currentState == SystemState::TEST_MODE) {
+        handleTestModeCommands(args);
+        return;
+    }
 
-        default:
-            Serial.printf("Unknown command: '%c'. Type 'h' for help.\n", cmd);
-            break;
+    const ConsoleCommand* cmd = SerialConsole::find(NORMAL_COMMANDS, args.name());
+    if (cmd) {
+        TIMING_SITE(cmd->name);
+        cmd->handler(args);
+    } else {
+        Serial.printf("Unknown command: '%s'. Type 'h' for help.\n", args.name());
     }
 }
 
@@ -718,11 +1025,21 @@ void printHelp() {
     Serial.println("  m2 <N>    - Move motor 2 by N steps");
     Serial.println("  c         - Run IMU calibration (IDLE only)");
     Serial.println("  r         - Reset to IDLE state");
-    Serial.println("  p <kp> <ki> - Set PI gains");
+    Serial.println("  p <kp> <ki> [kd] - Set PI(D) gains");
+    Serial.println("  mpc [on|off]     - Predictive controller instead of PI");
+    Serial.println("  predict [on|off] - Control on the dead-reckoned attitude");
+    Serial.println("  settle [on|off]  - Correct when each move has settled, not on a fixed tick");
     Serial.println("  t <deg>   - Set level tolerance");
     Serial.println("  st <sec>  - Set stability timeout (default 3s)");
     Serial.println("  l         - Toggle continuous logging");
     Serial.println("  level     - Start leveling (same as button press)");
+    Serial.println("  hstream [hz|off] - Toggle binary high-rate telemetry");
+    Serial.println("  log [text|bin]   - Log output format / drop counters");
+    Serial.println("  perf [reset]     - Loop stage timing (profiler builds)");
+    Serial.println("  timing [reset]   - Control interval jitter and deadline misses");
+    Serial.println("  timing imu|ctrl <ms> - Set a deadline");
+    Serial.println("  stall [reset]    - Missed-step check and correction step rates");
+    Serial.println("  sched [reset | e|p <s1> <s2> <s3> <s4>] - Gain schedule");
     Serial.println();
     Serial.println("  admin     - Enter ADMIN TEST MODE");
     Serial.println("  test      - Enter ADMIN TEST MODE");
@@ -736,6 +1053,9 @@ void printStatus() {
     Serial.printf("  Time in state: %lu ms\n", millis() - stateEnteredTime);
     Serial.printf("  Level tolerance: %.2f deg\n", config.levelTolerance);
     Serial.printf("  PI gains: Kp=%.2f, Ki=%.2f\n", config.kpPitch, config.kiPitch);
+    Serial.printf("  Controller: %s\n", config.predictive ? "predictive (MPC)" : "PI");
+    Serial.printf("  Attitude predictor: %s\n", config.attitudePredictor ? "ON" : "OFF");
+    Serial.printf("  Settle gate: %s (last settle %lu ms)\n", config.settleGate ? "ON" : "OFF", settle.getSettleMs());
     Serial.printf("  Motor positions: M1=%ld, M2=%ld\n", motors.getPosition1(), motors.getPosition2());
     Serial.printf("  Continuous logging: %s\n", config.continuousLogging ? "ON" : "OFF");
     Serial.println();
@@ -777,12 +1097,19 @@ void printTestModeMenu() {
     Serial.println("===========================================");
     Serial.println("Commands:");
     Serial.println("  Motors:  m1/m2 <steps>, m1c, m2c, mstop, mspeed <rpm>");
+    Serial.println("           mto <m1> <m2> (queue move to positions), mstep [on|off]");
+    Serial.println("           mhold [duty%] [timeout s] (reduced-current hold)");
     Serial.println("           mpos (query positions), mreset (reset to zero)");
+    Serial.println("           stall [cal|reset] (missed steps, fastest reliable step rate)");
+    Serial.println("           backlash [cal | <m1> <m2>] (take-up steps on reversal)");
+    Serial.println("           tune [zn|tl|simc|stop] (relay auto-tune of the PI gains)");
     Serial.println("  IMU:     scan, imu, read, stream, cal, raw");
+    Serial.println("           hstream [hz|off] (binary telemetry, up to 1 kHz)");
     Serial.println("  Button:  btn (then press button to see events)");
     Serial.println("  LED:     led on/off/slow/fast/pulse/error/cycle");
     Serial.println("           led red/green/blue/yellow/cyan/purple/white");
-    Serial.println("  System:  info, pins");
+    Serial.println("  System:  info, pins, log [text|bin], perf [reset], timing [reset]");
+    Serial.println("           sched [reset | e|p <s1> <s2> <s3> <s4>] (gain schedule)");
     Serial.println("  Exit:    exit (return to normal mode)");
     Serial.println("===========================================");
     Serial.println();
@@ -862,21 +1189,19 @@ void handleTestModeState() {
     // Handle continuous IMU streaming (10 Hz)
     if (testModeIMUStreaming && (currentTime - testModeLastStreamTime >= 100)) {
         testModeLastStreamTime = currentTime;
-        imu.update();
+        updateIMU();
         const IMUData& data = imu.getData();
-        Serial.printf("[IMU] P:%.2f R:%.2f | Ax:%.3f Ay:%.3f Az:%.3f | Gx:%.1f Gy:%.1f Gz:%.1f | M1:%ld M2:%ld\n",
-                      data.pitch, data.roll,
-                      data.accelX, data.accelY, data.accelZ,
-                      data.gyroX, data.gyroY, data.gyroZ,
-                      motors.getPosition1(), motors.getPosition2());
+        LOG(LOG_TEST_IMU, data.pitch, data.roll,
+            data.accelX, data.accelY, data.accelZ,
+            data.gyroX, data.gyroY, data.gyroZ,
+            motors.getPosition1(), motors.getPosition2());
     }
 
-    // Handle continuous motor rotation
-    if (testModeMotor1Continuous) {
-        motors.moveMotor1(10);  // Small increments for smooth rotation
-    }
-    if (testModeMotor2Continuous) {
-        motors.moveMotor2(10);
+    // Handle continuous motor rotation: keep a couple of jog segments
+    // queued so the planner blends them at full speed
+    if ((testModeMotor1Continuous || testModeMotor2Continuous) && planner.queued() < 2) {
+        planner.queueMove(testModeMotor1Continuous ? PLANNER_JOG_STEPS : 0,
+                          testModeMotor2Continuous ? PLANNER_JOG_STEPS : 0);
     }
 
     // Handle LED cycle test (2s per pattern)
@@ -901,365 +1226,1385 @@ void handleTestModeState() {
 
         testModeLEDCycleIndex = (testModeLEDCycleIndex + 1) % numPatterns;
     }
+
+    // Relay auto-tune experiment
+    serviceAutoTune(currentTime);
 }
 
-void handleTestModeCommands(String& input) {
-    // Exit command
-    if (input.equalsIgnoreCase("exit")) {
-        Serial.println("Exiting test mode...");
-        motors.release();
-        testModeIMUStreaming = false;
-        testModeButtonTest = false;
-        testModeMotor1Continuous = false;
-        testModeMotor2Continuous = false;
-        testModeLEDCycle = false;
-        changeState(SystemState::IDLE);
-        return;
+// LED modes shared by the `led` command and the dashboard. A null color
+// keeps the current one. Sorted by name for SerialConsole::find.
+struct LedMode {
+    const char* name;
+    LEDPattern pattern;
+    const RGBColor* color;
+    const char* label;
+};
+
+static constexpr LedMode LED_MODES[] = {
+    {"blue",   LEDPattern::SOLID,        &LEDColors::BLUE,   "BLUE"},
+    {"cyan",   LEDPattern::SOLID,        &LEDColors::CYAN,   "CYAN"},
+    {"error",  LEDPattern::ERROR_BLINK,  nullptr,            "ERROR_BLINK (10 Hz)"},
+    {"fast",   LEDPattern::FAST_BLINK,   nullptr,            "FAST_BLINK (4 Hz)"},
+    {"green",  LEDPattern::SOLID,        &LEDColors::GREEN,  "GREEN"},
+    {"off",    LEDPattern::OFF,          nullptr,            "OFF"},
+    {"on",     LEDPattern::SOLID,        nullptr,            "SOLID (on)"},
+    {"pulse",  LEDPattern::DOUBLE_PULSE, nullptr,            "DOUBLE_PULSE"},
+    {"purple", LEDPattern::SOLID,        &LEDColors::PURPLE, "PURPLE"},
+    {"red",    LEDPattern::SOLID,        &LEDColors::RED,    "RED"},
+    {"slow",   LEDPattern::SLOW_BLINK,   nullptr,            "SLOW_BLINK (1 Hz)"},
+    {"white",  LEDPattern::SOLID,        &LEDColors::WHITE,  "WHITE"},
+    {"yellow", LEDPattern::SOLID,        &LEDColors::YELLOW, "YELLOW"},
+};
+static_assert(SerialConsole::isSorted(LED_MODES), "LED_MODES must be sorted by name");
+
+// Set the LED to a named mode; returns its label, or nullptr if unknown
+const char* applyLedMode(const char* name) {
+    const LedMode* mode = SerialConsole::find(LED_MODES, name);
+    if (!mode) return nullptr;
+    if (mode->color) {
+        statusLED.setColor(*mode->color);
     }
+    statusLED.setPattern(mode->pattern);
+    return mode->label;
+}
 
-    // Help/menu
-    if (input.equalsIgnoreCase("help") || input.equalsIgnoreCase("menu") || input == "?") {
-        printTestModeMenu();
-        return;
+// ==================== Test Mode Commands ====================
+
+static void cmdExitTestMode(const CommandArgs&) {
+    Serial.println("Exiting test mode...");
+    motors.release();
+    testModeIMUStreaming = false;
+    testModeButtonTest = false;
+    testModeMotor1Continuous = false;
+    testModeMotor2Continuous = false;
+    testModeLEDCycle = false;
+    if (telemetry.getSinks() & STREAM_SINK_SERIAL) {
+        setSerialStream(0);
+        Serial.printf("[STREAM] OFF (%lu samples dropped)\n", (unsigned long)telemetry.getDropped());
     }
+    changeState(SystemState::IDLE);
+}
 
-    // ==================== IMU Commands ====================
+static void cmdTestMenu(const CommandArgs&) {
+    printTestModeMenu();
+}
 
-    if (input.equalsIgnoreCase("scan")) {
-        scanI2CBus();
-        return;
-    }
+static void cmdScan(const CommandArgs&) {
+    scanI2CBus();
+}
 
-    if (input.equalsIgnoreCase("imu")) {
-        Serial.println("Initializing IMU...");
-        if (imu.begin()) {
-            Serial.println("IMU initialized successfully!");
-            // Read WHO_AM_I register
-            Wire.beginTransmission(MPU6050_ADDRESS);
-            Wire.write(0x75);  // WHO_AM_I register
-            Wire.endTransmission(false);
-            Wire.requestFrom((uint8_t)MPU6050_ADDRESS, (uint8_t)1);
-            if (Wire.available()) {
-                uint8_t whoAmI = Wire.read();
-                Serial.printf("  WHO_AM_I: 0x%02X (expected 0x68)\n", whoAmI);
-            }
-        } else {
-            Serial.println("ERROR: Failed to initialize IMU!");
+static void cmdInitIMU(const CommandArgs&) {
+    Serial.println("Initializing IMU...");
+    if (imu.begin()) {
+        Serial.println("IMU initialized successfully!");
+        // Read WHO_AM_I register
+        Wire.beginTransmission(MPU6050_ADDRESS);
+        Wire.write(0x75);  // WHO_AM_I register
+        Wire.endTransmission(false);
+        Wire.requestFrom((uint8_t)MPU6050_ADDRESS, (uint8_t)1);
+        if (Wire.available()) {
+            uint8_t whoAmI = Wire.read();
+            Serial.printf("  WHO_AM_I: 0x%02X (expected 0x68)\n", whoAmI);
         }
-        return;
+    } else {
+        Serial.println("ERROR: Failed to initialize IMU!");
     }
+}
 
-    if (input.equalsIgnoreCase("read")) {
-        imu.update();
-        const IMUData& data = imu.getData();
-        Serial.println();
-        Serial.println("=== Single IMU Reading ===");
-        Serial.printf("  Pitch: %.2f deg\n", data.pitch);
-        Serial.printf("  Roll:  %.2f deg\n", data.roll);
-        Serial.printf("  Accel: X=%.3fg Y=%.3fg Z=%.3fg\n", data.accelX, data.accelY, data.accelZ);
-        Serial.printf("  Gyro:  X=%.1f Y=%.1f Z=%.1f deg/s\n", data.gyroX, data.gyroY, data.gyroZ);
-        Serial.printf("  Temp:  %.1f C\n", data.temperature);
-        Serial.println();
-        return;
-    }
+static void cmdReadIMU(const CommandArgs&) {
+    imu.update();
+    const IMUData& data = imu.getData();
+    Serial.println();
+    Serial.println("=== Single IMU Reading ===");
+    Serial.printf("  Pitch: %.2f deg\n", data.pitch);
+    Serial.printf("  Roll:  %.2f deg\n", data.roll);
+    Serial.printf("  Accel: X=%.3fg Y=%.3fg Z=%.3fg\n", data.accelX, data.accelY, data.accelZ);
+    Serial.printf("  Gyro:  X=%.1f Y=%.1f Z=%.1f deg/s\n", data.gyroX, data.gyroY, data.gyroZ);
+    Serial.printf("  Temp:  %.1f C\n", data.temperature);
+    Serial.println();
+}
 
-    if (input.equalsIgnoreCase("stream")) {
-        testModeIMUStreaming = !testModeIMUStreaming;
-        Serial.printf("IMU streaming: %s\n", testModeIMUStreaming ? "ON (10 Hz)" : "OFF");
-        if (testModeIMUStreaming) {
-            Serial.println("  Format: P:pitch R:roll | Ax Ay Az | Gx Gy Gz");
-        }
-        return;
+static void cmdTextStream(const CommandArgs&) {
+    testModeIMUStreaming = !testModeIMUStreaming;
+    Serial.printf("IMU streaming: %s\n", testModeIMUStreaming ? "ON (10 Hz)" : "OFF");
+    if (testModeIMUStreaming) {
+        Serial.println("  Format: P:pitch R:roll | Ax Ay Az | Gx Gy Gz");
     }
+}
 
-    if (input.equalsIgnoreCase("cal")) {
-        Serial.println("Starting IMU calibration...");
-        Serial.println("Keep the platform STILL and LEVEL!");
-        imu.calibrate();
-        Serial.println("Calibration complete.");
-        return;
-    }
+static void cmdTestCalibrate(const CommandArgs&) {
+    Serial.println("Starting IMU calibration...");
+    Serial.println("Keep the platform STILL and LEVEL!");
+    imu.calibrate();
+    Serial.println("Calibration complete.");
+}
 
-    if (input.equalsIgnoreCase("raw")) {
-        imu.update();
-        const IMURawData& raw = imu.getRawData();
-        Serial.println();
-        Serial.println("=== Raw IMU Values ===");
-        Serial.printf("  Accel: X=%d Y=%d Z=%d\n", raw.accelX, raw.accelY, raw.accelZ);
-        Serial.printf("  Gyro:  X=%d Y=%d Z=%d\n", raw.gyroX, raw.gyroY, raw.gyroZ);
-        Serial.printf("  Temp:  %d (raw)\n", raw.temperature);
-        Serial.println();
-        return;
+static void cmdRawIMU(const CommandArgs&) {
+    imu.update();
+    const IMURawData& raw = imu.getRawData();
+    Serial.println();
+    Serial.println("=== Raw IMU Values ===");
+    Serial.printf("  Accel: X=%d Y=%d Z=%d\n", raw.accelX, raw.accelY, raw.accelZ);
+    Serial.printf("  Gyro:  X=%d Y=%d Z=%d\n", raw.gyroX, raw.gyroY, raw.gyroZ);
+    Serial.printf("  Temp:  %d (raw)\n", raw.temperature);
+    Serial.println();
+}
+
+static void cmdButtonTest(const CommandArgs&) {
+    testModeButtonTest = !testModeButtonTest;
+    Serial.printf("Button test mode: %s\n", testModeButtonTest ? "ON" : "OFF");
+    if (testModeButtonTest) {
+        Serial.println("  Press the button to see events...");
     }
+}
 
-    // ==================== Button Commands ====================
+// led <mode> - patterns and colors from LED_MODES, or "cycle"
+static void cmdLed(const CommandArgs& args) {
+    testModeLEDCycle = false;  // Stop cycling if running
 
-    if (input.equalsIgnoreCase("btn")) {
-        testModeButtonTest = !testModeButtonTest;
-        Serial.printf("Button test mode: %s\n", testModeButtonTest ? "ON" : "OFF");
-        if (testModeButtonTest) {
-            Serial.println("  Press the button to see events...");
-        }
+    if (args.is(0, "cycle")) {
+        testModeLEDCycle = true;
+        testModeLEDCycleIndex = 0;
+        testModeLastLEDCycleTime = millis();
+        Serial.println("LED: Cycling through all patterns (2s each)...");
         return;
     }
 
-    // ==================== LED Commands ====================
-
-    if (input.startsWith("led ") || input.startsWith("LED ")) {
-        String ledCmd = input.substring(4);
-        ledCmd.trim();
-        testModeLEDCycle = false;  // Stop cycling if running
-
-        if (ledCmd.equalsIgnoreCase("on")) {
-            statusLED.setPattern(LEDPattern::SOLID);
-            Serial.println("LED: SOLID (on)");
-        } else if (ledCmd.equalsIgnoreCase("off")) {
-            statusLED.setPattern(LEDPattern::OFF);
-            Serial.println("LED: OFF");
-        } else if (ledCmd.equalsIgnoreCase("slow")) {
-            statusLED.setPattern(LEDPattern::SLOW_BLINK);
-            Serial.println("LED: SLOW_BLINK (1 Hz)");
-        } else if (ledCmd.equalsIgnoreCase("fast")) {
-            statusLED.setPattern(LEDPattern::FAST_BLINK);
-            Serial.println("LED: FAST_BLINK (4 Hz)");
-        } else if (ledCmd.equalsIgnoreCase("pulse")) {
-            statusLED.setPattern(LEDPattern::DOUBLE_PULSE);
-            Serial.println("LED: DOUBLE_PULSE");
-        } else if (ledCmd.equalsIgnoreCase("error")) {
-            statusLED.setPattern(LEDPattern::ERROR_BLINK);
-            Serial.println("LED: ERROR_BLINK (10 Hz)");
-        } else if (ledCmd.equalsIgnoreCase("cycle")) {
-            testModeLEDCycle = true;
-            testModeLEDCycleIndex = 0;
-            testModeLastLEDCycleTime = millis();
-            Serial.println("LED: Cycling through all patterns (2s each)...");
-        // Color commands — set color and turn on solid
-        } else if (ledCmd.equalsIgnoreCase("red")) {
-            statusLED.setColor(LEDColors::RED);
-            statusLED.setPattern(LEDPattern::SOLID);
-            Serial.println("LED: RED");
-        } else if (ledCmd.equalsIgnoreCase("green")) {
-            statusLED.setColor(LEDColors::GREEN);
-            statusLED.setPattern(LEDPattern::SOLID);
-            Serial.println("LED: GREEN");
-        } else if (ledCmd.equalsIgnoreCase("blue")) {
-            statusLED.setColor(LEDColors::BLUE);
-            statusLED.setPattern(LEDPattern::SOLID);
-            Serial.println("LED: BLUE");
-        } else if (ledCmd.equalsIgnoreCase("yellow")) {
-            statusLED.setColor(LEDColors::YELLOW);
-            statusLED.setPattern(LEDPattern::SOLID);
-            Serial.println("LED: YELLOW");
-        } else if (ledCmd.equalsIgnoreCase("cyan")) {
-            statusLED.setColor(LEDColors::CYAN);
-            statusLED.setPattern(LEDPattern::SOLID);
-            Serial.println("LED: CYAN");
-        } else if (ledCmd.equalsIgnoreCase("purple")) {
-            statusLED.setColor(LEDColors::PURPLE);
-            statusLED.setPattern(LEDPattern::SOLID);
-            Serial.println("LED: PURPLE");
-        } else if (ledCmd.equalsIgnoreCase("white")) {
-            statusLED.setColor(LEDColors::WHITE);
-            statusLED.setPattern(LEDPattern::SOLID);
-            Serial.println("LED: WHITE");
-        } else {
-            Serial.println("Unknown LED command.");
-            Serial.println("  Patterns: on, off, slow, fast, pulse, error, cycle");
-            Serial.println("  Colors:   red, green, blue, yellow, cyan, purple, white");
-        }
-        return;
+    const char* label = applyLedMode(args.str(0));
+    if (label) {
+        Serial.printf("LED: %s\n", label);
+    } else {
+        Serial.println("Unknown LED command.");
+        Serial.println("  Patterns: on, off, slow, fast, pulse, error, cycle");
+        Serial.println("  Colors:   red, green, blue, yellow, cyan, purple, white");
     }
+}
 
-    // ledtest - raw GPIO test bypassing LEDC, tests each pin individually
-    if (input.equalsIgnoreCase("ledtest")) {
-        Serial.println("LED raw GPIO test - bypassing LEDC PWM:");
-        uint8_t pins[] = {PIN_LED_RED, PIN_LED_GREEN, PIN_LED_BLUE};
-        const char* names[] = {"RED", "GREEN", "BLUE"};
+// ledtest - raw GPIO test bypassing LEDC, tests each pin individually
+static void cmdLedTest(const CommandArgs&) {
+    Serial.println("LED raw GPIO test - bypassing LEDC PWM:");
+    uint8_t pins[] = {PIN_LED_RED, PIN_LED_GREEN, PIN_LED_BLUE};
+    const char* names[] = {"RED", "GREEN", "BLUE"};
 
-        // Detach LEDC first so we can use raw GPIO
-        ledcDetachPin(PIN_LED_RED);
-        ledcDetachPin(PIN_LED_GREEN);
-        ledcDetachPin(PIN_LED_BLUE);
+    // Detach LEDC first so we can use raw GPIO
+    ledcDetachPin(PIN_LED_RED);
+    ledcDetachPin(PIN_LED_GREEN);
+    ledcDetachPin(PIN_LED_BLUE);
 
-        for (int i = 0; i < 3; i++) {
-            pinMode(pins[i], OUTPUT);
-        }
+    for (int i = 0; i < 3; i++) {
+        pinMode(pins[i], OUTPUT);
+    }
 
-        // Test each color HIGH
-        for (int i = 0; i < 3; i++) {
-            Serial.printf("  %s (GPIO %d) HIGH... ", names[i], pins[i]);
-            digitalWrite(pins[i], HIGH);
-            delay(1500);
-            digitalWrite(pins[i], LOW);
-            Serial.println("done");
-            delay(300);
-        }
+    // Test each color HIGH
+    for (int i = 0; i < 3; i++) {
+        Serial.printf("  %s (GPIO %d) HIGH... ", names[i], pins[i]);
+        digitalWrite(pins[i], HIGH);
+        delay(1500);
+        digitalWrite(pins[i], LOW);
+        Serial.println("done");
+        delay(300);
+    }
 
-        // Now test inverted (LOW = on for common anode)
-        Serial.println("  Now testing INVERTED (for common anode):");
-        for (int i = 0; i < 3; i++) {
-            // All HIGH first (off for common anode)
-            for (int j = 0; j < 3; j++) digitalWrite(pins[j], HIGH);
-            Serial.printf("  %s (GPIO %d) LOW... ", names[i], pins[i]);
-            digitalWrite(pins[i], LOW);
-            delay(1500);
-            digitalWrite(pins[i], HIGH);
-            Serial.println("done");
-            delay(300);
-        }
+    // Now test inverted (LOW = on for common anode)
+    Serial.println("  Now testing INVERTED (for common anode):");
+    for (int i = 0; i < 3; i++) {
+        // All HIGH first (off for common anode)
+        for (int j = 0; j < 3; j++) digitalWrite(pins[j], HIGH);
+        Serial.printf("  %s (GPIO %d) LOW... ", names[i], pins[i]);
+        digitalWrite(pins[i], LOW);
+        delay(1500);
+        digitalWrite(pins[i], HIGH);
+        Serial.println("done");
+        delay(300);
+    }
 
-        // All off
-        for (int i = 0; i < 3; i++) digitalWrite(pins[i], LOW);
+    // All off
+    for (int i = 0; i < 3; i++) digitalWrite(pins[i], LOW);
 
-        // Re-attach LEDC
-        ledcAttachPin(PIN_LED_RED, LEDC_CHANNEL_RED);
-        ledcAttachPin(PIN_LED_GREEN, LEDC_CHANNEL_GREEN);
-        ledcAttachPin(PIN_LED_BLUE, LEDC_CHANNEL_BLUE);
+    // Re-attach LEDC
+    ledcAttachPin(PIN_LED_RED, LEDC_CHANNEL_RED);
+    ledcAttachPin(PIN_LED_GREEN, LEDC_CHANNEL_GREEN);
+    ledcAttachPin(PIN_LED_BLUE, LEDC_CHANNEL_BLUE);
 
-        Serial.println("LED test complete. If inverted worked, your LED is common anode.");
-        return;
-    }
+    Serial.println("LED test complete. If inverted worked, your LED is common anode.");
+}
 
-    // ==================== Motor Commands ====================
+// m1c / m2c - toggle continuous rotation
+static void cmdMotor1Continuous(const CommandArgs&) {
+    testModeMotor1Continuous = !testModeMotor1Continuous;
+    Serial.printf("Motor 1 continuous: %s\n", testModeMotor1Continuous ? "ON" : "OFF");
+    if (!testModeMotor1Continuous) {
+        planner.stop();
+        motors.release();
+    }
+}
 
-    // m1 <steps> or m2 <steps>
-    if ((input.startsWith("m1 ") || input.startsWith("M1 ")) && input.length() > 3) {
-        int steps = input.substring(3).toInt();
-        Serial.printf("Moving motor 1 by %d steps...\n", steps);
-        motors.moveMotor1(steps);
-        Serial.println("Done.");
-        return;
+static void cmdMotor2Continuous(const CommandArgs&) {
+    testModeMotor2Continuous = !testModeMotor2Continuous;
+    Serial.printf("Motor 2 continuous: %s\n", testModeMotor2Continuous ? "ON" : "OFF");
+    if (!testModeMotor2Continuous) {
+        planner.stop();
+        motors.release();
     }
+}
 
-    if ((input.startsWith("m2 ") || input.startsWith("M2 ")) && input.length() > 3) {
-        int steps = input.substring(3).toInt();
-        Serial.printf("Moving motor 2 by %d steps...\n", steps);
-        motors.moveMotor2(steps);
-        Serial.println("Done.");
+// mstep [on|off] - sine microstepping drive
+static void cmdMicrostep(const CommandArgs& args) {
+    if (args.is(0, "on") || args.is(0, "off")) {
+        planner.stop();
+        motors.setMicrostepping(args.is(0, "on"));
+    } else if (args.has(0)) {
+        Serial.println("Usage: mstep [on|off]");
         return;
     }
+    Serial.printf("[MSTEP] Microstepping %s (%d per half-step)\n",
+                  motors.isMicrostepping() ? "ON" : "OFF", MICROSTEPS_PER_HALFSTEP);
+}
 
-    // m1c - toggle continuous motor 1
-    if (input.equalsIgnoreCase("m1c")) {
-        testModeMotor1Continuous = !testModeMotor1Continuous;
-        Serial.printf("Motor 1 continuous: %s\n", testModeMotor1Continuous ? "ON" : "OFF");
-        if (!testModeMotor1Continuous) {
-            motors.release();
+// mhold [duty%] [timeout s] - reduced-current hold now, or configure it
+static void cmdMotorHold(const CommandArgs& args) {
+    long duty, seconds;
+    if (args.getInt(0, duty)) {
+        if (duty < 0 || duty > 100) {
+            Serial.println("Usage: mhold [duty 0-100] [timeout s, 0 = none]");
+            return;
         }
-        return;
+        unsigned long timeoutMs = motors.getHoldTimeout();
+        if (args.getInt(1, seconds) && seconds >= 0) timeoutMs = (unsigned long)seconds * 1000UL;
+        motors.setHold((uint8_t)duty, timeoutMs);
+    } else {
+        planner.stop();
+        motors.hold();
     }
+    Serial.printf("[MHOLD] %s, duty %u%%, timeout %lus\n",
+                  motors.isHolding() ? "Holding" : "Released",
+                  motors.getHoldDuty(), motors.getHoldTimeout() / 1000UL);
+}
 
-    // m2c - toggle continuous motor 2
-    if (input.equalsIgnoreCase("m2c")) {
-        testModeMotor2Continuous = !testModeMotor2Continuous;
-        Serial.printf("Motor 2 continuous: %s\n", testModeMotor2Continuous ? "ON" : "OFF");
-        if (!testModeMotor2Continuous) {
-            motors.release();
-        }
+// mstop - stop all motors
+static void cmdMotorStop(const CommandArgs&) {
+    testModeMotor1Continuous = false;
+    testModeMotor2Continuous = false;
+    stopAutoTune();
+    planner.stop();
+    motors.release();
+    Serial.println("All motors stopped.");
+}
+
+// mto <m1> <m2> - queue a move to absolute positions; consecutive
+// targets are blended by the planner (multi-point test scripts)
+static void cmdMotorTarget(const CommandArgs& args) {
+    long pos1, pos2;
+    if (!args.getInt(0, pos1) || !args.getInt(1, pos2)) {
+        Serial.println("Usage: mto <m1> <m2>");
         return;
     }
+    if (planner.queueTarget(pos1, pos2)) {
+        Serial.printf("[MTO] Queued M1:%ld M2:%ld (%u in queue)\n", pos1, pos2, planner.queued());
+    } else {
+        Serial.println("[MTO] Motion queue full");
+    }
+}
 
-    // mstop - stop all motors
-    if (input.equalsIgnoreCase("mstop")) {
-        testModeMotor1Continuous = false;
-        testModeMotor2Continuous = false;
-        motors.release();
-        Serial.println("All motors stopped.");
+// mpos - query motor positions and limits
+static void cmdMotorPositions(const CommandArgs&) {
+    Serial.printf("[MPOS] M1:%ld M2:%ld MIN:%ld MAX:%ld\n",
+                  motors.getPosition1(), motors.getPosition2(),
+                  motors.getMinPosition(), motors.getMaxPosition());
+}
+
+// mreset / mreset1 / mreset2 - reset motor position counters to zero
+static void cmdMotorReset(const CommandArgs&) {
+    motors.resetPositions();
+    Serial.println("[MRESET] Motor positions reset to 0");
+}
+
+static void cmdMotorReset1(const CommandArgs&) {
+    motors.resetPosition1();
+    Serial.printf("[MRESET] M1 reset to 0 (M2 still at %ld)\n", motors.getPosition2());
+}
+
+static void cmdMotorReset2(const CommandArgs&) {
+    motors.resetPosition2();
+    Serial.printf("[MRESET] M2 reset to 0 (M1 still at %ld)\n", motors.getPosition1());
+}
+
+// mset <pos> - set both motor position counters to a value
+static void cmdMotorSet(const CommandArgs& args) {
+    long pos;
+    if (!args.getInt(0, pos)) {
+        Serial.println("Usage: mset <pos>");
         return;
     }
+    motors.setPosition1(pos);
+    motors.setPosition2(pos);
+    saveMotorPositions();
+    Serial.printf("[MSET] Both motors set to %ld\n", pos);
+}
 
-    // mpos - query motor positions and limits
-    if (input.equalsIgnoreCase("mpos")) {
-        Serial.printf("[MPOS] M1:%ld M2:%ld MIN:%ld MAX:%ld\n",
-                      motors.getPosition1(), motors.getPosition2(),
-                      motors.getMinPosition(), motors.getMaxPosition());
-        return;
+// coiltest - energize each Motor 2 coil one at a time to verify wiring
+static void cmdCoilTest(const CommandArgs&) {
+    Serial.println("Motor 2 coil test - energizing each pin for 1 second:");
+    uint8_t pins[] = {MOTOR2_IN1, MOTOR2_IN2, MOTOR2_IN3, MOTOR2_IN4};
+    const char* names[] = {"IN1", "IN2", "IN3", "IN4"};
+
+    // Make sure all are LOW first
+    for (int i = 0; i < 4; i++) digitalWrite(pins[i], LOW);
+
+    for (int i = 0; i < 4; i++) {
+        Serial.printf("  %s (GPIO %d) HIGH... ", names[i], pins[i]);
+        digitalWrite(pins[i], HIGH);
+        delay(1000);
+        digitalWrite(pins[i], LOW);
+        Serial.println("done");
+        delay(300);
     }
+    Serial.println("Coil test complete.");
+    Serial.println("Expected order: feel 4 distinct click/hums in sequence.");
+    Serial.println("If two adjacent coils feel the same, those pins may be swapped.");
+}
 
-    // mreset - reset motor position counters to zero
-    if (input.equalsIgnoreCase("mreset")) {
-        motors.resetPositions();
-        Serial.println("[MRESET] Motor positions reset to 0");
-        return;
+// munlock - remove position limits (for finding physical extents)
+static void cmdMotorUnlock(const CommandArgs&) {
+    motors.setLimits(-99999, 99999);
+    Serial.println("[MUNLOCK] Position limits removed (-99999 to 99999)");
+}
+
+// mlock - restore default position limits
+static void cmdMotorLock(const CommandArgs&) {
+    motors.setLimits(MOTOR_MIN_POSITION, MOTOR_MAX_POSITION);
+    Serial.printf("[MLOCK] Position limits restored (%d to %d)\n", MOTOR_MIN_POSITION, MOTOR_MAX_POSITION);
+}
+
+// mspeed <rpm> - set motor speed
+static void cmdMotorSpeed(const CommandArgs& args) {
+    long rpm;
+    if (args.getInt(0, rpm) && rpm >= 1 && rpm <= 15) {
+        testModeMotorSpeed = rpm;
+        motors.setSpeed(rpm);
+        Serial.printf("Motor speed set to %ld RPM\n", rpm);
+    } else {
+        Serial.println("Invalid speed. Use 1-15 RPM.");
     }
-    if (input.equalsIgnoreCase("mreset1")) {
-        motors.resetPosition1();
-        Serial.printf("[MRESET] M1 reset to 0 (M2 still at %ld)\n", motors.getPosition2());
-        return;
+}
+
+static void cmdPinInfo(const CommandArgs&) {
+    printPinInfo();
+}
+
+// Sorted by name (case-insensitive) for binary search; checked at compile time
+static constexpr ConsoleCommand TEST_COMMANDS[] = {
+    {"?",        cmdTestMenu},
+    {"admin",    cmdEnterTestMode},
+    {"backlash", handleBacklashCommand},
+    {"btn",      cmdButtonTest},
+    {"cal",      cmdTestCalibrate},
+    {"coiltest", cmdCoilTest},
+    {"exit",     cmdExitTestMode},
+    {"help",     cmdTestMenu},
+    {"hstream",  handleStreamCommand},
+    {"imu",      cmdInitIMU},
+    {"info",     cmdPinInfo},
+    {"led",      cmdLed},
+    {"ledtest",  cmdLedTest},
+    {"log",      cmdLog},
+    {"m1",       cmdMoveMotor1},
+    {"m1c",      cmdMotor1Continuous},
+    {"m2",       cmdMoveMotor2},
+    {"m2c",      cmdMotor2Continuous},
+    {"menu",     cmdTestMenu},
+    {"mhold",    cmdMotorHold},
+    {"mlock",    cmdMotorLock},
+    {"mpos",     cmdMotorPositions},
+    {"mreset",   cmdMotorReset},
+    {"mreset1",  cmdMotorReset1},
+    {"mreset2",  cmdMotorReset2},
+    {"mset",     cmdMotorSet},
+    {"mspeed",   cmdMotorSpeed},
+    {"mstep",    cmdMicrostep},
+    {"mstop",    cmdMotorStop},
+    {"mto",      cmdMotorTarget},
+    {"munlock",  cmdMotorUnlock},
+    {"perf",     handlePerfCommand},
+    {"pins",     cmdPinInfo},
+    {"raw",      cmdRawIMU},
+    {"read",     cmdReadIMU},
+    {"scan",     cmdScan},
+    {"sched",    handleScheduleCommand},
+    {"stall",    handleStallCommand},
+    {"stream",   cmdTextStream},
+    {"test",     cmdEnterTestMode},
+    {"timing",   handleTimingCommand},
+    {"tune",     handleTuneCommand},
+};
+static_assert(SerialConsole::isSorted(TEST_COMMANDS), "TEST_COMMANDS must be sorted by name");
+
+void handleTestModeCommands(const CommandArgs& args) {
+    const ConsoleCommand* cmd = SerialConsole::find(TEST_COMMANDS, args.name());
+    if (cmd) {
+        TIMING_SITE(cmd->name);
+        cmd->handler(args);
+    } else {
+        Serial.printf("Unknown command: '%s'. Type 'help' for menu.\n", args.name());
     }
-    if (input.equalsIgnoreCase("mreset2")) {
-        motors.resetPosition2();
-        Serial.printf("[MRESET] M2 reset to 0 (M1 still at %ld)\n", motors.getPosition1());
+}
+
+// ============================================================================
+// High-Rate Telemetry
+// ============================================================================
+
+// Serial sink control - hstream [hz|off]: no argument toggles at the current
+// rate, capped at what the serial link carries
+void handleStreamCommand(const CommandArgs& args) {
+    bool enable;
+    uint16_t hz = min((int)telemetry.getRate(), STREAM_SERIAL_MAX_HZ);
+    long value;
+    if (!args.has(0)) {
+        enable = !(telemetry.getSinks() & STREAM_SINK_SERIAL);
+    } else if (args.is(0, "off")) {
+        enable = false;
+    } else if (args.getInt(0, value) && value >= 1 && value <= STREAM_SERIAL_MAX_HZ) {
+        enable = true;
+        hz = value;
+    } else {
+        Serial.printf("Invalid rate (1 - %d Hz; the dashboard stream goes to %d)\n",
+                      STREAM_SERIAL_MAX_HZ, STREAM_MAX_HZ);
         return;
     }
 
-    // mset <pos> - set both motor position counters to a value
-    if (input.startsWith("mset ") || input.startsWith("MSET ")) {
-        long pos = input.substring(5).toInt();
-        motors.setPosition1(pos);
-        motors.setPosition2(pos);
-        saveMotorPositions();
-        Serial.printf("[MSET] Both motors set to %ld\n", pos);
-        return;
+    setSerialStream(enable ? hz : 0);
+    if (enable) {
+        Serial.printf("[STREAM] ON %u Hz\n", telemetry.getRate());
+    } else {
+        Serial.printf("[STREAM] OFF (%lu samples dropped)\n", (unsigned long)telemetry.getDropped());
     }
+}
+
+// Start the serial sink at hz, or stop it (0) after sending what is buffered
+void setSerialStream(uint16_t hz) {
+    if (hz > 0) {
+        telemetry.start(STREAM_SINK_SERIAL, hz);
+    } else if (telemetry.getSinks() & STREAM_SINK_SERIAL) {
+        serviceTelemetry();
+        uint8_t batch[STREAM_BATCH_MAX_SIZE];
+        size_t len = telemetry.takeBatch(batch, true);
+        if (len > 0) {
+            serialLink.sendFrame(LINK_EVT_STREAM, 0, batch, len);
+        }
+        telemetry.stop(STREAM_SINK_SERIAL);
+    }
+    updateIMURate();
+}
 
-    // coiltest - energize each Motor 2 coil one at a time to verify wiring
-    if (input.equalsIgnoreCase("coiltest")) {
-        Serial.println("Motor 2 coil test - energizing each pin for 1 second:");
-        uint8_t pins[] = {MOTOR2_IN1, MOTOR2_IN2, MOTOR2_IN3, MOTOR2_IN4};
-        const char* names[] = {"IN1", "IN2", "IN3", "IN4"};
+// The IMU runs at the control rate, faster only while a stream needs it
+void updateIMURate() {
+    int hz = 1000 / IMU_UPDATE_INTERVAL_MS;
+    if (telemetry.isActive()) hz = max(hz, (int)telemetry.getRate());
+    imu.setSampleRate(hz);
+}
 
-        // Make sure all are LOW first
-        for (int i = 0; i < 4; i++) digitalWrite(pins[i], LOW);
+// Record one sample per control tick and hand full batches to the sinks
+void serviceTelemetry() {
+    static uint32_t lastSampledUpdate = 0;
+    static uint8_t batch[STREAM_BATCH_MAX_SIZE];
+    unsigned long nowUs = micros();
 
-        for (int i = 0; i < 4; i++) {
-            Serial.printf("  %s (GPIO %d) HIGH... ", names[i], pins[i]);
-            digitalWrite(pins[i], HIGH);
-            delay(1000);
-            digitalWrite(pins[i], LOW);
-            Serial.println("done");
-            delay(300);
+    // The leveling states already update the IMU at the control rate; in
+    // test mode the stream polls it at its own rate. Other states leave the
+    // IMU idle, so nothing is recorded there.
+    if (currentState == SystemState::TEST_MODE) {
+        telemetry.setSourceRate(0);
+        if (telemetry.sampleDue(nowUs)) updateIMU();
+    } else {
+        telemetry.setSourceRate(1000 / IMU_UPDATE_INTERVAL_MS);
+    }
+    if (imu.getUpdateCount() != lastSampledUpdate) {
+        lastSampledUpdate = imu.getUpdateCount();
+        telemetry.record(imu.getData(), motors.getPosition1(), motors.getPosition2(), nowUs);
+    }
+
+    size_t len;
+    while ((len = telemetry.takeBatch(batch)) > 0) {
+        if (telemetry.getSinks() & STREAM_SINK_WEB) {
+            dashboard.sendStream(batch, len);
+        }
+        if (telemetry.getSinks() & STREAM_SINK_SERIAL) {
+            // Skip rather than block loop() when the UART buffer is full;
+            // the client sees the gap in sequence numbers
+            serialLink.sendFrame(LINK_EVT_STREAM, 0, batch, len, true);
         }
-        Serial.println("Coil test complete.");
-        Serial.println("Expected order: feel 4 distinct click/hums in sequence.");
-        Serial.println("If two adjacent coils feel the same, those pins may be swapped.");
-        return;
     }
+}
 
-    // munlock - remove position limits (for finding physical extents)
-    if (input.equalsIgnoreCase("munlock")) {
-        motors.setLimits(-99999, 99999);
-        Serial.println("[MUNLOCK] Position limits removed (-99999 to 99999)");
-        return;
+// ============================================================================
+// Loop Profiler
+// ============================================================================
+
+// Control-path IMU reads, timed as STAGE_IMU
+void updateIMU() {
+    PROFILE_STAGE(STAGE_IMU);
+    imu.update();
+}
+
+// perf [reset] - per-stage loop() timing (both modes)
+void handlePerfCommand(const CommandArgs& args) {
+#if LOOP_PROFILER_ENABLED
+    Serial.println("[PERF] stage          count      min     mean      p99      max (us)");
+    for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+        StageStats st;
+        if (!loopProfiler.getStats((LoopStage)i, st)) continue;
+        Serial.printf("[PERF] %-10s %9lu %8.1f %8.1f %8.1f %8.1f\n",
+                      LoopProfiler::stageName(i), (unsigned long)st.count,
+                      st.minUs, st.meanUs, st.p99Us, st.maxUs);
+    }
+    if (args.is(0, "reset")) {
+        loopProfiler.reset();
+        Serial.println("[PERF] Reset");
+    }
+#else
+    Serial.println("[PERF] Profiler not built (set LOOP_PROFILER_ENABLED)");
+#endif
+}
+
+// Dashboard perf request:
+// {"t":"perf","on":1,"s":[["loop",count,min,mean,p99,max],...]} in microseconds,
+// split over as many messages as needed to stay within WS_MSG_MAX_LEN
+void sendPerfStats(uint32_t clientId, bool reset) {
+    char buf[WS_MSG_MAX_LEN];
+#if LOOP_PROFILER_ENABLED
+    const int headLen = snprintf(buf, sizeof(buf), "{\"t\":\"perf\",\"on\":1,\"s\":[");
+    int len = headLen;
+    for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+        StageStats st;
+        if (!loopProfiler.getStats((LoopStage)i, st)) continue;
+        char row[80];
+        int rowLen = snprintf(row, sizeof(row), "[\"%s\",%lu,%.1f,%.1f,%.1f,%.1f]",
+                              LoopProfiler::stageName(i), (unsigned long)st.count,
+                              st.minUs, st.meanUs, st.p99Us, st.maxUs);
+        // Room for a separator and the closing "]}"
+        if (len > headLen && len + rowLen + 3 > (int)sizeof(buf)) {
+            memcpy(buf + len, "]}", 2);
+            dashboard.sendText(clientId, buf, len + 2);
+            len = headLen;
+        }
+        if (len > headLen) buf[len++] = ',';
+        memcpy(buf + len, row, rowLen);
+        len += rowLen;
     }
+    memcpy(buf + len, "]}", 2);
+    dashboard.sendText(clientId, buf, len + 2);
+    if (reset) loopProfiler.reset();
+#else
+    (void)reset;
+    int len = snprintf(buf, sizeof(buf), "{\"t\":\"perf\",\"on\":0}");
+    dashboard.sendText(clientId, buf, len);
+#endif
+}
 
-    // mlock - restore default position limits
-    if (input.equalsIgnoreCase("mlock")) {
-        motors.setLimits(MOTOR_MIN_POSITION, MOTOR_MAX_POSITION);
-        Serial.printf("[MLOCK] Position limits restored (%d to %d)\n", MOTOR_MIN_POSITION, MOTOR_MAX_POSITION);
+// ============================================================================
+// Control Timing
+// ============================================================================
+
+static void printTiming(const IntervalMonitor& m) {
+    IntervalStats st;
+    m.getStats(st);
+    Serial.printf("[TIMING] %-4s %lu intervals, mean %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                  m.getName(), (unsigned long)st.count, st.meanUs / 1000.0f,
+                  st.p99Us / 1000.0f, st.maxUs / 1000.0f);
+    Serial.printf("[TIMING]      %lu misses over %.1f ms", (unsigned long)st.misses,
+                  st.deadlineUs / 1000.0f);
+    if (st.worstSite) {
+        Serial.printf(", worst %.1f ms in %s", st.worstMissUs / 1000.0f, st.worstSite);
+    }
+    Serial.println();
+    for (uint8_t b = 0; b < TIMING_BUCKETS; b++) {
+        if (m.getBucket(b) == 0) continue;
+        Serial.printf("[TIMING]      %8.3f - %8.3f ms  %lu\n", (1UL << b) / 1000.0f,
+                      (2UL << b) / 1000.0f, (unsigned long)m.getBucket(b));
+    }
+}
+
+// timing [reset | imu <ms> | ctrl <ms>] - control interval histograms (both modes)
+void handleTimingCommand(const CommandArgs& args) {
+    IntervalMonitor* target = args.is(0, "imu") ? &imuTiming
+                            : args.is(0, "ctrl") ? &controlTiming : nullptr;
+    float ms;
+    if (target) {
+        if (!args.getFloat(1, ms) || ms <= 0) {
+            Serial.println("Usage: timing imu|ctrl <deadline ms>");
+            return;
+        }
+        target->setDeadline((uint32_t)(ms * 1000));
+        Serial.printf("[TIMING] %s deadline %.1f ms\n", target->getName(), ms);
         return;
     }
 
-    // mspeed <rpm> - set motor speed
-    if (input.startsWith("mspeed ") || input.startsWith("MSPEED ")) {
-        int rpm = input.substring(7).toInt();
-        if (rpm >= 1 && rpm <= 15) {
-            testModeMotorSpeed = rpm;
-            motors.setSpeed(rpm);
-            Serial.printf("Motor speed set to %d RPM\n", rpm);
+    printTiming(imuTiming);
+    printTiming(controlTiming);
+    if (args.is(0, "reset")) {
+        imuTiming.reset();
+        controlTiming.reset();
+        Serial.println("[TIMING] Reset");
+    }
+}
+
+// One message per monitor, times in ms; h holds the non-empty span of
+// the log2 histogram starting at bucket h0 ([2^b, 2^(b+1)) us):
+// {"t":"timing","n":"imu","c":N,"dl":15.0,"miss":N,"avg":10.01,"p99":10.9,
+//  "max":11.2,"w":0.0,"ws":"","h0":13,"h":[N,...]}
+static void sendTiming(uint32_t clientId, const IntervalMonitor& m) {
+    IntervalStats st;
+    m.getStats(st);
+    char buf[WS_MSG_MAX_LEN];
+    int len = snprintf(buf, sizeof(buf),
+                       "{\"t\":\"timing\",\"n\":\"%s\",\"c\":%lu,\"dl\":%.1f,\"miss\":%lu,"
+                       "\"avg\":%.2f,\"p99\":%.2f,\"max\":%.1f,\"w\":%.1f,\"ws\":\"%s\"",
+                       m.getName(), (unsigned long)st.count, st.deadlineUs / 1000.0f,
+                       (unsigned long)st.misses, st.meanUs / 1000.0f, st.p99Us / 1000.0f,
+                       st.maxUs / 1000.0f, st.worstMissUs / 1000.0f,
+                       st.worstSite ? st.worstSite : "");
+
+    int first = 0, last = -1;
+    for (int b = 0; b < TIMING_BUCKETS; b++) {
+        if (m.getBucket(b) == 0) continue;
+        if (last < 0) first = b;
+        last = b;
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, ",\"h0\":%d,\"h\":[", first);
+    for (int b = first; b <= last && len < (int)sizeof(buf); b++) {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s%lu", b > first ? "," : "",
+                        (unsigned long)m.getBucket(b));
+    }
+    if (len < (int)sizeof(buf)) {
+        len += snprintf(buf + len, sizeof(buf) - len, "]}");
+    }
+    if (len < (int)sizeof(buf)) {
+        dashboard.sendText(clientId, buf, len);
+    }
+}
+
+void sendTimingStats(uint32_t clientId, bool reset) {
+    sendTiming(clientId, imuTiming);
+    sendTiming(clientId, controlTiming);
+    if (reset) {
+        imuTiming.reset();
+        controlTiming.reset();
+    }
+}
+
+// ============================================================================
+// Stall Detection
+// ============================================================================
+
+static void applyStepRates() {
+    for (uint8_t m = 1; m <= 2; m++) {
+        motors.setCorrectionDelay(m, 1, stepRates.getDelay(m, 1));
+        motors.setCorrectionDelay(m, -1, stepRates.getDelay(m, -1));
+    }
+}
+
+static void saveStepRates() {
+    TIMING_SITE("nvs save");
+    prefs.begin("motors", false);
+    prefs.putUShort("rate1f", stepRates.getDelay(1, 1));
+    prefs.putUShort("rate1r", stepRates.getDelay(1, -1));
+    prefs.putUShort("rate2f", stepRates.getDelay(2, 1));
+    prefs.putUShort("rate2r", stepRates.getDelay(2, -1));
+    prefs.end();
+}
+
+void loadStepRates() {
+    prefs.begin("motors", true);
+    stepRates.setDelay(1, 1, prefs.getUShort("rate1f", STEP_DELAY_US));
+    stepRates.setDelay(1, -1, prefs.getUShort("rate1r", STEP_DELAY_US));
+    stepRates.setDelay(2, 1, prefs.getUShort("rate2f", STEP_DELAY_US));
+    stepRates.setDelay(2, -1, prefs.getUShort("rate2r", STEP_DELAY_US));
+    prefs.end();
+    applyStepRates();
+}
+
+// Judge the leveling run that just settled and tune the correction rates
+void checkStall(float pitch, float roll) {
+    if (!stallDetector.isOpen()) return;
+    int dir1 = stallDetector.direction1();
+    int dir2 = stallDetector.direction2();
+    const StallCheck& c = stallDetector.close(pitch, roll);
+
+    if (c.stalled()) {
+        LOG(LOG_STALL, c.missed1, c.steps1, c.efficiency1, c.missed2, c.steps2, c.efficiency2);
+    }
+
+    // Only runs that moved a motor one way say anything about that direction
+    bool changed = false;
+    if (c.judged1 && dir1 != 0 && stepRates.report(1, dir1, !c.stalled1())) {
+        LOG(LOG_STEP_RATE, 1, dir1 > 0 ? '+' : '-', stepRates.getDelay(1, dir1));
+        changed = true;
+    }
+    if (c.judged2 && dir2 != 0 && stepRates.report(2, dir2, !c.stalled2())) {
+        LOG(LOG_STEP_RATE, 2, dir2 > 0 ? '+' : '-', stepRates.getDelay(2, dir2));
+        changed = true;
+    }
+    if (changed) {
+        applyStepRates();
+        saveStepRates();
+    }
+}
+
+// Keep the IMU filter running while the platform settles
+static void settleIMU(float& pitch, float& roll) {
+    unsigned long start = millis();
+    while (millis() - start < STALL_SETTLE_MS) {
+        updateIMU();
+        delay(IMU_UPDATE_INTERVAL_MS);
+    }
+    pitch = imu.getPitch();
+    roll = imu.getRoll();
+}
+
+// stall cal: move each motor out and back at shorter and shorter delays
+// and keep, per direction, the fastest delay whose tilt change matched
+// the plant gains, plus 15% margin
+static void calibrateStepRates() {
+    TIMING_SITE("stall cal");
+    Serial.printf("[STALL] Calibrating step rates (%d-step moves, %d ms settle)...\n",
+                  STALL_CAL_STEPS, STALL_SETTLE_MS);
+
+    for (uint8_t m = 1; m <= 2; m++) {
+        unsigned long best[2] = {0, 0};    // [0 = forward, 1 = reverse]
+        bool done[2] = {false, false};
+
+        for (unsigned long d = STEP_DELAY_US; d >= STALL_MIN_DELAY_US && !(done[0] && done[1]); d = d * 4 / 5) {
+            for (int k = 0; k < 2; k++) {
+                long steps = k == 0 ? STALL_CAL_STEPS : -STALL_CAL_STEPS;
+                if (done[k]) {
+                    // Direction finished; keep the leg centred at the safe rate
+                    motors.moveBy(m == 1 ? steps : 0, m == 2 ? steps : 0);
+                    continue;
+                }
+
+                float p0, r0, p1, r1;
+                settleIMU(p0, r0);
+                MotorCorrection moved = motors.moveBy(m == 1 ? steps : 0, m == 2 ? steps : 0, d);
+                settleIMU(p1, r1);
+
+                StallCheck c = StallDetector::evaluate(moved.motor1Steps, moved.motor2Steps, p1 - p0, r1 - r0);
+                bool judged = m == 1 ? c.judged1 : c.judged2;
+                float eff = m == 1 ? c.efficiency1 : c.efficiency2;
+                Serial.printf("[STALL] M%u %c %4lu us: efficiency %.2f%s\n", m, k == 0 ? '+' : '-', d, eff,
+                              judged ? "" : " (too little tilt to judge)");
+
+                if (judged && eff >= STALL_CAL_EFFICIENCY) best[k] = d;
+                else done[k] = true;
+            }
+        }
+
+        for (int k = 0; k < 2; k++) {
+            int dir = k == 0 ? 1 : -1;
+            stepRates.setDelay(m, dir, best[k] ? best[k] * 115 / 100 : STALL_MAX_DELAY_US);
+        }
+    }
+
+    motors.hold();
+    applyStepRates();
+    saveStepRates();
+}
+
+// stall [reset|cal] - last missed-step check and the correction step delays
+void handleStallCommand(const CommandArgs& args) {
+    if (args.is(0, "reset")) {
+        stepRates.reset();
+        applyStepRates();
+        saveStepRates();
+    } else if (args.is(0, "cal")) {
+        if (currentState != SystemState::TEST_MODE) {
+            Serial.println("[STALL] cal needs test mode (moves both legs)");
+            return;
+        }
+        calibrateStepRates();
+    }
+
+    const StallCheck& c = stallDetector.last();
+    Serial.printf("[STALL] Last check: M1 %ld steps eff %.2f%s, M2 %ld steps eff %.2f%s\n",
+                  c.steps1, c.efficiency1, c.judged1 ? (c.stalled1() ? " MISSED" : "") : " (not judged)",
+                  c.steps2, c.efficiency2, c.judged2 ? (c.stalled2() ? " MISSED" : "") : " (not judged)");
+    Serial.printf("[STALL] Correction delays: M1 +%lu/-%lu us, M2 +%lu/-%lu us\n",
+                  stepRates.getDelay(1, 1), stepRates.getDelay(1, -1),
+                  stepRates.getDelay(2, 1), stepRates.getDelay(2, -1));
+}
+
+// ============================================================================
+// Backlash
+// ============================================================================
+
+static void saveBacklash() {
+    TIMING_SITE("nvs save");
+    prefs.begin("motors", false);
+    prefs.putUShort("bl1", motors.getBacklash(1));
+    prefs.putUShort("bl2", motors.getBacklash(2));
+    prefs.end();
+}
+
+void loadBacklash() {
+    prefs.begin("motors", true);
+    motors.setBacklash(1, prefs.getUShort("bl1", 0));
+    motors.setBacklash(2, prefs.getUShort("bl2", 0));
+    prefs.end();
+}
+
+// Load the screw of one motor upward, then reverse in increments. After
+// each, the settled tilt change is converted to the steps that actually
+// moved the leg (projection on the plant gains). Past the dead band that
+// follows the commanded steps along a line; where the line leaves zero is
+// the backlash. Returns -1 if the tilt did not follow.
+static long measureBacklash(uint8_t m) {
+    float gp = m == 1 ? PLANT_M1_PITCH_PER_STEP : PLANT_M2_PITCH_PER_STEP;
+    float gr = m == 1 ? PLANT_M1_ROLL_PER_STEP : PLANT_M2_ROLL_PER_STEP;
+    const int n = BACKLASH_CAL_INCREMENTS;
+    float commanded[n];
+    float moved[n];
+
+    motors.moveBy(m == 1 ? BACKLASH_CAL_PRELOAD : 0, m == 2 ? BACKLASH_CAL_PRELOAD : 0);
+    float p0, r0;
+    settleIMU(p0, r0);
+
+    for (int k = 0; k < n; k++) {
+        float p, r;
+        motors.moveBy(m == 1 ? -BACKLASH_CAL_INCREMENT : 0, m == 2 ? -BACKLASH_CAL_INCREMENT : 0);
+        settleIMU(p, r);
+        commanded[k] = (float)(k + 1) * BACKLASH_CAL_INCREMENT;
+        moved[k] = -((p - p0) * gp + (r - r0) * gr) / (gp * gp + gr * gr);
+        Serial.printf("[BACKLASH] M%u -%4.0f steps: moved %.0f\n", m, commanded[k], moved[k]);
+    }
+
+    // Back to where the calibration started
+    long back = (long)n * BACKLASH_CAL_INCREMENT - BACKLASH_CAL_PRELOAD;
+    motors.moveBy(m == 1 ? back : 0, m == 2 ? back : 0);
+
+    // Least-squares line through the second half (past the dead band)
+    float sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int count = 0;
+    for (int k = n / 2; k < n; k++) {
+        sx += commanded[k];
+        sy += moved[k];
+        sxx += commanded[k] * commanded[k];
+        sxy += commanded[k] * moved[k];
+        count++;
+    }
+    float slope = (count * sxy - sx * sy) / (count * sxx - sx * sx);
+    float offset = (sy - slope * sx) / count;
+    if (slope < 0.5f) return -1;
+    return constrain(lroundf(-offset / slope), 0L, (long)BACKLASH_MAX_STEPS);
+}
+
+// backlash cal: measure both motors (take-up off while measuring)
+static void calibrateBacklash() {
+    TIMING_SITE("backlash cal");
+    Serial.printf("[BACKLASH] Measuring (%d x %d reverse steps, %d ms settle)...\n",
+                  BACKLASH_CAL_INCREMENTS, BACKLASH_CAL_INCREMENT, STALL_SETTLE_MS);
+
+    for (uint8_t m = 1; m <= 2; m++) {
+        uint16_t previous = motors.getBacklash(m);
+        motors.setBacklash(m, 0);
+        long b = measureBacklash(m);
+        if (b < 0) {
+            Serial.printf("[BACKLASH] M%u: tilt did not follow the steps, keeping %u\n", m, previous);
+            motors.setBacklash(m, previous);
         } else {
-            Serial.println("Invalid speed. Use 1-15 RPM.");
+            motors.setBacklash(m, (uint16_t)b);
+        }
+    }
+
+    motors.hold();
+    saveBacklash();
+}
+
+// backlash [cal | <m1> <m2>] - take-up steps on direction reversal
+void handleBacklashCommand(const CommandArgs& args) {
+    if (args.is(0, "cal")) {
+        calibrateBacklash();
+    } else if (args.has(1)) {
+        long b1, b2;
+        if (!args.getInt(0, b1) || !args.getInt(1, b2) || b1 < 0 || b2 < 0 ||
+            b1 > BACKLASH_MAX_STEPS || b2 > BACKLASH_MAX_STEPS) {
+            Serial.printf("Usage: backlash [cal | <m1> <m2>] (0-%d steps)\n", BACKLASH_MAX_STEPS);
+            return;
+        }
+        motors.setBacklash(1, (uint16_t)b1);
+        motors.setBacklash(2, (uint16_t)b2);
+        saveBacklash();
+    }
+
+    Serial.printf("[BACKLASH] Take-up: M1 %u steps, M2 %u steps\n",
+                  motors.getBacklash(1), motors.getBacklash(2));
+}
+
+// ============================================================================
+// Gain Schedule
+// ============================================================================
+
+static_assert(DASH_SCHEDULE_POINTS == GAIN_SCHEDULE_POINTS, "Dashboard schedule size");
+
+static void saveSchedule() {
+    TIMING_SITE("nvs save");
+    const GainSchedule& s = leveling.getSchedule();
+    prefs.begin("leveling", false);
+    prefs.putBytes("sched", &s, sizeof(s));
+    prefs.end();
+}
+
+void loadSchedule() {
+    GainSchedule s;
+    prefs.begin("leveling", true);
+    bool stored = prefs.getBytesLength("sched") == sizeof(s) && prefs.getBytes("sched", &s, sizeof(s)) == sizeof(s);
+    prefs.end();
+    if (stored && !leveling.setSchedule(s)) {
+        Serial.println("[SCHED] Stored gain schedule invalid, using defaults");
+    }
+}
+
+static void printScheduleRow(const char* name, const float* keys, const float* scales) {
+    Serial.printf("[SCHED] %s", name);
+    for (int i = 0; i < GAIN_SCHEDULE_POINTS; i++) {
+        Serial.printf("  %g:%.2f", keys[i], scales[i]);
+    }
+    Serial.println();
+}
+
+// {"t":"sched","ok":1,"e":[[0.5,0.6],...],"p":[[0,1.0],...]} - pairs of
+// breakpoint and scale per table; ok 0 if the last edit was rejected
+void sendSchedule(uint32_t clientId, bool ok) {
+    const GainSchedule& s = leveling.getSchedule();
+    char buf[WS_MSG_MAX_LEN];
+    int len = snprintf(buf, sizeof(buf), "{\"t\":\"sched\",\"ok\":%d,\"e\":[", ok ? 1 : 0);
+    for (int i = 0; i < GAIN_SCHEDULE_POINTS; i++) {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s[%g,%.2f]", i ? "," : "",
+                        s.errorDeg[i], s.errorScale[i]);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "],\"p\":[");
+    for (int i = 0; i < GAIN_SCHEDULE_POINTS; i++) {
+        len += snprintf(buf + len, sizeof(buf) - len, "%s[%.0f,%.2f]", i ? "," : "",
+                        s.position[i], s.positionScale[i]);
+    }
+    len += snprintf(buf + len, sizeof(buf) - len, "]}");
+    if (len < (int)sizeof(buf)) {
+        dashboard.sendText(clientId, buf, len);
+    }
+}
+
+// Dashboard edit of one table (0 = error, 1 = position), or report only
+void setScheduleTable(uint32_t clientId, int table, const float* keys, const float* scales) {
+    bool ok = true;
+    if (table == 0 || table == 1) {
+        GainSchedule s = leveling.getSchedule();
+        memcpy(table == 0 ? s.errorDeg : s.position, keys, sizeof(s.errorDeg));
+        memcpy(table == 0 ? s.errorScale : s.positionScale, scales, sizeof(s.errorScale));
+        ok = leveling.setSchedule(s);
+        if (ok) saveSchedule();
+    }
+    sendSchedule(clientId, ok);
+}
+
+// sched [reset | e|p <s1> <s2> <s3> <s4>] - show the gain schedule, restore
+// the defaults, or set the scales of the error / position table (both
+// modes; breakpoints are edited from the dashboard)
+void handleScheduleCommand(const CommandArgs& args) {
+    if (args.is(0, "reset")) {
+        leveling.setSchedule(LevelingController::defaultSchedule());
+        saveSchedule();
+    } else if (args.is(0, "e") || args.is(0, "p")) {
+        GainSchedule s = leveling.getSchedule();
+        float* scales = args.is(0, "e") ? s.errorScale : s.positionScale;
+        for (int i = 0; i < GAIN_SCHEDULE_POINTS; i++) {
+            if (!args.getFloat(i + 1, scales[i])) {
+                Serial.println("Usage: sched e|p <s1> <s2> <s3> <s4>");
+                return;
+            }
+        }
+        if (!leveling.setSchedule(s)) {
+            Serial.printf("[SCHED] Scales must be 0-%.0f\n", GAIN_SCHED_MAX_SCALE);
+            return;
+        }
+        saveSchedule();
+    }
+
+    const GainSchedule& s = leveling.getSchedule();
+    printScheduleRow("|error| deg:", s.errorDeg, s.errorScale);
+    printScheduleRow("position:  ", s.position, s.positionScale);
+}
+
+// ============================================================================
+// Dashboard Requests
+// ============================================================================
+
+// Dashboard callbacks run on the async_tcp task. prefs (NVS), the
+// controller's data and the deferred log (single producer) are used by
+// loop() too, so callbacks post the work here and loop() does it.
+static volatile bool gainsSavePending = false;
+
+// Last state requested; a newer one replaces one not yet taken
+static portMUX_TYPE stateRequestMux = portMUX_INITIALIZER_UNLOCKED;
+static bool stateRequestPending = false;
+static SystemState stateRequest = SystemState::IDLE;
+
+// One schedule edit at a time; a newer one replaces one not yet taken
+static portMUX_TYPE scheduleRequestMux = portMUX_INITIALIZER_UNLOCKED;
+static bool scheduleRequestPending = false;
+static uint32_t scheduleRequestClient = 0;
+static int scheduleRequestTable = -1;
+static float scheduleRequestKeys[GAIN_SCHEDULE_POINTS];
+static float scheduleRequestScales[GAIN_SCHEDULE_POINTS];
+
+void requestSaveGains() {
+    gainsSavePending = true;
+}
+
+void requestStateChange(SystemState state) {
+    portENTER_CRITICAL(&stateRequestMux);
+    stateRequestPending = true;
+    stateRequest = state;
+    portEXIT_CRITICAL(&stateRequestMux);
+}
+
+void requestScheduleTable(uint32_t clientId, int table, const float* keys, const float* scales) {
+    portENTER_CRITICAL(&scheduleRequestMux);
+    scheduleRequestPending = true;
+    scheduleRequestClient = clientId;
+    scheduleRequestTable = table;
+    if (table == 0 || table == 1) {
+        memcpy(scheduleRequestKeys, keys, sizeof(scheduleRequestKeys));
+        memcpy(scheduleRequestScales, scales, sizeof(scheduleRequestScales));
+    }
+    portEXIT_CRITICAL(&scheduleRequestMux);
+}
+
+void serviceDashboardRequests() {
+    if (gainsSavePending) {
+        gainsSavePending = false;
+        saveGains();
+    }
+
+    portENTER_CRITICAL(&stateRequestMux);
+    bool stateChange = stateRequestPending;
+    SystemState state = stateRequest;
+    stateRequestPending = false;
+    portEXIT_CRITICAL(&stateRequestMux);
+    if (stateChange) changeState(state);
+
+    float keys[GAIN_SCHEDULE_POINTS];
+    float scales[GAIN_SCHEDULE_POINTS];
+    portENTER_CRITICAL(&scheduleRequestMux);
+    bool schedule = scheduleRequestPending;
+    uint32_t clientId = scheduleRequestClient;
+    int table = scheduleRequestTable;
+    memcpy(keys, scheduleRequestKeys, sizeof(keys));
+    memcpy(scales, scheduleRequestScales, sizeof(scales));
+    scheduleRequestPending = false;
+    portEXIT_CRITICAL(&scheduleRequestMux);
+    if (schedule) setScheduleTable(clientId, table, keys, scales);
+}
+
+// ============================================================================
+// Relay Auto-Tune
+// ============================================================================
+
+static_assert(AUTOTUNE_RELAY_STEPS <= MAX_CORRECTION_STEPS, "Relay output would be clipped");
+
+static uint8_t tuneAxis = 0;                // 0 = not running, 1 = pitch, 2 = roll
+static TuneRule tuneRule = TuneRule::SIMC;
+static float tuneKu[2];                     // Per axis, pitch first
+static float tuneTu[2];
+static bool tuneReply = false;              // Started from the dashboard
+static uint32_t tuneClient = 0;
+static unsigned long tuneLastIMUTime = 0;
+static unsigned long tuneLastControlTime = 0;
+
+// Dashboard requests, posted from the async_tcp task and taken by
+// serviceAutoTune() in loop() (settleIMU() and the motors belong to loop())
+static portMUX_TYPE tuneRequestMux = portMUX_INITIALIZER_UNLOCKED;
+static bool tuneStartPending = false;
+static bool tuneStopPending = false;
+static TuneRule tuneRequestRule = TuneRule::SIMC;
+static uint32_t tuneRequestClient = 0;
+
+// Gains are kept in NVS whichever way they were set
+void saveGains() {
+    TIMING_SITE("nvs save");
+    prefs.begin("leveling", false);
+    prefs.putFloat("kpP", config.kpPitch);
+    prefs.putFloat("kiP", config.kiPitch);
+    prefs.putFloat("kpR", config.kpRoll);
+    prefs.putFloat("kiR", config.kiRoll);
+    prefs.end();
+}
+
+void loadGains() {
+    prefs.begin("leveling", true);
+    config.kpPitch = prefs.getFloat("kpP", config.kpPitch);
+    config.kiPitch = prefs.getFloat("kiP", config.kiPitch);
+    config.kpRoll = prefs.getFloat("kpR", config.kpRoll);
+    config.kiRoll = prefs.getFloat("kiR", config.kiRoll);
+    prefs.end();
+}
+
+static const char* tuneAxisName(uint8_t axis) {
+    return axis == 1 ? "pitch" : "roll";
+}
+
+// Progress goes to the console and to the dashboard terminals
+static void tuneMessage(const char* fmt, ...) {
+    char msg[128];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    Serial.println(msg);
+    dashboard.sendLog(msg);
+}
+
+static void endAutoTune() {
+    tuneAxis = 0;
+    motors.hold();
+}
+
+static void beginTuneAxis(uint8_t axis) {
+    float pitch, roll;
+    settleIMU(pitch, roll);
+    float center = axis == 1 ? pitch : roll;
+    tuneMessage("[TUNE] %s: relay +/-%d steps around %.2f deg...", tuneAxisName(axis), AUTOTUNE_RELAY_STEPS, center);
+    relayTuner.begin(millis(), center, AUTOTUNE_RELAY_STEPS / leveling.getStepsPerDegree(), AUTOTUNE_HYSTERESIS_DEG);
+    tuneAxis = axis;  // Only now is there a running experiment to service
+}
+
+// {"t":"gains","kpP":..,"kiP":..,"kpR":..,"kiR":..} - fills the Settings card
+static void sendTunedGains() {
+    char buf[WS_MSG_MAX_LEN];
+    int len = snprintf(buf, sizeof(buf), "{\"t\":\"gains\",\"kpP\":%.3f,\"kiP\":%.4f,\"kpR\":%.3f,\"kiR\":%.4f}",
+                       config.kpPitch, config.kiPitch, config.kpRoll, config.kiRoll);
+    if (len < (int)sizeof(buf)) {
+        dashboard.sendText(tuneClient, buf, len);
+    }
+}
+
+static void applyTunedGains() {
+    RelayTuner::computeGains(tuneRule, tuneKu[0], tuneTu[0], config.kpPitch, config.kiPitch);
+    RelayTuner::computeGains(tuneRule, tuneKu[1], tuneTu[1], config.kpRoll, config.kiRoll);
+    leveling.setPitchGains(config.kpPitch, config.kiPitch);
+    leveling.setRollGains(config.kpRoll, config.kiRoll);
+    saveGains();
+    tuneMessage("[TUNE] %s gains saved: pitch Kp %.2f Ki %.4f, roll Kp %.2f Ki %.4f",
+                RelayTuner::ruleName(tuneRule), config.kpPitch, config.kiPitch, config.kpRoll, config.kiRoll);
+    if (tuneReply) sendTunedGains();
+}
+
+void startAutoTune(TuneRule rule, bool fromDashboard, uint32_t clientId) {
+    if (tuneAxis) {
+        tuneMessage("[TUNE] Already running ('tune stop' to cancel)");
+        return;
+    }
+    testModeMotor1Continuous = false;
+    testModeMotor2Continuous = false;
+    planner.stop();
+
+    tuneRule = rule;
+    tuneReply = fromDashboard;
+    tuneClient = clientId;
+    tuneMessage("[TUNE] Auto-tune (%s): pitch, then roll, %d cycles each",
+                RelayTuner::ruleName(rule), AUTOTUNE_CYCLES);
+    beginTuneAxis(1);
+}
+
+void stopAutoTune() {
+    portENTER_CRITICAL(&tuneRequestMux);
+    tuneStartPending = false;
+    tuneStopPending = false;
+    portEXIT_CRITICAL(&tuneRequestMux);
+    if (!tuneAxis) return;
+    relayTuner.cancel();
+    endAutoTune();
+    tuneMessage("[TUNE] Cancelled, gains unchanged");
+}
+
+void requestAutoTune(TuneRule rule, uint32_t clientId) {
+    portENTER_CRITICAL(&tuneRequestMux);
+    tuneStartPending = true;
+    tuneRequestRule = rule;
+    tuneRequestClient = clientId;
+    portEXIT_CRITICAL(&tuneRequestMux);
+}
+
+void requestStopAutoTune() {
+    portENTER_CRITICAL(&tuneRequestMux);
+    tuneStartPending = false;
+    tuneStopPending = true;
+    portEXIT_CRITICAL(&tuneRequestMux);
+}
+
+// One relay step per control interval, with the IMU at its usual rate.
+// The relay output is an axis correction mapped to the motors as in
+// LevelingController::calculate(): pitch moves both legs together (M2
+// counts reversed), roll moves them apart.
+void serviceAutoTune(unsigned long now) {
+    portENTER_CRITICAL(&tuneRequestMux);
+    bool start = tuneStartPending;
+    bool stop = tuneStopPending;
+    TuneRule rule = tuneRequestRule;
+    uint32_t clientId = tuneRequestClient;
+    tuneStartPending = false;
+    tuneStopPending = false;
+    portEXIT_CRITICAL(&tuneRequestMux);
+    if (stop) stopAutoTune();
+    if (start) startAutoTune(rule, true, clientId);
+
+    if (!tuneAxis) return;
+
+    if (now - tuneLastIMUTime >= IMU_UPDATE_INTERVAL_MS) {
+        tuneLastIMUTime = now;
+        updateIMU();
+    }
+    if (now - tuneLastControlTime < LEVEL_CHECK_INTERVAL_MS) return;
+    tuneLastControlTime = now;
+
+    float u = relayTuner.update(now, tuneAxis == 1 ? imu.getPitch() : imu.getRoll());
+    if (relayTuner.isRunning()) {
+        int steps = lroundf(u * leveling.getStepsPerDegree());
+        MotorCorrection correction;
+        correction.motor1Steps = tuneAxis == 1 ? steps : -steps;
+        correction.motor2Steps = -steps;
+        MotorCorrection applied = motors.applyCorrection(correction);
+        if (applied.motor1Steps != correction.motor1Steps || applied.motor2Steps != correction.motor2Steps) {
+            relayTuner.cancel();
+            tuneMessage("[TUNE] %s: leg at a position limit, gains unchanged", tuneAxisName(tuneAxis));
+            endAutoTune();
         }
         return;
     }
 
-    // ==================== System Commands ====================
+    if (relayTuner.getState() != RelayTuner::State::DONE) {
+        const char* reason = relayTuner.getFailure();
+        tuneMessage("[TUNE] %s: %s, gains unchanged", tuneAxisName(tuneAxis), reason ? reason : "not running");
+        endAutoTune();
+        return;
+    }
+
+    int i = tuneAxis - 1;
+    tuneKu[i] = relayTuner.getUltimateGain();
+    tuneTu[i] = relayTuner.getUltimatePeriod();
+    tuneMessage("[TUNE] %s: Ku %.2f, Tu %.2f s (amplitude %.3f deg)",
+                tuneAxisName(tuneAxis), tuneKu[i], tuneTu[i], relayTuner.getAmplitude());
+
+    if (tuneAxis == 1) {
+        beginTuneAxis(2);
+    } else {
+        endAutoTune();
+        applyTunedGains();
+    }
+}
 
-    if (input.equalsIgnoreCase("info") || input.equalsIgnoreCase("pins")) {
-        printPinInfo();
+// tune [zn|tl|simc|stop] - relay auto-tune of both axes, then apply and
+// save the PI gains from the chosen rule (default simc)
+void handleTuneCommand(const CommandArgs& args) {
+    if (args.is(0, "stop")) {
+        stopAutoTune();
+        return;
+    }
+    TuneRule rule = TuneRule::SIMC;
+    if (args.has(0) && !RelayTuner::parseRule(args.str(0), rule)) {
+        Serial.println("Usage: tune [zn|tl|simc|stop]");
         return;
     }
+    startAutoTune(rule, false, 0);
+}
+
+// ============================================================================
+// Binary Serial Requests
+// ============================================================================
+
+static void sendLinkPositions(uint8_t reqId) {
+    LinkPositions pos;
+    pos.m1pos = motors.getPosition1();
+    pos.m2pos = motors.getPosition2();
+    pos.minPos = motors.getMinPosition();
+    pos.maxPos = motors.getMaxPosition();
+    serialLink.sendFrame(LINK_RSP_POSITIONS, reqId, &pos, sizeof(pos));
+}
+
+// Moves, position and limit changes bypass the controller: only while
+// nothing else drives the legs
+static bool linkMotorsAllowed() {
+    return currentState == SystemState::IDLE || currentState == SystemState::TEST_MODE;
+}
+
+// Requests run to completion before the response is sent, so a response
+// also tells the host that any console output of the request is complete
+void handleLinkRequest(uint8_t type, uint8_t reqId, const uint8_t* body, size_t len) {
+    switch (type) {
+        case LINK_REQ_PING: {
+            LinkPong pong;
+            pong.uptime = millis();
+            pong.state = (uint8_t)currentState;
+            serialLink.sendFrame(LINK_RSP_PONG, reqId, &pong, sizeof(pong));
+            break;
+        }
+
+        case LINK_REQ_POSITIONS:
+            sendLinkPositions(reqId);
+            break;
+
+        case LINK_REQ_MOVE: {
+            if (len < sizeof(LinkMove)) { serialLink.sendError(reqId, LINK_ERR_LENGTH); break; }
+            if (!linkMotorsAllowed()) { serialLink.sendError(reqId, LINK_ERR_STATE); break; }
+            LinkMove move;
+            memcpy(&move, body, sizeof(move));
+            TIMING_SITE("link move");
+            motors.moveBoth(move.m1steps, move.m2steps);
+            sendLinkPositions(reqId);
+            break;
+        }
+
+        case LINK_REQ_SET_POS: {
+            if (len < sizeof(LinkSetPosition)) { serialLink.sendError(reqId, LINK_ERR_LENGTH); break; }
+            if (!linkMotorsAllowed()) { serialLink.sendError(reqId, LINK_ERR_STATE); break; }
+            LinkSetPosition set;
+            memcpy(&set, body, sizeof(set));
+            if (set.motors & 0x01) motors.setPosition1(set.value);
+            if (set.motors & 0x02) motors.setPosition2(set.value);
+            saveMotorPositions();
+            sendLinkPositions(reqId);
+            break;
+        }
+
+        case LINK_REQ_LIMITS:
+            if (len < 1) { serialLink.sendError(reqId, LINK_ERR_LENGTH); break; }
+            if (!linkMotorsAllowed()) { serialLink.sendError(reqId, LINK_ERR_STATE); break; }
+            if (body[0]) {
+                motors.setLimits(MOTOR_MIN_POSITION, MOTOR_MAX_POSITION);
+            } else {
+                motors.setLimits(-99999, 99999);
+            }
+            sendLinkPositions(reqId);
+            break;
 
-    // Unknown command
-    Serial.printf("Unknown command: '%s'. Type 'help' for menu.\n", input.c_str());
+        case LINK_REQ_STREAM: {
+            if (len < 2) { serialLink.sendError(reqId, LINK_ERR_LENGTH); break; }
+            uint16_t hz = body[0] | (body[1] << 8);
+            if (hz > STREAM_SERIAL_MAX_HZ) { serialLink.sendError(reqId, LINK_ERR_RANGE); break; }
+            setSerialStream(hz);
+            serialLink.sendAck(reqId);
+            break;
+        }
+
+        case LINK_REQ_TEXT: {
+            char line[SERIAL_LINE_MAX];
+            if (len == 0 || len >= sizeof(line)) { serialLink.sendError(reqId, LINK_ERR_RANGE); break; }
+            memcpy(line, body, len);
+            line[len] = '\0';
+            handleSerialCommands(line);
+            serialLink.sendAck(reqId);
+            break;
+        }
+
+        default:
+            serialLink.sendError(reqId, LINK_ERR_UNKNOWN);
+            break;
+    }
 }
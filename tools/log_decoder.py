@@ -0,0 +1,109 @@
+"""
+Self-Leveling Platform - Binary log record decoding
+
+Expands the EVT_LOG frames sent by the firmware after `log bin`
+(lib/DeferredLog/DeferredLog.h). A record carries only a format ID and
+raw 32-bit argument words; the format strings are read from
+include/log_formats.h, so the firmware and this decoder share one table.
+
+Record: header (8 bytes) followed by `argc` words, little-endian.
+
+Standalone: python log_decoder.py COM4 [baud]
+"""
+
+import os
+import re
+import struct
+import sys
+
+EVT_LOG = 0xA1
+
+HEADER = struct.Struct("<HBBI")                # id, argc, reserved, time_us
+
+# SystemState order in include/types.h (%S)
+STATE_NAMES = [
+    "IDLE", "INITIALIZING", "WAIT_FOR_STABLE", "LEVELING",
+    "LEVEL_OK", "ERROR", "TEST_MODE", "SAFE_SHUTDOWN",
+]
+
+FORMATS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                         "..", "include", "log_formats.h")
+
+_ENTRY = re.compile(r'X\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+_SPEC = re.compile(r"%([-+ #0-9.]*)(?:hh|h|ll|l)?([diuxXcfFeEgGsS%])")
+
+
+def load_formats(path=FORMATS_H):
+    """Returns [(name, format)] in ID order."""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    return [(name, bytes(fmt, "utf-8").decode("unicode_escape"))
+            for name, fmt in _ENTRY.findall(text)]
+
+
+FORMATS = load_formats()
+
+
+def _expand(fmt, words):
+    it = iter(words)
+
+    def convert(m):
+        flags, conv = m.group(1), m.group(2)
+        if conv == "%":
+            return "%"
+        w = next(it, 0)
+        if conv in "di":
+            return ("%" + flags + "d") % struct.unpack("<i", struct.pack("<I", w))[0]
+        if conv in "uxXc":
+            return ("%" + flags + conv) % w
+        if conv in "fFeEgG":
+            return ("%" + flags + conv) % struct.unpack("<f", struct.pack("<I", w))[0]
+        if conv == "S":
+            name = STATE_NAMES[w] if w < len(STATE_NAMES) else "UNKNOWN"
+            return ("%" + flags + "s") % name
+        # %s records a firmware pointer; the text is not in the record
+        return f"<str@0x{w:08X}>"
+
+    return _SPEC.sub(convert, fmt)
+
+
+def decode_record(body):
+    """Decode one EVT_LOG body. Returns (time_us, text), or None if malformed."""
+    if len(body) < HEADER.size:
+        return None
+    fmt_id, argc, _, time_us = HEADER.unpack_from(body)
+    if len(body) < HEADER.size + argc * 4:
+        return None
+    words = struct.unpack_from(f"<{argc}I", body, HEADER.size)
+    if fmt_id >= len(FORMATS):
+        return time_us, f"[LOG] unknown record {fmt_id}"
+    return time_us, _expand(FORMATS[fmt_id][1], words)
+
+
+def main():
+    import serial
+    from platform_link import FrameDemux
+
+    if len(sys.argv) < 2:
+        print(f"Usage: {sys.argv[0]} PORT [BAUD]")
+        return 1
+    baud = int(sys.argv[2]) if len(sys.argv) > 2 else 115200
+    demux = FrameDemux()
+    with serial.Serial(sys.argv[1], baud, timeout=0.05) as ser:
+        ser.write(b"log bin\n")
+        try:
+            while True:
+                for item in demux.feed(ser.read(ser.in_waiting or 1)):
+                    if item[0] == "text":
+                        sys.stdout.write(item[1])
+                    elif item[1] == EVT_LOG:
+                        record = decode_record(item[3])
+                        if record:
+                            print(f"{record[0] / 1e6:12.6f}  {record[1]}")
+        except KeyboardInterrupt:
+            ser.write(b"log text\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
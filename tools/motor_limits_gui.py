@@ -2,16 +2,18 @@
 """Motor Limits Setup GUI.
 
 Move motors to their physical extents and set IN/OUT limits.
-Connects via serial in test mode.
+Connects via serial in test mode using the binary protocol
+(platform_link.py), so every move returns the firmware's positions as
+soon as it has finished.
 """
 import tkinter as tk
 from tkinter import ttk, messagebox
-import serial
 import serial.tools.list_ports
 import threading
-import re
 import time
 
+from platform_link import PlatformLink, LinkError
+
 
 class MotorLimitsGUI:
     def __init__(self, root):
@@ -19,10 +21,9 @@ class MotorLimitsGUI:
         self.root.title("Motor Limits Setup")
         self.root.resizable(True, True)
         self.root.minsize(500, 600)
-        self.ser = None
+        self.link = PlatformLink(on_text=self._on_text)
         self.connected = False
         self.busy = False
-        self.serial_lock = threading.Lock()
 
         # Limits storage
         self.m1_pos = tk.IntVar(value=0)
@@ -171,6 +172,32 @@ class MotorLimitsGUI:
         self.status_label.config(foreground="red")
         self.busy = False
 
+    def _on_text(self, line):
+        line = line.strip()
+        if line:
+            self._log(f"<< {line}")
+
+    def _show_positions(self, positions):
+        """Show positions reported by the firmware (main thread)."""
+        m1, m2 = positions[0], positions[1]
+        self.m1_pos.set(m1)
+        self.m2_pos.set(m2)
+        self.busy = False
+        self.status_msg.set(f"Ready  |  M1:{m1}  M2:{m2}")
+        self.status_label.config(foreground="green")
+
+    def _run(self, label, func):
+        """Run a link request off the UI thread and show the resulting positions."""
+        def worker():
+            try:
+                self._log(f">> {label}")
+                positions = func()
+                self.root.after(0, lambda: self._show_positions(positions))
+            except (LinkError, OSError) as e:
+                self._log(f"ERROR: {e}")
+                self.root.after(0, lambda: self._on_serial_error(str(e)))
+        threading.Thread(target=worker, daemon=True).start()
+
     # ==================== Connection ====================
 
     def _refresh_ports(self):
@@ -188,23 +215,6 @@ class MotorLimitsGUI:
         else:
             self._connect()
 
-    def _send_direct(self, cmd, wait=0.5):
-        """Send a command directly and return response lines. Thread-safe via lock."""
-        if not self.ser or not self.ser.is_open:
-            return []
-        with self.serial_lock:
-            self.ser.reset_input_buffer()
-            self._log(f">> {cmd}")
-            self.ser.write(f"{cmd}\n".encode())
-            time.sleep(wait)
-            lines = []
-            while self.ser.in_waiting:
-                line = self.ser.readline().decode("utf-8", errors="replace").strip()
-                if line:
-                    lines.append(line)
-                    self._log(f"<< {line}")
-            return lines
-
     def _connect(self):
         port = self.port_var.get()
         if not port:
@@ -217,52 +227,35 @@ class MotorLimitsGUI:
 
         def do_connect():
             try:
-                self.ser = serial.Serial(port, 115200, timeout=0.5)
+                self.link.open(port)
                 self._log(f"Opened {port}, waiting for boot...")
-                time.sleep(3)
-                # Drain boot messages
-                while self.ser.in_waiting:
-                    line = self.ser.readline().decode("utf-8", errors="replace").strip()
-                    if line:
-                        self._log(f"boot: {line}")
-                time.sleep(0.5)
-                while self.ser.in_waiting:
-                    line = self.ser.readline().decode("utf-8", errors="replace").strip()
-                    if line:
-                        self._log(f"boot: {line}")
-
-                # All setup commands sent directly - no worker thread
-                self._send_direct("r", 0.5)
-                self._send_direct("admin", 1.0)
-                self._send_direct("munlock", 0.5)
-                lines = self._send_direct("mpos", 0.5)
-
-                # Parse mpos response
-                found = False
-                for l in lines:
-                    m = re.match(r'\[MPOS\]\s+M1:([-\d]+)\s+M2:([-\d]+)', l)
-                    if m:
-                        def update(m1=int(m.group(1)), m2=int(m.group(2))):
-                            self.m1_pos.set(m1)
-                            self.m2_pos.set(m2)
-                            self.status_msg.set(f"Connected  |  M1:{m1}  M2:{m2}")
-                            self.status_label.config(foreground="green")
-                            self.connected = True
-                            self.connect_btn.config(text="Disconnect")
-                            self._log("Connection verified - test mode active")
-                        self.root.after(0, update)
-                        found = True
-
-                if not found:
-                    def warn():
-                        self.status_msg.set("Connected (no MPOS response)")
-                        self.status_label.config(foreground="orange")
-                        self.connected = True
-                        self.connect_btn.config(text="Disconnect")
-                    self.root.after(0, warn)
-
-            except Exception as e:
+
+                # Opening the port resets the board: ping until it answers
+                deadline = time.time() + 8.0
+                while True:
+                    try:
+                        rtt, _, _ = self.link.ping()
+                        break
+                    except LinkError:
+                        if time.time() > deadline:
+                            raise
+                self._log(f"Link up, round trip {rtt * 1000:.1f} ms")
+
+                self.link.command("r")
+                self.link.command("admin")
+                positions = self.link.set_limits(False)
+
+                def update():
+                    self.connected = True
+                    self.connect_btn.config(text="Disconnect")
+                    self._show_positions(positions)
+                    self.status_msg.set(f"Connected  |  M1:{positions[0]}  M2:{positions[1]}")
+                    self._log("Connection verified - test mode active")
+                self.root.after(0, update)
+
+            except (LinkError, OSError) as e:
                 self._log(f"Connection failed: {e}")
+                self.link.close()
                 def show_err():
                     messagebox.showerror("Connection Error", str(e))
                     self.status_msg.set("Disconnected")
@@ -271,63 +264,19 @@ class MotorLimitsGUI:
 
         threading.Thread(target=do_connect, daemon=True).start()
 
-    def _on_connect_mpos(self, lines):
-        """Verify connection by checking mpos response."""
-        found = False
-        for l in lines:
-            m = re.match(r'\[MPOS\]\s+M1:([-\d]+)\s+M2:([-\d]+)', l)
-            if m:
-                self.m1_pos.set(int(m.group(1)))
-                self.m2_pos.set(int(m.group(2)))
-                found = True
-        if found:
-            self.status_msg.set(f"Connected  |  M1:{self.m1_pos.get()}  M2:{self.m2_pos.get()}")
-            self.status_label.config(foreground="green")
-            self._log("Connection verified - test mode active")
-        else:
-            self.status_msg.set("Connected but no MPOS response!")
-            self.status_label.config(foreground="orange")
-            self._log("WARNING: No [MPOS] in response - may not be in test mode")
-
     def _disconnect(self):
-        if self.ser:
+        if self.link.is_open:
             try:
-                self.ser.write(b"exit\n")
-                time.sleep(0.5)
-                self.ser.close()
-            except:
+                self.link.command("exit")
+            except (LinkError, OSError):
                 pass
-        self.ser = None
+            self.link.close()
         self.connected = False
         self.connect_btn.config(text="Connect")
         self.status_msg.set("Disconnected")
         self.status_label.config(foreground="red")
         self._log("Disconnected")
 
-    # ==================== Response Handlers (main thread) ====================
-
-    def _on_mpos_response(self, lines):
-        for l in lines:
-            m = re.match(r'\[MPOS\]\s+M1:([-\d]+)\s+M2:([-\d]+)', l)
-            if m:
-                self.m1_pos.set(int(m.group(1)))
-                self.m2_pos.set(int(m.group(2)))
-        self.busy = False
-        self.status_msg.set(f"Ready  |  M1:{self.m1_pos.get()}  M2:{self.m2_pos.get()}")
-        self.status_label.config(foreground="green")
-
-    def _on_move_done(self, motor_num, steps):
-        """Update position client-side instead of querying serial."""
-        def handler(lines):
-            if motor_num == 1:
-                self.m1_pos.set(self.m1_pos.get() + steps)
-            else:
-                self.m2_pos.set(self.m2_pos.get() + steps)
-            self.busy = False
-            self.status_msg.set(f"Ready  |  M1:{self.m1_pos.get()}  M2:{self.m2_pos.get()}")
-            self.status_label.config(foreground="green")
-        return handler
-
     # ==================== Commands ====================
 
     def _move_both(self, direction):
@@ -340,26 +289,9 @@ class MotorLimitsGUI:
         steps = self.step_amount.get() * direction
         # Motor 2 is physically reversed
         steps_m2 = -steps
-        wait = max(0.5, abs(steps) * 0.003)
         self.status_msg.set(f"Moving both motors {steps:+d} steps...")
         self.status_label.config(foreground="orange")
-
-        def do_move():
-            try:
-                self._send_direct(f"m1 {steps}", wait)
-                self._send_direct(f"m2 {steps_m2}", wait)
-                def update_ui():
-                    self.m1_pos.set(self.m1_pos.get() + steps)
-                    self.m2_pos.set(self.m2_pos.get() + steps)  # Display matches M1 direction
-                    self.busy = False
-                    self.status_msg.set(f"Ready  |  M1:{self.m1_pos.get()}  M2:{self.m2_pos.get()}")
-                    self.status_label.config(foreground="green")
-                self.root.after(0, update_ui)
-            except Exception as e:
-                self._log(f"ERROR: {e}")
-                self.root.after(0, lambda: self._on_serial_error(str(e)))
-
-        threading.Thread(target=do_move, daemon=True).start()
+        self._run(f"move M1 {steps:+d} M2 {steps_m2:+d}", lambda: self.link.move(steps, steps_m2))
 
     def _move_motor(self, motor_num, direction):
         if not self.connected:
@@ -369,41 +301,15 @@ class MotorLimitsGUI:
             return
         self.busy = True
         # Motor 2 direction is physically reversed (lead screw orientation)
-        display_direction = direction
         if motor_num == 2:
             direction = -direction
         steps = self.step_amount.get() * direction
-        display_steps = self.step_amount.get() * display_direction
-        wait = max(0.5, abs(steps) * 0.003)
         self.status_msg.set(f"Moving M{motor_num} {steps:+d} steps...")
         self.status_label.config(foreground="orange")
-
-        def do_move():
-            try:
-                cmd = f"m{motor_num} {steps}"
-                self._log(f">> {cmd}")
-                self.ser.reset_input_buffer()
-                self.ser.write(f"{cmd}\n".encode())
-                time.sleep(wait)
-                while self.ser.in_waiting:
-                    line = self.ser.readline().decode("utf-8", errors="replace").strip()
-                    if line:
-                        self._log(f"<< {line}")
-                # Update position client-side
-                def update_ui():
-                    if motor_num == 1:
-                        self.m1_pos.set(self.m1_pos.get() + display_steps)
-                    else:
-                        self.m2_pos.set(self.m2_pos.get() + display_steps)
-                    self.busy = False
-                    self.status_msg.set(f"Ready  |  M1:{self.m1_pos.get()}  M2:{self.m2_pos.get()}")
-                    self.status_label.config(foreground="green")
-                self.root.after(0, update_ui)
-            except Exception as e:
-                self._log(f"ERROR: {e}")
-                self.root.after(0, lambda: self._on_serial_error(str(e)))
-
-        threading.Thread(target=do_move, daemon=True).start()
+        if motor_num == 1:
+            self._run(f"move M1 {steps:+d}", lambda: self.link.move(steps, 0))
+        else:
+            self._run(f"move M2 {steps:+d}", lambda: self.link.move(0, steps))
 
     def _set_limit(self, motor_num, which):
         if motor_num == 1:
@@ -431,28 +337,12 @@ class MotorLimitsGUI:
     def _reset_single_motor(self, motor_num):
         if not self.connected or self.busy:
             return
-        def do_reset():
-            self._send_direct(f"mreset{motor_num}", 0.5)
-            def update_ui():
-                if motor_num == 1:
-                    self.m1_pos.set(0)
-                else:
-                    self.m2_pos.set(0)
-                self.status_msg.set(f"Ready  |  M1:{self.m1_pos.get()}  M2:{self.m2_pos.get()}")
-            self.root.after(0, update_ui)
-        threading.Thread(target=do_reset, daemon=True).start()
+        self._run(f"zero M{motor_num}", lambda: self.link.set_position(0, motors=motor_num))
 
     def _reset_positions(self):
         if not self.connected or self.busy:
             return
-        def do_reset():
-            self._send_direct("mreset", 0.5)
-            def update_ui():
-                self.m1_pos.set(0)
-                self.m2_pos.set(0)
-                self.status_msg.set("Ready  |  M1:0  M2:0")
-            self.root.after(0, update_ui)
-        threading.Thread(target=do_reset, daemon=True).start()
+        self._run("zero both", lambda: self.link.set_position(0))
 
     # ==================== Summary ====================
 
@@ -0,0 +1,306 @@
+"""
+Self-Leveling Platform - Binary serial protocol client
+
+Host side of lib/SerialLink/SerialProtocol.h. Frames share the port with
+the text console:
+
+    0x00, COBS(type, request id, body..., CRC16 LE), 0x00
+
+Responses echo the request id, so several requests can be in flight and
+each caller waits only for its own reply instead of sleeping for a fixed
+time. Text console lines and telemetry batches arrive through callbacks.
+
+    link = PlatformLink()
+    link.open("COM4")
+    m1, m2, lo, hi = link.move(100, -100)
+"""
+
+import struct
+import threading
+import time
+from concurrent.futures import Future, TimeoutError as FutureTimeout
+
+import serial
+
+from log_decoder import EVT_LOG, decode_record
+from telemetry_stream import parse_batch
+
+# Requests (host -> device)
+REQ_PING = 0x01
+REQ_POSITIONS = 0x02
+REQ_MOVE = 0x03
+REQ_SET_POS = 0x04
+REQ_LIMITS = 0x05
+REQ_STREAM = 0x06
+REQ_TEXT = 0x07
+
+# Responses (device -> host)
+RSP_ACK = 0x80
+RSP_PONG = 0x81
+RSP_POSITIONS = 0x82
+RSP_ERROR = 0xFF
+
+# Events (request id 0); EVT_LOG is defined in log_decoder
+EVT_STREAM = 0xA0
+
+ERRORS = {1: "unknown request", 2: "body too short", 3: "argument out of range",
+          4: "not allowed in the current state"}
+
+POSITIONS = struct.Struct("<iiii")
+PONG = struct.Struct("<IB")
+
+
+def crc16(data):
+    """CRC16-CCITT, poly 0x1021, init 0xFFFF."""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_idx = 0
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_idx] = code
+            code_idx = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xFF:
+                out[code_idx] = code
+                code_idx = len(out)
+                out.append(0)
+                code = 1
+    out[code_idx] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    """Decode a COBS block. Returns None if malformed."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            return None
+        out.extend(data[i:i + code - 1])
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(msg_type, req_id, body=b""):
+    payload = bytes([msg_type, req_id]) + body
+    payload += struct.pack("<H", crc16(payload))
+    return b"\x00" + cobs_encode(payload) + b"\x00"
+
+
+class LinkError(Exception):
+    """The device answered with LINK_RSP_ERROR, or did not answer."""
+
+
+class FrameDemux:
+    """Splits received bytes into text lines and decoded frames.
+
+    feed() returns ("text", str) and ("frame", type, req_id, body) items in
+    arrival order. Frames with a bad CRC or encoding are counted in `bad`.
+    """
+
+    def __init__(self):
+        self.bad = 0
+        self.reset()
+
+    def reset(self):
+        self._text = bytearray()
+        self._frame = bytearray()
+        self._in_frame = False
+        self.bad = 0
+
+    def feed(self, data):
+        out = []
+        for b in data:
+            if b == 0:
+                # Zero opens or closes a frame; an empty frame keeps us inside
+                if self._in_frame and self._frame:
+                    item = self._decode(bytes(self._frame))
+                    if item:
+                        out.append(item)
+                    self._in_frame = False
+                else:
+                    self._in_frame = True
+                self._frame.clear()
+            elif self._in_frame:
+                self._frame.append(b)
+            else:
+                self._text.append(b)
+                if b == 0x0A:
+                    out.append(("text", self._text.decode("utf-8", errors="replace")))
+                    self._text.clear()
+        return out
+
+    def _decode(self, block):
+        payload = cobs_decode(block)
+        if payload is None or len(payload) < 4:
+            self.bad += 1
+            return None
+        body, crc = payload[:-2], struct.unpack_from("<H", payload, len(payload) - 2)[0]
+        if crc16(body) != crc:
+            self.bad += 1
+            return None
+        return ("frame", body[0], body[1], body[2:])
+
+
+class PlatformLink:
+    """Request/response client with a background reader thread.
+
+    on_text(line) is called for every console line (binary log records are
+    expanded to lines first) and on_batch(batch) for every telemetry batch,
+    both from the reader thread.
+    """
+
+    def __init__(self, on_text=None, on_batch=None):
+        self.on_text = on_text
+        self.on_batch = on_batch
+        self.ser = None
+        self.demux = FrameDemux()
+        self._pending = {}
+        self._lock = threading.Lock()
+        self._write_lock = threading.Lock()
+        self._next_id = 1
+        self._reader = None
+        self._stop = False
+
+    # ==================== Connection ====================
+
+    def open(self, port, baud=115200):
+        self.ser = serial.Serial(port, baud, timeout=0.05)
+        self.demux.reset()
+        self._stop = False
+        self._reader = threading.Thread(target=self._read_loop, daemon=True)
+        self._reader.start()
+
+    def close(self):
+        self._stop = True
+        if self._reader:
+            self._reader.join(timeout=1.0)
+        if self.ser:
+            self.ser.close()
+            self.ser = None
+        with self._lock:
+            for fut in self._pending.values():
+                fut.set_exception(LinkError("connection closed"))
+            self._pending.clear()
+
+    @property
+    def is_open(self):
+        return self.ser is not None and self.ser.is_open
+
+    def write_text(self, line):
+        """Send a plain console line (no response tracking)."""
+        with self._write_lock:
+            self.ser.write(f"{line}\n".encode())
+
+    # ==================== Requests ====================
+
+    def request_async(self, msg_type, body=b""):
+        """Send a request; returns a Future resolving to (type, body)."""
+        fut = Future()
+        with self._lock:
+            req_id = self._next_id
+            self._next_id = self._next_id % 255 + 1  # 0 is reserved for events
+            old = self._pending.pop(req_id, None)
+            if old:
+                old.set_exception(LinkError("request id reused"))
+            self._pending[req_id] = fut
+        with self._write_lock:
+            self.ser.write(encode_frame(msg_type, req_id, body))
+        return fut
+
+    def request(self, msg_type, body=b"", timeout=1.0):
+        """Send a request and wait for its response body."""
+        try:
+            rsp_type, rsp_body = self.request_async(msg_type, body).result(timeout)
+        except FutureTimeout:
+            raise LinkError(f"no response to request 0x{msg_type:02X}")
+        if rsp_type == RSP_ERROR:
+            code = rsp_body[0] if rsp_body else 0
+            raise LinkError(ERRORS.get(code, f"error {code}"))
+        return rsp_type, rsp_body
+
+    def ping(self):
+        """Returns (round trip seconds, uptime ms, state id)."""
+        start = time.perf_counter()
+        _, body = self.request(REQ_PING)
+        uptime, state = PONG.unpack_from(body)
+        return time.perf_counter() - start, uptime, state
+
+    def positions(self):
+        """Returns (m1, m2, min, max)."""
+        return POSITIONS.unpack_from(self.request(REQ_POSITIONS)[1])
+
+    def move(self, m1_steps, m2_steps, timeout=None):
+        """Move both motors; returns positions once the move has finished."""
+        if timeout is None:
+            # ~3 ms per step at the default speed, plus margin
+            timeout = 1.0 + max(abs(m1_steps), abs(m2_steps)) * 0.005
+        body = struct.pack("<ii", m1_steps, m2_steps)
+        return POSITIONS.unpack_from(self.request(REQ_MOVE, body, timeout)[1])
+
+    def set_position(self, value, motors=0x03):
+        """Set position counters (bit 0 = M1, bit 1 = M2); returns positions."""
+        body = struct.pack("<Bi", motors, value)
+        return POSITIONS.unpack_from(self.request(REQ_SET_POS, body)[1])
+
+    def set_limits(self, locked):
+        """True restores the default position limits, False removes them."""
+        return POSITIONS.unpack_from(self.request(REQ_LIMITS, bytes([1 if locked else 0]))[1])
+
+    def stream(self, hz):
+        """Start the telemetry stream at hz (1-300), or stop it with 0."""
+        self.request(REQ_STREAM, struct.pack("<H", hz))
+
+    def command(self, text, timeout=2.0):
+        """Run a console command; returns once it has completed."""
+        self.request(REQ_TEXT, text.encode(), timeout)
+
+    # ==================== Reader ====================
+
+    def _read_loop(self):
+        while not self._stop:
+            try:
+                data = self.ser.read(self.ser.in_waiting or 1)
+            except Exception as e:
+                if self.on_text and not self._stop:
+                    self.on_text(f"[Error: {e}]\n")
+                time.sleep(0.1)
+                continue
+            for item in self.demux.feed(data):
+                if item[0] == "text":
+                    if self.on_text:
+                        self.on_text(item[1])
+                    continue
+                _, msg_type, req_id, body = item
+                if msg_type == EVT_STREAM:
+                    batch = parse_batch(body)
+                    if batch and self.on_batch:
+                        self.on_batch(batch)
+                    continue
+                if msg_type == EVT_LOG:
+                    record = decode_record(body)
+                    if record and self.on_text:
+                        self.on_text(record[1] + "\n")
+                    continue
+                with self._lock:
+                    fut = self._pending.pop(req_id, None)
+                if fut:
+                    fut.set_result((msg_type, body))
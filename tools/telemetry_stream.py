@@ -0,0 +1,59 @@
+"""
+Self-Leveling Platform - High-rate telemetry decoding
+
+Decodes the binary batches sent by the firmware's `hstream` command
+(lib/TelemetryStream/TelemetryStream.h). On serial they arrive as
+EVT_STREAM frames (see platform_link.py), on the dashboard WebSocket as
+binary messages.
+
+Batch: header (10 bytes) followed by `count` samples (28 bytes each),
+little-endian.
+"""
+
+import struct
+from collections import namedtuple
+
+FRAME_BATCH = 0x10
+BATCH_VERSION = 1
+
+HEADER = struct.Struct("<BBBBIH")              # type, version, count, reserved, seq, rate_hz
+SAMPLE = struct.Struct("<Ihhhhhhhhii")         # time_us, pitch, roll, ax, ay, az, gx, gy, gz, m1, m2
+
+Sample = namedtuple("Sample", "time_us pitch roll ax ay az gx gy gz m1 m2")
+Batch = namedtuple("Batch", "seq rate_hz samples")
+
+
+def parse_batch(payload):
+    """Decode one batch payload. Returns a Batch, or None if malformed."""
+    if len(payload) < HEADER.size:
+        return None
+    ftype, version, count, _, seq, rate_hz = HEADER.unpack_from(payload)
+    if ftype != FRAME_BATCH or version != BATCH_VERSION:
+        return None
+    if len(payload) < HEADER.size + count * SAMPLE.size:
+        return None
+
+    samples = []
+    for i in range(count):
+        t, p, r, ax, ay, az, gx, gy, gz, m1, m2 = SAMPLE.unpack_from(
+            payload, HEADER.size + i * SAMPLE.size)
+        samples.append(Sample(t, p / 1000.0, r / 1000.0,
+                              ax / 10000.0, ay / 10000.0, az / 10000.0,
+                              gx / 100.0, gy / 100.0, gz / 100.0, m1, m2))
+    return Batch(seq, rate_hz, samples)
+
+
+class SequenceTracker:
+    """Counts samples lost between batches from their sequence numbers."""
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self):
+        self._next_seq = None
+        self.lost = 0
+
+    def update(self, batch):
+        if self._next_seq is not None and batch.seq != self._next_seq:
+            self.lost += (batch.seq - self._next_seq) & 0xFFFFFFFF
+        self._next_seq = (batch.seq + len(batch.samples)) & 0xFFFFFFFF
@@ -15,9 +15,16 @@ import queue
 import time
 import re
 import math
+from collections import deque
+
+from log_decoder import EVT_LOG, decode_record
+from platform_link import FrameDemux, EVT_STREAM
+from telemetry_stream import parse_batch, SequenceTracker
 
 
 class TestModeGUI:
+    HS_WINDOW = 2000  # Samples shown in the high-rate plot
+
     def __init__(self, root):
         self.root = root
         self.root.title("Self-Leveling Platform - Test Mode")
@@ -36,6 +43,9 @@ class TestModeGUI:
         self.stop_thread = False
         self.message_queue = queue.Queue()
         self.send_queue = queue.Queue()
+        self.batch_queue = queue.Queue()
+        self.demux = FrameDemux()
+        self.hs_tracker = SequenceTracker()
 
         # Track toggle states
         self.imu_streaming = False
@@ -43,6 +53,13 @@ class TestModeGUI:
         self.motor1_continuous = False
         self.motor2_continuous = False
         self.led_cycling = False
+        self.hs_streaming = False
+
+        # High-rate stream plot data (last HS_WINDOW samples)
+        self.hs_pitch = deque(maxlen=self.HS_WINDOW)
+        self.hs_roll = deque(maxlen=self.HS_WINDOW)
+        self.hs_samples = 0
+        self.hs_rate = 0
 
         # Live dashboard data
         self.live_pitch = 0.0
@@ -498,6 +515,27 @@ class TestModeGUI:
         ttk.Button(cal_frame, text="Run Calibration", width=20,
                    command=lambda: self.send_command("cal")).pack(pady=5)
 
+        # High-rate binary stream frame
+        hs_frame = ttk.LabelFrame(parent, text="High-Rate Stream (binary)", padding="10")
+        hs_frame.grid(row=2, column=0, columnspan=2, sticky="ew", padx=5, pady=5)
+
+        hs_ctrl = ttk.Frame(hs_frame)
+        hs_ctrl.pack(fill="x")
+        ttk.Label(hs_ctrl, text="Rate (Hz):").pack(side="left")
+        self.hs_rate_combo = ttk.Combobox(hs_ctrl, width=6, state="readonly",
+                                          values=["50", "100", "200", "300"])
+        self.hs_rate_combo.set("200")
+        self.hs_rate_combo.pack(side="left", padx=5)
+        self.hs_btn = ttk.Button(hs_ctrl, text="High-Rate: OFF", width=16,
+                                 command=self.toggle_hs_stream)
+        self.hs_btn.pack(side="left", padx=5)
+        self.hs_stats_label = ttk.Label(hs_ctrl, text="", foreground="gray")
+        self.hs_stats_label.pack(side="left", padx=10)
+
+        self.hs_canvas = tk.Canvas(hs_frame, width=600, height=120, bg="white",
+                                   highlightthickness=1, highlightbackground="gray")
+        self.hs_canvas.pack(fill="x", pady=5)
+
     def setup_led_button_tab(self, parent):
         """Setup LED and button testing tab."""
         parent.columnconfigure(0, weight=1)
@@ -644,6 +682,8 @@ class TestModeGUI:
             self.serial_port = serial.Serial(port, baud, timeout=0.2)
             self.is_connected = True
             self.stop_thread = False
+            self.demux.reset()
+            self.hs_tracker.reset()
 
             # Start read thread
             self.read_thread = threading.Thread(target=self.read_serial, daemon=True)
@@ -676,6 +716,7 @@ class TestModeGUI:
         self.motor1_continuous = False
         self.motor2_continuous = False
         self.led_cycling = False
+        self.hs_streaming = False
         self.update_toggle_buttons()
 
         # Update UI
@@ -701,10 +742,21 @@ class TestModeGUI:
                     except queue.Empty:
                         break
 
-                # Read available data
-                data = self.serial_port.readline().decode("utf-8", errors="replace")
-                if data:
-                    self.message_queue.put(data)
+                # Read available data; binary frames (telemetry batches)
+                # are split out of the text stream
+                data = self.serial_port.read(self.serial_port.in_waiting or 1)
+                for item in self.demux.feed(data):
+                    if item[0] == "text":
+                        self.message_queue.put(item[1])
+                    elif item[1] == EVT_STREAM:
+                        batch = parse_batch(item[3])
+                        if batch:
+                            self.hs_tracker.update(batch)
+                            self.batch_queue.put(batch)
+                    elif item[1] == EVT_LOG:
+                        record = decode_record(item[3])
+                        if record:
+                            self.message_queue.put(record[1] + "\n")
 
             except Exception as e:
                 if not self.stop_thread:
@@ -723,12 +775,56 @@ class TestModeGUI:
         except queue.Empty:
             pass
 
+        hs_updated = False
+        try:
+            while True:
+                batch = self.batch_queue.get_nowait()
+                for sample in batch.samples:
+                    self.hs_pitch.append(sample.pitch)
+                    self.hs_roll.append(sample.roll)
+                self.hs_samples += len(batch.samples)
+                self.hs_rate = batch.rate_hz
+                last = batch.samples[-1]
+                self.live_pitch = last.pitch
+                self.live_roll = last.roll
+                self.live_m1_pos = last.m1
+                self.live_m2_pos = last.m2
+                hs_updated = dashboard_updated = True
+        except queue.Empty:
+            pass
+
         if dashboard_updated:
             self.update_dashboard()
+        if hs_updated:
+            self.draw_hs_plot()
 
         # Schedule next check
         self.root.after(50, self.process_queue)
 
+    def draw_hs_plot(self):
+        """Plot pitch (blue) and roll (orange) from the high-rate stream."""
+        c = self.hs_canvas
+        c.delete("all")
+        w = c.winfo_width() if c.winfo_width() > 1 else 600
+        h = 120
+        c.create_line(0, h // 2, w, h // 2, fill="gray", dash=(4, 4))
+
+        n = len(self.hs_pitch)
+        if n >= 2:
+            # Autoscale to the visible window, at least +/-0.1 deg
+            span = max(0.1, max(abs(v) for v in self.hs_pitch), max(abs(v) for v in self.hs_roll))
+            for trace, color in ((self.hs_pitch, "#3366cc"), (self.hs_roll, "#ff8800")):
+                points = []
+                for i, v in enumerate(trace):
+                    points.append(i * w / (self.HS_WINDOW - 1))
+                    points.append(h / 2 - v / span * (h / 2 - 2))
+                c.create_line(*points, fill=color)
+            c.create_text(4, 2, anchor="nw", text=f"±{span:.3f}°", font=("Consolas", 8))
+
+        self.hs_stats_label.config(
+            text=f"{self.hs_rate} Hz  {self.hs_samples} samples  "
+                 f"{self.hs_tracker.lost} lost  {self.demux.bad} bad")
+
     def log_output(self, text):
         """Add text to the output display."""
         self.output_text.config(state="normal")
@@ -776,6 +872,17 @@ class TestModeGUI:
         self.send_command("stream")
         self.update_toggle_buttons()
 
+    def toggle_hs_stream(self):
+        self.hs_streaming = not self.hs_streaming
+        if self.hs_streaming:
+            self.hs_pitch.clear()
+            self.hs_roll.clear()
+            self.hs_samples = 0
+            self.send_command(f"hstream {self.hs_rate_combo.get()}")
+        else:
+            self.send_command("hstream off")
+        self.update_toggle_buttons()
+
     def toggle_button_test(self):
         self.button_test = not self.button_test
         self.send_command("btn")
@@ -800,6 +907,7 @@ class TestModeGUI:
         self.dash_stream_btn.config(text=f"{'Stop Streaming' if self.imu_streaming else 'Start Streaming'}")
         self.btn_test_btn.config(text=f"Button Test: {'ON' if self.button_test else 'OFF'}")
         self.led_cycle_btn.config(text=f"{'Stop Cycling' if self.led_cycling else 'Cycle All Patterns'}")
+        self.hs_btn.config(text=f"High-Rate: {'ON' if self.hs_streaming else 'OFF'}")
 
     def on_closing(self):
         """Handle window close."""